@@ -0,0 +1,189 @@
+#include "CompressedAdjacency.h"
+#include <unordered_set>
+
+namespace {
+
+void writeVarint(vector<unsigned char> &out, unsigned int value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+unsigned int zigzag(int value) {
+    return (static_cast<unsigned int>(value) << 1) ^ static_cast<unsigned int>(value >> 31);
+}
+
+} // namespace
+
+// =============================================================================
+// CompressedAdjacency
+// =============================================================================
+CompressedAdjacency::CompressedAdjacency()
+    : vertices(0), maxDegree_(0), encoding(WEIGHT_NONE), weightError(0) {
+    clear();
+}
+
+void CompressedAdjacency::clear() {
+    vector<unsigned char>().swap(bytes);
+    blockBytes.assign(1, 0);
+    blockEdges.assign(1, 0);
+    localBytes.assign(1, 0);
+    localEdges.assign(1, 0);
+    vertices = 0;
+    maxDegree_ = 0;
+    vector<float>().swap(floatWeights);
+    vector<unsigned char>().swap(codes);
+    levels.clear();
+    weightError = 0;
+    vector<float>().swap(pending);
+}
+
+void CompressedAdjacency::start(WeightEncoding encoding) {
+    clear();
+    this->encoding = encoding;
+}
+
+void CompressedAdjacency::appendVertex(vector<pair<int, double> > &edges) {
+    std::sort(edges.begin(), edges.end());
+    int v = vertices;
+    unsigned long long edgeBase = blockEdges.back();
+    unsigned long long edgeEnd = edgeBase + localEdges.back() + edges.size();
+    int previous = v;
+    for (size_t i = 0; i < edges.size(); i++) {
+        writeVarint(bytes, i == 0 ? zigzag(edges[i].first - v) : static_cast<unsigned int>(edges[i].first - previous));
+        previous = edges[i].first;
+        if (encoding != WEIGHT_NONE)
+            pending.push_back(static_cast<float>(edges[i].second));
+    }
+    maxDegree_ = std::max(maxDegree_, static_cast<int>(edges.size()));
+    vertices++;
+
+    // offset kết thúc của v là offset bắt đầu của v + 1, có thể thuộc khối mới
+    if (vertices % VERTEX_BLOCK == 0) {
+        blockBytes.push_back(bytes.size());
+        blockEdges.push_back(edgeEnd);
+    }
+    unsigned long long localByte = bytes.size() - blockBytes.back();
+    unsigned long long localEdge = edgeEnd - blockEdges.back();
+    if (localByte > std::numeric_limits<unsigned int>::max() || localEdge > std::numeric_limits<unsigned int>::max()) {
+        throw std::length_error("CompressedAdjacency: vertex block exceeds 4 GiB");
+    }
+    localBytes.push_back(static_cast<unsigned int>(localByte));
+    localEdges.push_back(static_cast<unsigned int>(localEdge));
+}
+
+void CompressedAdjacency::finish() {
+    if (encoding == WEIGHT_FLOAT) {
+        floatWeights.swap(pending);
+        floatWeights.shrink_to_fit();
+    } else if (encoding == WEIGHT_QUANTIZED) {
+        quantize();
+    }
+    vector<float>().swap(pending);
+    bytes.shrink_to_fit();
+}
+
+void CompressedAdjacency::quantize() {
+    // dừng đếm giá trị khác nhau ngay khi vượt 256
+    std::unordered_set<float> distinct;
+    for (float w : pending) {
+        if (distinct.insert(w).second && distinct.size() > 256)
+            break;
+    }
+    codes.resize(pending.size());
+    if (distinct.size() <= 256) {
+        levels.assign(distinct.begin(), distinct.end());
+        std::sort(levels.begin(), levels.end());
+        for (size_t e = 0; e < pending.size(); e++) {
+            codes[e] = static_cast<unsigned char>(std::lower_bound(levels.begin(), levels.end(), pending[e]) - levels.begin());
+        }
+        weightError = 0;
+        return;
+    }
+    double low = *std::min_element(pending.begin(), pending.end());
+    double high = *std::max_element(pending.begin(), pending.end());
+    double step = (high - low) / 255;
+    levels.resize(256);
+    for (int i = 0; i < 256; i++) {
+        levels[i] = low + i * step;
+    }
+    for (size_t e = 0; e < pending.size(); e++) {
+        codes[e] = static_cast<unsigned char>(std::min(255.0, std::floor((pending[e] - low) / step + 0.5)));
+    }
+    weightError = step / 2;
+}
+
+double CompressedAdjacency::weight(unsigned long long edge) const {
+    switch (encoding) {
+    case WEIGHT_FLOAT:
+        return floatWeights[edge];
+    case WEIGHT_QUANTIZED:
+        return levels[codes[edge]];
+    default:
+        return 1;
+    }
+}
+
+int CompressedAdjacency::neighbors(int v, int *out) const {
+    // giải mã liền một mạch cả đoạn byte của v (dừng theo offset byte, không cần bậc); nhánh nhanh cho delta 1 byte
+    const unsigned char *p = bytes.data() + byteStart(v);
+    const unsigned char *end = bytes.data() + byteStart(v + 1);
+    if (p == end)
+        return 0;
+    unsigned int first = readVarint(p);
+    int target = v + static_cast<int>((first >> 1) ^ (~(first & 1) + 1));
+    int count = 0;
+    out[count++] = target;
+    while (p < end) {
+        unsigned int b = *p;
+        if (b < 0x80) {
+            p++;
+            target += b;
+        } else {
+            target += readVarint(p);
+        }
+        out[count++] = target;
+    }
+    return count;
+}
+
+vector<int> CompressedAdjacency::neighbors(int v) const {
+    vector<int> result(degree(v));
+    if (!result.empty())
+        neighbors(v, result.data());
+    return result;
+}
+
+vector<int> CompressedAdjacency::hops(int source, int maxDepth) const {
+    vector<int> depth(vertices, -1);
+    vector<int> frontier(1, source), next;
+    vector<int> buffer(maxDegree_);
+    depth[source] = 0;
+    for (int level = 1; !frontier.empty() && (maxDepth < 0 || level <= maxDepth); level++) {
+        next.clear();
+        for (int u : frontier) {
+            int count = neighbors(u, buffer.data());
+            for (int i = 0; i < count; i++) {
+                if (depth[buffer[i]] < 0) {
+                    depth[buffer[i]] = level;
+                    next.push_back(buffer[i]);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+    return depth;
+}
+
+size_t CompressedAdjacency::memoryBytes() const {
+    return bytes.capacity() + (blockBytes.capacity() + blockEdges.capacity()) * sizeof(unsigned long long) +
+           (localBytes.capacity() + localEdges.capacity()) * sizeof(unsigned int) + floatWeights.capacity() * sizeof(float) +
+           codes.capacity() + levels.capacity() * sizeof(double);
+}
+
+double CompressedAdjacency::bytesPerEdge() const {
+    unsigned long long edges = edgeCount();
+    return edges == 0 ? 0 : static_cast<double>(memoryBytes()) / edges;
+}
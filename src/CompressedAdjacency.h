@@ -0,0 +1,131 @@
+#ifndef COMPRESSEDADJACENCY_H
+#define COMPRESSEDADJACENCY_H
+
+#include "main.h"
+
+// =====================================
+// Class CompressedAdjacency
+// =====================================
+// Danh sách kề nén, chỉ đọc, theo id đỉnh (một chiều cạnh). Đích của mỗi đỉnh được sắp tăng dần và mã hóa
+// delta + varint (đích đầu tiên lưu độ lệch zigzag so với chính đỉnh đó, nên sau DGraphModel::reorder()
+// phần lớn delta chỉ tốn 1 byte). Trọng số nằm ở một cột riêng, theo thứ tự cạnh đã sắp:
+//   WEIGHT_NONE      không lưu, weight() luôn là 1
+//   WEIGHT_FLOAT     float 4 byte
+//   WEIGHT_QUANTIZED 1 byte: từ điển khi có <= 256 giá trị khác nhau (không mất mát), ngược lại chia đều
+//                    [min, max] thành 256 mức (sai số <= maxWeightError())
+// Offset lưu hai tầng: mỗi khối VERTEX_BLOCK đỉnh một offset 64 bit, mỗi đỉnh một offset 32 bit trong khối,
+// nên chi phí cố định khoảng 8 byte / đỉnh.
+enum WeightEncoding
+{
+    WEIGHT_NONE,
+    WEIGHT_FLOAT,
+    WEIGHT_QUANTIZED
+};
+
+class CompressedAdjacency
+{
+private:
+    static const int VERTEX_BLOCK = 64;
+
+    vector<unsigned char> bytes;            // các danh sách đích nối liền nhau
+    vector<unsigned long long> blockBytes;  // offset byte / cạnh đầu tiên của mỗi khối đỉnh
+    vector<unsigned long long> blockEdges;
+    vector<unsigned int> localBytes;        // offset trong khối của từng đỉnh (n + 1 phần tử)
+    vector<unsigned int> localEdges;
+    int vertices;
+    int maxDegree_;
+
+    WeightEncoding encoding;
+    vector<float> floatWeights;
+    vector<unsigned char> codes;
+    vector<double> levels;  // giá trị của từng mã 1 byte
+    double weightError;
+
+    vector<float> pending;  // trọng số gốc khi đang dựng (lượng tử hóa trong finish())
+
+    unsigned long long byteStart(int v) const { return blockBytes[v / VERTEX_BLOCK] + localBytes[v]; }
+    unsigned long long edgeStart(int v) const { return blockEdges[v / VERTEX_BLOCK] + localEdges[v]; }
+    void quantize();
+
+    static unsigned int readVarint(const unsigned char *&p)
+    {
+        unsigned int b = *p++;
+        if (b < 0x80)
+            return b;
+        unsigned int value = b & 0x7f;
+        int shift = 7;
+        do {
+            b = *p++;
+            value |= (b & 0x7f) << shift;
+            shift += 7;
+        } while (b >= 0x80);
+        return value;
+    }
+
+public:
+    CompressedAdjacency();
+
+    // dựng từ ảnh chụp CSR (AdjacencySnapshot); reverse = true: danh sách cạnh đi vào
+    template <class Snapshot>
+    void build(const Snapshot &graph, WeightEncoding encoding = WEIGHT_QUANTIZED, bool reverse = false);
+    // dựng tăng dần không cần ảnh chụp đầy đủ: start(), appendVertex() lần lượt cho id 0, 1, ..., finish().
+    // edges là (đích, trọng số), được sắp lại tại chỗ.
+    void start(WeightEncoding encoding);
+    void appendVertex(vector<pair<int, double> > &edges);
+    void finish();
+    void clear();
+
+    int vertexCount() const { return vertices; }
+    unsigned long long edgeCount() const { return vertices == 0 ? 0 : edgeStart(vertices); }
+    int degree(int v) const { return static_cast<int>(edgeStart(v + 1) - edgeStart(v)); }
+    int maxDegree() const { return maxDegree_; }
+
+    // giải mã cả danh sách của v vào out (cần chỗ cho degree(v) phần tử), trả về số đích
+    int neighbors(int v, int *out) const;
+    vector<int> neighbors(int v) const;
+    // f(đích, trọng số) theo thứ tự đích tăng dần
+    template <class F>
+    void forEach(int v, F f) const;
+    double weight(unsigned long long edge) const;
+    double maxWeightError() const { return weightError; }
+
+    // số bước từ source tới mọi đỉnh (-1 nếu không tới được hoặc xa hơn maxDepth >= 0)
+    vector<int> hops(int source, int maxDepth = -1) const;
+
+    size_t memoryBytes() const;
+    double bytesPerEdge() const;
+};
+
+template <class Snapshot>
+void CompressedAdjacency::build(const Snapshot &graph, WeightEncoding encoding, bool reverse)
+{
+    const vector<int> &offsets = reverse ? graph.inOffsets : graph.outOffsets;
+    const vector<int> &targets = reverse ? graph.inSources : graph.outTargets;
+    int n = graph.vertexCount();
+    start(encoding);
+    vector<pair<int, double> > edges;
+    for (int v = 0; v < n; v++){
+        edges.clear();
+        for (int e = offsets[v]; e < offsets[v + 1]; e++){
+            edges.push_back(make_pair(targets[e], static_cast<double>(reverse ? graph.inWeights[e] : graph.outWeights[e])));
+        }
+        appendVertex(edges);
+    }
+    finish();
+}
+
+template <class F>
+void CompressedAdjacency::forEach(int v, F f) const
+{
+    const unsigned char *p = bytes.data() + byteStart(v);
+    unsigned long long edge = edgeStart(v), end = edgeStart(v + 1);
+    int target = v;
+    for (bool first = true; edge < end; edge++, first = false){
+        unsigned int delta = readVarint(p);
+        // đích đầu tiên: zigzag của (đích - v); các đích sau: khoảng cách tới đích trước
+        target += first ? static_cast<int>((delta >> 1) ^ (~(delta & 1) + 1)) : static_cast<int>(delta);
+        f(target, weight(edge));
+    }
+}
+
+#endif // COMPRESSEDADJACENCY_H
@@ -1,734 +1,792 @@
 #include "KnowledgeGraph.h"
 
 // =============================================================================
-// Class Edge Implementation
+// Struct MemoryUsage Implementation
 // =============================================================================
+MemoryUsage::MemoryUsage()
+    : vertexPayload(0), vertexNodes(0), edges(0),
+      adListUsed(0), adListSlack(0), adListFullUsed(0), adListFullSlack(0),
+      inListUsed(0), inListSlack(0), indexes(0) {}
+
+size_t MemoryUsage::total() const {
+    return vertexPayload + vertexNodes + edges
+         + adListUsed + adListSlack + adListFullUsed + adListFullSlack
+         + inListUsed + inListSlack + indexes;
+}
 
-template <class T>
-Edge<T>::Edge(VertexNode<T> *from, VertexNode<T> *to, float weight){
-    // khởi tạo các tham số chỉ định
-    this->from = from;
-    this->to = to;
-    this->weight = weight;
+size_t MemoryUsage::slack() const {
+    return adListSlack + adListFullSlack + inListSlack;
 }
 
-template <class T>
-string Edge<T>::toString(){
-    stringstream ss;
-    ss << "(";
-    if (from != nullptr){
-        if (from->vertex2str != nullptr)
-            ss << from->vertex2str(from->vertex);
-        else
-            ss << from->vertex;  
-    }
-    ss << ", ";
-    if (to != nullptr){
-        if (to->vertex2str != nullptr)
-            ss << to->vertex2str(to->vertex);
-        else
-            ss << to->vertex;  
-    }
-    ss << ", ";
-    
-    // Format float with 6 decimal places using stringstream methods
-    ss.precision(6); // đặt độ chính xác là 6 chữ số thập phân
-    ss.setf(std::ios::fixed, std::ios::floatfield); // sử dụng định dạng số thập phân cố định
-    ss << weight; // in ra trọng số với thiết lập ở trên
-    
-    ss << ")";
-    return ss.str();
+MemoryUsage &MemoryUsage::operator+=(const MemoryUsage &other) {
+    vertexPayload += other.vertexPayload;
+    vertexNodes += other.vertexNodes;
+    edges += other.edges;
+    adListUsed += other.adListUsed;
+    adListSlack += other.adListSlack;
+    adListFullUsed += other.adListFullUsed;
+    adListFullSlack += other.adListFullSlack;
+    inListUsed += other.inListUsed;
+    inListSlack += other.inListSlack;
+    indexes += other.indexes;
+    return *this;
 }
 
-// TODO: Implement other methods of Edge:
-template <class T>
-bool Edge<T>::equals(Edge<T> *edge){
-    // so sánh cạnh hiện tại vs 1 cạnh khác, true nếu from và to giống nhau, ngược lại false
-    if (edge == nullptr)
-        return false;
-    return (this->from == edge->from && this->to == edge->to);
+string MemoryUsage::toString() const {
+    stringstream ss;
+    ss << "[vertexPayload=" << vertexPayload
+       << ", vertexNodes=" << vertexNodes
+       << ", edges=" << edges
+       << ", adList=" << adListUsed << "+" << adListSlack
+       << ", adListFull=" << adListFullUsed << "+" << adListFullSlack
+       << ", inList=" << inListUsed << "+" << inListSlack
+       << ", indexes=" << indexes
+       << ", total=" << total() << "]";
+    return ss.str();
 }
 
-template <class T>
-bool Edge<T>::edgeEQ(Edge<T> *&edge1, Edge<T> *&edge2)
-{
-    if (edge1 == nullptr || edge2 == nullptr)
-        return false;
-    return edge1->equals(edge2);
+// =============================================================================
+// PageRank helpers
+// =============================================================================
+vector<pair<int, double> > topScores(const vector<double> &scores, int k) {
+    // min-heap theo "độ tốt": phần tử đầu là phần tử kém nhất trong k phần tử đang giữ
+    auto better = [](const pair<int, double> &a, const pair<int, double> &b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    };
+    vector<pair<int, double> > heap;
+    if (k <= 0) {
+        return heap;
+    }
+    for (size_t id = 0; id < scores.size(); id++) {
+        pair<int, double> candidate(id, scores[id]);
+        if (heap.size() < static_cast<size_t>(k)) {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+        else if (better(candidate, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), better);
+    return heap;
 }
 
 // =============================================================================
-// Class VertexNode Implementation
+// Class PredicateTable Implementation
 // =============================================================================
-template <class T>
-VertexNode<T>::VertexNode(T vertex, bool (*vertexEQ)(T &, T &), string (*vertex2str)(T &)){
-    this->vertex = vertex;
-    this->vertexEQ = vertexEQ;
-    this->vertex2str = vertex2str;
-    this->inDegree_ = 0;
-    this->outDegree_ = 0;
+PredicateTable::PredicateTable() {
+    // id 0 (NONE) ứng với tên rỗng: quan hệ không nhãn
+    names.push_back("");
+    ids[""] = NONE;
 }
 
-template <class T>
-VertexNode<T>::~VertexNode(){
-    // Clean up all edges in adjacency list
-    for (auto edge : adList){
-        delete edge;
+int PredicateTable::intern(const string &name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) {
+        return it->second;
     }
-    adList.clear();
-    adListFull.clear(); // Clear full adjacency list as well (bao gồm cả incoming và outcoming edges)
+    int id = names.size();
+    names.push_back(name);
+    ids[name] = id;
+    return id;
 }
 
-template <class T>
-T &VertexNode<T>::getVertex(){
-    return this->vertex;
+int PredicateTable::find(const string &name) const {
+    auto it = ids.find(name);
+    return it == ids.end() ? static_cast<int>(UNKNOWN) : it->second;
 }
 
-template <class T>
-void VertexNode<T>::connect(VertexNode<T> *to, float weight){
-    // kết nối đỉnh hiện tại vs đỉnh to bằng cách tạo 1 canh với trọng số weight (mặc định là 0)
-    if (to == nullptr)
-        return;
+const string &PredicateTable::name(int id) const {
+    return names.at(id);
+}
 
-    // Check if edge already exists
-    for (auto edge : adList){
-        if (edge->to == to){
-            edge->weight = weight; // Update weight if exists
-            return;
-        }
+int PredicateTable::size() const {
+    return names.size();
+}
+
+size_t PredicateTable::memoryBytes() const {
+    size_t bytes = names.capacity() * sizeof(string) + ids.bucket_count() * sizeof(void *);
+    bytes += ids.size() * (sizeof(void *) + sizeof(pair<const string, int>));
+    for (const string &name : names) {
+        bytes += 2 * payloadHeapBytes(name); // tên nằm trong cả names và ids
     }
+    return bytes;
+}
 
-    // Create new edge
-    Edge<T> *newEdge = new Edge<T>(this, to, weight); // from ,to, weight
-    
-    // Add to outgoing edges list of 'from' node (this)
-    adList.push_back(newEdge);
-    adListFull.push_back(newEdge);
-    this->outDegree_++;
-    
-    // Add to full edges list of 'to' node (incoming edge)
-    to->adListFull.push_back(newEdge);
-    to->inDegree_++;
+// =============================================================================
+// Class KnowledgeGraph Implementation
+// =============================================================================
+// Helper function for string comparison
+bool KnowledgeGraph::stringEQ(string &lhs, string &rhs) {
+    // So sánh hai chuỗi lhs và rhs, trả về true nếu chúng bằng nhau, ngược lại false
+    return lhs == rhs;
 }
 
-template <class T>
-Edge<T> *VertexNode<T>::getEdge(VertexNode<T> *to){
-    // trả về con trỏ nối đỉnh hiện tại vs đỉnh to, nếu k có trả về nullptr
-    for (auto edge : adList){
-        if (edge->to == to)
-            return edge;
-    }
-    return nullptr;
+KnowledgeGraph::KnowledgeGraph() : graph(), neighborsBuilt(false) {
+    // Khởi tạo đồ thị tri thức với NativeVertexPolicy<string>: so sánh bằng operator== (inline, tương đương stringEQ),
+    // tìm đỉnh qua chỉ mục băm, không có hàm định dạng để vertex2Str() gọi toString() cho BFS/DFS
 }
 
-template <class T>
-bool VertexNode<T>::equals(VertexNode<T> *node){
-    if (node == nullptr)
-        return false;
-    if (this->vertexEQ != nullptr)
-        return this->vertexEQ(this->vertex, node->vertex);
-    return this->vertex == node->vertex;
+KnowledgeGraph::EntityNode *KnowledgeGraph::requireEntity(const string &entity) {
+    EntityNode *node = graph.getVertexNode(entity);
+    if (node == nullptr) {
+        throw EntityNotFoundException();
+    }
+    return node;
 }
 
-template <class T>
-void VertexNode<T>::removeTo(VertexNode<T> *to){
-    // xóa cạnh nối đỉnh hiện tại vs đỉnh to
-    for (auto it = adList.begin(); it != adList.end(); ++it){
-        if ((*it)->to == to){
-            Edge<T>* edgeToRemove = *it;
-            
-            // Remove from adListFull of 'from' node (this)
-            for (auto it2 = this->adListFull.begin(); it2 != this->adListFull.end(); ++it2){
-                if (*it2 == edgeToRemove){
-                    this->adListFull.erase(it2);
-                    break;
-                }
-            }
-            
-            // Remove from adListFull of 'to' node
-            for (auto it2 = to->adListFull.begin(); it2 != to->adListFull.end(); ++it2){
-                if (*it2 == edgeToRemove){
-                    to->adListFull.erase(it2);
-                    break;
-                }
-            }
-            
-            delete edgeToRemove;
-            adList.erase(it);
-            this->outDegree_--;
-            to->inDegree_--;
-            return;
+void KnowledgeGraph::connectEntities(EntityNode *fromNode, EntityNode *toNode, float weight, int predicate) {
+    // cạnh mới <=> bậc ra tăng (connect chỉ cập nhật trọng số nếu cạnh cùng vị từ đã có)
+    int outBefore = fromNode->outDegree(), inBefore = toNode->inDegree();
+    bool firstOut = fromNode->getAdList(predicate).empty(), firstIn = toNode->getInList(predicate).empty();
+    graph.connectNodes(fromNode, toNode, weight, predicate);
+    if (fromNode->outDegree() == outBefore) {
+        return;
+    }
+    anyStats.edges++;
+    anyStats.subjects += outBefore == 0;
+    anyStats.objects += inBefore == 0;
+    if (predicate != PredicateTable::NONE) {
+        if (predicateStats.size() <= static_cast<size_t>(predicate)) {
+            predicateStats.resize(predicate + 1);
         }
+        predicateStats[predicate].edges++;
+        predicateStats[predicate].subjects += firstOut;
+        predicateStats[predicate].objects += firstIn;
     }
 }
 
-template <class T>
-int VertexNode<T>::inDegree(){
-    return this->inDegree_;
+void KnowledgeGraph::addEntity(const string &entity) {
+    // TODO: Add a new entity to the Knowledge Graph (thêm thực thể mới vào đồ thị)
+    if (graph.contains(entity)) {
+        throw EntityExistsException();
+    }
+    graph.add(entity);
+    entities.push_back(entity);
+    landmarks.clear();
+    neighborIndex.clear();
+    neighborsBuilt = false;
 }
 
-template <class T>
-int VertexNode<T>::outDegree(){
-    return this->outDegree_;
+void KnowledgeGraph::addRelation(const string &from, const string &to, float weight) {
+    // TODO: Add a directed relation from 'from' entity to 'to' entity with the specified weight
+    EntityNode *fromNode = requireEntity(from);
+    EntityNode *toNode = requireEntity(to);
+    connectEntities(fromNode, toNode, weight, PredicateTable::NONE);
+    landmarks.clear();
+    neighborIndex.clear();
+    neighborsBuilt = false;
 }
 
-template <class T>
-string VertexNode<T>::toString(){
-    stringstream ss;
-    ss << "(";
-    if (this->vertex2str != nullptr)
-        ss << this->vertex2str(this->vertex);
-    else
-        ss << this->vertex;
-    ss << ", " << this->inDegree_ << ", " << this->outDegree_ << ", [";
-    
-    for (size_t i = 0; i < adListFull.size(); i++){
-        if (i > 0) ss << ", ";
-        ss << adListFull[i]->toString();
+void KnowledgeGraph::addTriple(const string &subject, const string &predicate, const string &object, float weight) {
+    EntityNode *fromNode = requireEntity(subject);
+    EntityNode *toNode = requireEntity(object);
+    connectEntities(fromNode, toNode, weight, predicates.intern(predicate));
+    landmarks.clear();
+    neighborIndex.clear();
+    neighborsBuilt = false;
+}
+
+const vector<string> &KnowledgeGraph::getAllEntities() {
+    return entities;
+}
+
+vector<string> KnowledgeGraph::getNeighbors(const string &entity) {
+    // Lấy tất cả các đỉnh kề (outward neighbors) của thực thể đã cho
+    EntityNode *node = requireEntity(entity);
+    vector<string> neighbors;
+    neighbors.reserve(node->outDegree());
+    for (auto edge : node->getAdList()) {
+        neighbors.push_back(edge->getTo()->getVertex());
     }
-    ss << "])";
-    return ss.str();
+    return neighbors;
 }
 
-// =============================================================================
-// Class DGraphModel Implementation
-// =============================================================================
-template <class T>
-DGraphModel<T>::DGraphModel(bool (*vertexEQ)(T &, T &), string (*vertex2str)(T &)){
-    this->vertexEQ = vertexEQ;
-    this->vertex2str = vertex2str;
+vector<string> KnowledgeGraph::getNeighbors(const string &entity, const string &predicate) {
+    EntityNode *node = requireEntity(entity);
+    vector<string> neighbors;
+    for (auto edge : node->getAdList(predicates.find(predicate))) {
+        neighbors.push_back(edge->getTo()->getVertex());
+    }
+    return neighbors;
+}
+
+string KnowledgeGraph::bfs(const string &start) {
+    requireEntity(start);
+    return graph.BFS(start);
+}
+
+string KnowledgeGraph::bfs(const string &start, const string &predicate) {
+    requireEntity(start);
+    return graph.BFS(start, predicates.find(predicate));
+}
+
+string KnowledgeGraph::dfs(const string &start) {
+    requireEntity(start);
+    return graph.DFS(start);
 }
 
-template <class T>
-DGraphModel<T>::~DGraphModel(){
-    // TODO: Clear all vertices and edges to avoid memory leaks
-    clear();
+string KnowledgeGraph::dfs(const string &start, const string &predicate) {
+    requireEntity(start);
+    return graph.DFS(start, predicates.find(predicate));
 }
 
-template <class T>
-VertexNode<T> *DGraphModel<T>::getVertexNode(T &vertex){
-    // tìm kiếm và trả về con trỏ đỉnh có giá trị vertex, nếu ko tìm thấy trả về nullptr
-    for (auto node : nodeList){
-        if (vertexEQ != nullptr){
-            if (vertexEQ(node->vertex, vertex))
-                return node;
+bool KnowledgeGraph::isReachable(const string &from, const string &to) {
+    return reachable(requireEntity(from), requireEntity(to), PredicateTable::ANY);
+}
+
+bool KnowledgeGraph::isReachable(const string &from, const string &to, const string &predicate) {
+    return reachable(requireEntity(from), requireEntity(to), predicates.find(predicate));
+}
+
+bool KnowledgeGraph::reachable(EntityNode *fromNode, EntityNode *toNode, int predicate) {
+    // Use BFS to check reachability (duyệt trực tiếp trên các đỉnh, đánh dấu visited theo id của đỉnh)
+    vector<bool> visited(graph.size(), false);
+    Queue<EntityNode*> queue;
+    
+    queue.enqueue(fromNode);
+    visited[fromNode->getId()] = true;
+    
+    while (!queue.isEmpty()) {
+        EntityNode* current = queue.dequeue();
+        
+        if (current == toNode) {
+            return true;
         }
-        else {
-            if (node->vertex == vertex)
-                return node;
+        // Explore neighbors - outward edges of current entity (chỉ cạnh của vị từ nếu có lọc)
+        for (auto edge : current->getAdList(predicate)) {
+            EntityNode* neighbor = edge->getTo();
+            if (!visited[neighbor->getId()]) {
+                visited[neighbor->getId()] = true;
+                queue.enqueue(neighbor);
+            }
         }
     }
-    return nullptr;
+    
+    return false;
 }
 
-template <class T>
-string DGraphModel<T>::vertex2Str(VertexNode<T> &node){
-    // Nếu có function pointer vertex2str, dùng nó (trả về giá trị đơn giản là gtri vertex)
-    if (this->vertex2str != nullptr) {
-        return this->vertex2str(node.vertex);
-    }
-    
-    // Nếu không có function pointer vertex2str, trả về format đầy đủ như toString()
-    return node.toString();
+string KnowledgeGraph::toString() {
+    return graph.toString();
 }
 
-template <class T>
-string DGraphModel<T>::edge2Str(Edge<T> &edge){
-    return edge.toString();
+PathResult<string, double> KnowledgeGraph::shortestPath(const string &from, const string &to) {
+    requireEntity(from);
+    requireEntity(to);
+    return graph.shortestPath(from, to);
 }
 
-template <class T>
-void DGraphModel<T>::add(T vertex){
-    // TODO: Add a new vertex to the graph
-    if (contains(vertex)) return; // Vertex already exists
-    VertexNode<T> *newNode = new VertexNode<T>(vertex, this->vertexEQ, this->vertex2str);
-    nodeList.push_back(newNode);
+vector<pair<string, double> > KnowledgeGraph::shortestDistances(const string &from) {
+    requireEntity(from);
+    return graph.shortestDistances(from);
 }
 
-template <class T>
-bool DGraphModel<T>::contains(T vertex){
-    return getVertexNode(vertex) != nullptr;
+vector<pair<string, double> > KnowledgeGraph::entitiesWithinCost(const string &entity, double budget, double maxEdgeWeight,
+                                                                 size_t limit) {
+    requireEntity(entity);
+    return graph.withinDistance(entity, budget, static_cast<float>(maxEdgeWeight), limit);
 }
 
-template <class T>
-float DGraphModel<T>::weight(T from, T to){
-    // trả về trọng số của cạnh nối đỉnh from vs đỉnh to
-    VertexNode<T> *fromNode = getVertexNode(from);
-    if (fromNode == nullptr){
-        throw VertexNotFoundException();
+PathResult<string, double> KnowledgeGraph::findPath(const string &from, const string &to) {
+    requireEntity(from);
+    requireEntity(to);
+    if (hasLandmarks()) {
+        return graph.landmarkPath(from, to, landmarks);
     }
+    return graph.bidirectionalPath(from, to);
+}
 
-    VertexNode<T> *toNode = getVertexNode(to);
-    if (toNode == nullptr){
-        throw VertexNotFoundException();
-    }
+void KnowledgeGraph::kShortestPaths(const string &from, const string &to, int k,
+                                    const std::function<bool(const PathResult<string, double> &)> &emit) {
+    requireEntity(from);
+    requireEntity(to);
+    graph.kShortestPaths(from, to, k, emit);
+}
 
-    Edge<T> *edge = fromNode->getEdge(toNode);
-    if (edge == nullptr){
-        throw EdgeNotFoundException();
-    }
+vector<PathResult<string, double> > KnowledgeGraph::kShortestPaths(const string &from, const string &to, int k) {
+    vector<PathResult<string, double> > paths;
+    kShortestPaths(from, to, k, [&paths](const PathResult<string, double> &path) {
+        paths.push_back(path);
+        return true;
+    });
+    return paths;
+}
 
-    return edge->weight;
+void KnowledgeGraph::simplePaths(const string &from, const string &to, int maxHops,
+                                 const std::function<bool(const PathResult<string, double> &)> &emit) {
+    requireEntity(from);
+    requireEntity(to);
+    graph.simplePaths(from, to, maxHops, emit);
 }
 
-template <class T>
-vector<Edge<T> *> DGraphModel<T>::getOutwardEdges(T from){
-    // trả về danh sách các cạnh đi ra từ đỉnh from
-    VertexNode<T> *fromNode = getVertexNode(from);
-    if (fromNode == nullptr){
-        throw VertexNotFoundException();
-    }
-    return fromNode->adList;
+vector<PathResult<string, double> > KnowledgeGraph::simplePaths(const string &from, const string &to, int maxHops, size_t limit) {
+    vector<PathResult<string, double> > paths;
+    simplePaths(from, to, maxHops, [&paths, limit](const PathResult<string, double> &path) {
+        paths.push_back(path);
+        return limit == 0 || paths.size() < limit;
+    });
+    return paths;
 }
 
-template <class T>
-void DGraphModel<T>::connect(T from, T to, float weight){
-    VertexNode<T> *fromNode = getVertexNode(from);
-    if (fromNode == nullptr){
-        throw VertexNotFoundException();
-    }
+void KnowledgeGraph::buildLandmarks(int count) {
+    landmarks = graph.buildLandmarks(count);
+}
 
-    VertexNode<T> *toNode = getVertexNode(to);
-    if (toNode == nullptr){
-        throw VertexNotFoundException();
-    }
+bool KnowledgeGraph::hasLandmarks() {
+    return graph.landmarksMatch(landmarks);
+}
 
-    fromNode->connect(toNode, weight);
+void KnowledgeGraph::saveLandmarks(ostream &out) {
+    landmarks.save(out);
 }
 
-template <class T>
-void DGraphModel<T>::disconnect(T from, T to){
-    VertexNode<T> *fromNode = getVertexNode(from);
-    if (fromNode == nullptr){
-        throw VertexNotFoundException();
+bool KnowledgeGraph::loadLandmarks(istream &in) {
+    if (!landmarks.load(in) || !graph.bindLandmarks(landmarks)) {
+        landmarks.clear();
+        return false;
     }
+    return true;
+}
 
-    VertexNode<T> *toNode = getVertexNode(to);
-    if (toNode == nullptr){
-        throw VertexNotFoundException();
+void KnowledgeGraph::saveSnapshot(ostream &out) {
+    string buffer("KGS1");
+    putBytes(buffer, static_cast<unsigned int>(predicates.size()));
+    for (int p = PredicateTable::NONE + 1; p < predicates.size(); p++) {
+        putString(buffer, predicates.name(p));
+    }
+    putBytes(buffer, static_cast<unsigned int>(entities.size()));
+    for (const string &entity : entities) {
+        putString(buffer, entity);
     }
 
-    fromNode->removeTo(toNode); // disconnect nghĩa là xóa cạnh nối từ 'from' đến 'to'
-}
+    // Đánh số cạnh, gán vị từ và vị trí thực thể (thứ tự trong entities) cho hai đầu mút
+    const vector<int> &ids = graph.insertionOrder();
+    vector<int> position(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        position[ids[i]] = i;
+    }
+    vector<EntityEdge *> edges;
+    unordered_map<EntityEdge *, int> number;
+    for (int id : ids) {
+        for (auto edge : graph.nodeAt(id)->getAdList()) {
+            number[edge] = edges.size();
+            edges.push_back(edge);
+        }
+    }
+    vector<int> predicate(edges.size(), PredicateTable::NONE);
+    for (int p = PredicateTable::NONE + 1; p < predicates.size(); p++) {
+        for (int id : ids) {
+            for (auto edge : graph.nodeAt(id)->getAdList(p)) {
+                predicate[number[edge]] = p;
+            }
+        }
+    }
 
-template <class T>
-bool DGraphModel<T>::connected(T from, T to){
-    // kiểm tra xem có cạnh nối đỉnh from vs đỉnh to hay ko
-    VertexNode<T> *fromNode = getVertexNode(from);
-    if (fromNode == nullptr){
-        throw VertexNotFoundException();
+    // Thứ tự tạo: danh sách kề đầy đủ của mỗi đỉnh là một dãy con của thứ tự tạo thật, nên cạnh kế tiếp
+    // trong danh sách phải được tạo sau. Mỗi cạnh có tối đa hai cạnh kế tiếp (ở đỉnh nguồn và đỉnh đích);
+    // Kahn trên các ràng buộc này cho một thứ tự tương thích với mọi danh sách.
+    vector<int> successor(2 * edges.size(), -1), waiting(edges.size(), 0);
+    for (int id : ids) {
+        EntityNode *node = graph.nodeAt(id);
+        ArrayView<EntityEdge *> incident = node->getIncidentList();
+        for (size_t i = 0; i + 1 < incident.size(); i++) {
+            if (incident[i] == incident[i + 1]) {
+                continue; // hai lần xuất hiện của một cạnh tự vòng
+            }
+            int a = number[incident[i]], b = number[incident[i + 1]];
+            successor[2 * a + (incident[i]->getFrom() == node ? 0 : 1)] = b;
+            waiting[b]++;
+        }
+    }
+    std::queue<int> ready;
+    for (size_t e = 0; e < edges.size(); e++) {
+        if (waiting[e] == 0) ready.push(e);
+    }
+    putBytes(buffer, static_cast<unsigned long long>(edges.size()));
+    while (!ready.empty()) {
+        int e = ready.front();
+        ready.pop();
+        putBytes(buffer, static_cast<unsigned int>(position[edges[e]->getFrom()->getId()]));
+        putBytes(buffer, static_cast<unsigned int>(position[edges[e]->getTo()->getId()]));
+        putBytes(buffer, predicate[e]);
+        putBytes(buffer, static_cast<float>(edges[e]->getWeight()));
+        for (int side = 0; side < 2; side++) {
+            int next = successor[2 * e + side];
+            if (next >= 0 && --waiting[next] == 0) ready.push(next);
+        }
+        if (buffer.size() >= (1 << 20)) {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
     }
 
-    VertexNode<T> *toNode = getVertexNode(to);
-    if (toNode == nullptr){
-        throw VertexNotFoundException();
+    vector<int> placed;
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (positions.has(ids[i])) placed.push_back(i);
+    }
+    putBytes(buffer, static_cast<unsigned int>(placed.size()));
+    for (int i : placed) {
+        const Point &point = positions.get(ids[i]);
+        putBytes(buffer, static_cast<unsigned int>(i));
+        putBytes(buffer, point.getX());
+        putBytes(buffer, point.getY());
+        putBytes(buffer, point.getZ());
     }
+    out.write(buffer.data(), buffer.size());
+}
 
-    return (fromNode->getEdge(toNode) != nullptr);
+void KnowledgeGraph::loadSnapshot(istream &in) {
+    if (!entities.empty()) {
+        throw StorageException("Snapshot can only be loaded into an empty graph");
+    }
+    string buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t offset = 4;
+    bool ok = buffer.compare(0, 4, "KGS1") == 0;
+    unsigned int predicateCount = 0, entityCount = 0, placedCount = 0;
+    ok = ok && getBytes(buffer, offset, predicateCount);
+    for (unsigned int p = PredicateTable::NONE + 1; ok && p < predicateCount; p++) {
+        string name;
+        ok = getString(buffer, offset, name);
+        predicates.intern(name);
+    }
+    ok = ok && getBytes(buffer, offset, entityCount);
+    vector<EntityNode *> nodes;
+    for (unsigned int i = 0; ok && i < entityCount; i++) {
+        string entity;
+        ok = getString(buffer, offset, entity);
+        if (ok) {
+            addEntity(entity);
+            nodes.push_back(requireEntity(entity));
+        }
+    }
+    unsigned long long edgeCount = 0;
+    ok = ok && getBytes(buffer, offset, edgeCount);
+    for (unsigned long long e = 0; ok && e < edgeCount; e++) {
+        unsigned int from, to;
+        int predicate;
+        float weight;
+        ok = getBytes(buffer, offset, from) && getBytes(buffer, offset, to) && getBytes(buffer, offset, predicate) &&
+             getBytes(buffer, offset, weight) && from < entityCount && to < entityCount && predicate >= 0 &&
+             predicate < predicates.size();
+        if (ok) connectEntities(nodes[from], nodes[to], weight, predicate);
+    }
+    ok = ok && getBytes(buffer, offset, placedCount);
+    for (unsigned int k = 0; ok && k < placedCount; k++) {
+        unsigned int i;
+        double x, y, z;
+        ok = getBytes(buffer, offset, i) && getBytes(buffer, offset, x) && getBytes(buffer, offset, y) &&
+             getBytes(buffer, offset, z) && i < entityCount;
+        if (ok) positions.set(nodes[i]->getId(), Point(x, y, z));
+    }
+    if (!ok || offset != buffer.size()) {
+        throw StorageException("Corrupt knowledge graph snapshot");
+    }
+    landmarks.clear();
+    neighborIndex.clear();
+    neighborsBuilt = false;
 }
 
-template <class T>
-int DGraphModel<T>::size(){
-    return nodeList.size(); // trả về số đỉnh trong đồ thị
+MemoryUsage KnowledgeGraph::memoryUsage() {
+    // bộ nhớ của đồ thị + danh sách entities (bản sao tên thực thể, tính vào phần chỉ mục)
+    MemoryUsage usage = graph.memoryUsage();
+    usage.indexes += sizeof(KnowledgeGraph) - sizeof(EntityGraph);
+    usage.indexes += entities.capacity() * sizeof(string);
+    for (const string &entity : entities) {
+        usage.indexes += payloadHeapBytes(entity);
+    }
+    usage.indexes += predicates.memoryBytes();
+    usage.indexes += positions.memoryBytes();
+    usage.indexes += neighborIndex.memoryBytes();
+    return usage;
 }
 
-template <class T>
-bool DGraphModel<T>::empty(){
-    return nodeList.empty(); // kiểm tra đồ thị có rỗng hay ko
+void KnowledgeGraph::compact() {
+    graph.compact();
+    entities.shrink_to_fit();
 }
 
-template <class T>
-void DGraphModel<T>::clear(){
-    // xóa tất cả các cạnh và node trong đồ thị (bắt buộc phải xóa cạnh trước nếu ko sẽ bị rò rỉ bộ nhớ)
-    for (auto node : nodeList){
-        for (auto edge : node->adList){
-            delete edge;
+void KnowledgeGraph::reorder(ReorderStrategy strategy) {
+    // entities giữ thứ tự thêm; chỉ các cấu trúc đánh theo id đỉnh cần đổi theo
+    vector<int> before = graph.insertionOrder();
+    graph.reorder(strategy);
+    const vector<int> &after = graph.insertionOrder();
+    SpatialIndex moved;
+    for (size_t i = 0; i < before.size(); i++) {
+        if (positions.has(before[i])) {
+            moved.set(after[i], positions.get(before[i]));
         }
-        node->adList.clear();
-        node->adListFull.clear();
-        delete node;
     }
-    nodeList.clear();
+    positions.swap(moved);
+    landmarks.clear();
+    neighborIndex.clear();
+    neighborsBuilt = false;
 }
 
-template <class T>
-int DGraphModel<T>::inDegree(T vertex){
-    VertexNode<T> *node = getVertexNode(vertex);
-    if (node == nullptr){
-        throw VertexNotFoundException();
-    }
-    return node->inDegree();
+vector<string> KnowledgeGraph::getRelatedEntities(const string &entity, int depth) {
+    // TODO: Return all entities related to the given entity within the specified depth (use BFS)
+    return related(requireEntity(entity), depth, PredicateTable::ANY, false);
+}
+
+vector<string> KnowledgeGraph::getRelatedEntities(const string &entity, int depth, const string &predicate) {
+    return related(requireEntity(entity), depth, predicates.find(predicate), false);
 }
 
-template <class T>
-int DGraphModel<T>::outDegree(T vertex){
-    VertexNode<T> *node = getVertexNode(vertex);
-    if (node == nullptr){
-        throw VertexNotFoundException();
+vector<string> KnowledgeGraph::getRelatedEntities(const string &entity, int depth, const Point &center, double radius) {
+    EntityNode *startNode = requireEntity(entity);
+    // đánh dấu vùng bằng truy vấn bán kính trên cây k-d, sau đó lọc kết quả BFS theo id
+    vector<bool> region(graph.size(), false);
+    for (const pair<double, int> &hit : positions.within(center, radius)) {
+        region[hit.second] = true;
     }
-    return node->outDegree();
+    return related(startNode, depth, PredicateTable::ANY, false, &region);
 }
 
-template <class T>
-vector<T> DGraphModel<T>::vertices(){
-    // trả về danh sách tất cả các đỉnh trong đồ thị
-    vector<T> result;
-    for (auto node : nodeList){
-        result.push_back(node->vertex);
+vector<vector<string> > KnowledgeGraph::getRelatedEntities(const vector<string> &seeds, int depth) {
+    vector<int> sources;
+    for (const string &seed : seeds) {
+        sources.push_back(requireEntity(seed)->getId());
+    }
+    vector<vector<string> > result(seeds.size());
+    if (depth <= 0) {
+        return result;
+    }
+    vector<vector<pair<int, int> > > reached = multiSourceBFS(graph.snapshot(), sources, depth);
+    for (size_t i = 0; i < reached.size(); i++) {
+        for (const pair<int, int> &hit : reached[i]) {
+            result[i].push_back(graph.vertexAt(hit.first));
+        }
     }
     return result;
 }
 
-template <class T>
-string DGraphModel<T>::toString(){
-    // trả về chuỗi biểu diễn toàn bộ đồ thị, bao gồm danh sách các đỉnh theo đúng thứ tự trong nodeList và các cạnh của chúng
-    // mỗi đỉnh dc in bằng phương thức toString() của VertexNode
-    stringstream ss;
-    ss << "[";
-    
-    for (size_t i = 0; i < nodeList.size(); i++){
-        if (i > 0) ss << ", ";
-        ss << nodeList[i]->toString();
+vector<vector<pair<string, int> > > KnowledgeGraph::hopDistances(const vector<string> &seeds, int maxDepth) {
+    vector<int> sources;
+    for (const string &seed : seeds) {
+        sources.push_back(requireEntity(seed)->getId());
     }
-    
-    ss << "]";
-    return ss.str();
+    vector<vector<pair<int, int> > > reached = multiSourceBFS(graph.snapshot(), sources, maxDepth);
+    vector<vector<pair<string, int> > > result(seeds.size());
+    for (size_t i = 0; i < reached.size(); i++) {
+        for (const pair<int, int> &hit : reached[i]) {
+            result[i].push_back(make_pair(graph.vertexAt(hit.first), hit.second));
+        }
+    }
+    return result;
 }
 
-// TODO: BFS use Queue and DFS use stack
-template <class T>
-class Queue
-{
-private:
-    vector<T> data;
-    int frontIndex;
-    int rearIndex;
+void KnowledgeGraph::setPosition(const string &entity, const Point &position) {
+    positions.set(requireEntity(entity)->getId(), position);
+}
 
-public:
-    Queue() : frontIndex(0), rearIndex(-1) {}
+bool KnowledgeGraph::hasPosition(const string &entity) {
+    return positions.has(requireEntity(entity)->getId());
+}
 
-    // TODO
-    void enqueue(T item){
-        data.push_back(item);
-        rearIndex++;
+Point KnowledgeGraph::getPosition(const string &entity) {
+    int id = requireEntity(entity)->getId();
+    if (!positions.has(id)) {
+        throw PositionNotFoundException();
     }
+    return positions.get(id);
+}
 
-    T dequeue(){
-        return data[frontIndex++];
+vector<string> KnowledgeGraph::nearestEntities(const Point &center, int k) {
+    vector<string> result;
+    for (const pair<double, int> &hit : positions.nearest(center, k)) {
+        result.push_back(graph.vertexAt(hit.second));
     }
+    return result;
+}
 
-    bool isEmpty(){
-        return frontIndex > rearIndex;
+PathResult<string, double> KnowledgeGraph::astarPath(const string &from, const string &to, double heuristicScale) {
+    requireEntity(from);
+    requireEntity(to);
+    // A* gọi position() cho mỗi đỉnh được gán nhãn lần đầu; tra id qua chỉ mục băm của graph
+    EntityGraph &entityGraph = graph;
+    const SpatialIndex &index = positions;
+    return graph.astarPath(from, to, [&entityGraph, &index](const string &entity) -> const Point * {
+        int id = entityGraph.getVertexNode(entity)->getId();
+        return index.has(id) ? &index.get(id) : nullptr;
+    }, heuristicScale);
+}
+
+const NeighborIndex &KnowledgeGraph::neighborSets() {
+    // các truy vấn đọc chạy song song (QueryExecutor): chỉ một luồng dựng chỉ mục, các luồng khác chờ nó xong
+    if (!neighborsBuilt.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(neighborMutex);
+        if (!neighborsBuilt.load(std::memory_order_relaxed)) {
+            neighborIndex.build(graph.snapshot());
+            neighborsBuilt.store(true, std::memory_order_release);
+        }
     }
-};
+    return neighborIndex;
+}
 
-template <class T>
-class Stack
-{
-private:
-    vector<T> data;
+vector<string> KnowledgeGraph::commonNeighbors(const string &entity1, const string &entity2) {
+    int u = requireEntity(entity1)->getId();
+    int v = requireEntity(entity2)->getId();
+    vector<string> result;
+    for (int id : neighborSets().common(u, v)) {
+        result.push_back(graph.vertexAt(id));
+    }
+    return result;
+}
 
-public:
-    Stack() = default;
+double KnowledgeGraph::similarity(const string &entity1, const string &entity2, SimilarityMetric metric) {
+    int u = requireEntity(entity1)->getId();
+    int v = requireEntity(entity2)->getId();
+    return neighborSets().similarity(u, v, metric);
+}
 
-    void push(T item){
-        data.push_back(item);
-    }
+long long KnowledgeGraph::triangleCount(const string &entity) {
+    return neighborSets().triangles(requireEntity(entity)->getId());
+}
 
-    T pop(){
-        T item = data.back();
-        data.pop_back();
-        return item;
-    }
+long long KnowledgeGraph::triangleCount(int threads) {
+    return neighborSets().totalTriangles(threads);
+}
 
-    bool isEmpty(){
-        return data.empty();
+vector<vector<pair<string, double> > > KnowledgeGraph::mostSimilar(const vector<string> &batch, int k, SimilarityMetric metric, int threads) {
+    vector<int> ids;
+    for (const string &entity : batch) {
+        ids.push_back(requireEntity(entity)->getId());
     }
-};
-
-template <class T>
-string DGraphModel<T>::BFS(T start){
-    // Bước 1: ktra đỉnh bắt đầu có tồn tại ko 
-    VertexNode<T> *startNode = getVertexNode(start);
-    if (startNode == nullptr){
-        throw VertexNotFoundException();
-    }
-
-    // Bước 2: Khởi tạo cấu trúc dữ liệu cần thiết cho BFS
-    vector<bool> visited(nodeList.size(), false);       // theo dõi và đánh dấu đỉnh đã thăm
-    vector<VertexNode<T>*> visitOrder;                  // lưu thứ tự các đỉnh được thăm
-    Queue<VertexNode<T> *> queue;                       // hàng đợi để hỗ trợ quá trình duyệt BFS
-
-    // Bước 3: Tìm chỉ số của đỉnh bắt đầu trong nodeList
-    int startIdx = -1;
-    for (size_t i = 0; i < nodeList.size(); i++){
-        if (nodeList[i] == startNode){
-            startIdx = i;
-            break;
-        }
-    }
-
-    // Bước 4: Bắt đầu quá trình duyệt BFS - thêm đỉnh bắt đầu vào hàng đợi và đánh dấu là đã thăm
-    queue.enqueue(startNode);
-    visited[startIdx] = true;
-
-    // Bước 5: Thực hiện duyệt BFS
-    while (!queue.isEmpty()){
-        // Lấy đỉnh hiện tại từ hàng đợi
-        VertexNode<T> *current = queue.dequeue();
-        visitOrder.push_back(current);
-
-        // Duyệt qua tất cả các đỉnh kề (outward neighbors) của đỉnh hiện tại
-        for (auto edge : current->adList){
-            VertexNode<T> *neighbor = edge->to;
-            // Tìm chỉ số của đỉnh kề trong nodeList
-            for (size_t i = 0; i < nodeList.size(); i++) {
-                if (nodeList[i] == neighbor && !visited[i]) {
-                    visited[i] = true;
-                    queue.enqueue(neighbor);
-                    break;
-                }
-            }
+    vector<vector<pair<int, double> > > top = neighborSets().topSimilar(ids, k, metric, threads);
+    vector<vector<pair<string, double> > > result(top.size());
+    for (size_t i = 0; i < top.size(); i++) {
+        for (const pair<int, double> &hit : top[i]) {
+            result[i].push_back(make_pair(graph.vertexAt(hit.first), hit.second));
         }
     }
+    return result;
+}
 
-    // Tạo chuỗi kết quả
-    stringstream ss;
-    ss << "[";
-    for (size_t i = 0; i < visitOrder.size(); i++){
-        if (i > 0) ss << ", ";
-        ss << vertex2Str(*visitOrder[i]); // LUÔN dùng vertex2Str
+vector<double> KnowledgeGraph::pageRank(const PageRankOptions &options) {
+    // điểm tính theo id đỉnh, trả về theo thứ tự trong entities (khác nhau sau reorder())
+    vector<double> byId = ::pageRank(graph.snapshot(), options);
+    const vector<int> &order = graph.insertionOrder();
+    vector<double> scores(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        scores[i] = byId[order[i]];
     }
-    ss << "]";
-    return ss.str();
+    return scores;
 }
 
-template <class T>
-string DGraphModel<T>::DFS(T start){
-    VertexNode<T> *startNode = getVertexNode(start);
-    if (startNode == nullptr){
-        throw VertexNotFoundException();
+vector<pair<string, double> > KnowledgeGraph::topEntities(int k, const PageRankOptions &options) {
+    vector<pair<string, double> > result;
+    for (const pair<int, double> &top : topScores(pageRank(options), k)) {
+        result.push_back(make_pair(entities[top.first], top.second));
     }
+    return result;
+}
 
-    vector<bool> visited(nodeList.size(), false);
-    vector<VertexNode<T>*> visitOrder;
-    Stack<VertexNode<T> *> stack;
-
-    int startIdx = -1;
-    for (size_t i = 0; i < nodeList.size(); i++){
-        if (nodeList[i] == startNode){
-            startIdx = i;
-            break;
-        }
+vector<pair<string, double> > KnowledgeGraph::topEntities(int k, const vector<string> &seeds, const PageRankOptions &options) {
+    PageRankOptions personalized = options;
+    personalized.seeds.clear();
+    for (const string &seed : seeds) {
+        personalized.seeds.push_back(requireEntity(seed)->getId());
     }
+    return topEntities(k, personalized);
+}
 
-    stack.push(startNode);
-    
-    while (!stack.isEmpty()){
-        VertexNode<T> *current = stack.pop();
-        
-        int currentIdx = -1;
-        for (size_t i = 0; i < nodeList.size(); i++){
-            if (nodeList[i] == current){
-                currentIdx = i;
-                break;
-            }
-        }
-        
-        if (visited[currentIdx]) continue;
-        visited[currentIdx] = true;
-        visitOrder.push_back(current);
-        
-        for (int i = current->adList.size() - 1; i >= 0; i--){
-            VertexNode<T> *neighbor = current->adList[i]->to;
-            int neighborIdx = -1;
-            for (size_t j = 0; j < nodeList.size(); j++){
-                if (nodeList[j] == neighbor){
-                    neighborIdx = j;
-                    break;
-                }
-            }
-            if (neighborIdx != -1 && !visited[neighborIdx]){
-                stack.push(neighbor);
-            }
-        }
-    }
-    
-    // Tạo chuỗi kết quả
-    stringstream ss;
-    ss << "[";
-    for (size_t i = 0; i < visitOrder.size(); i++){
-        if (i > 0) ss << ", ";
-        ss << vertex2Str(*visitOrder[i]); // LUÔN dùng vertex2Str
-    }
-    ss << "]";
-    return ss.str();
+vector<string> KnowledgeGraph::topologicalSort() {
+    return graph.topologicalSort();
 }
 
-// =============================================================================
-// Class KnowledgeGraph Implementation
-// =============================================================================
-// Helper function for string comparison
-bool KnowledgeGraph::stringEQ(string &lhs, string &rhs) {
-    // So sánh hai chuỗi lhs và rhs, trả về true nếu chúng bằng nhau, ngược lại false
-    return lhs == rhs;
+vector<string> KnowledgeGraph::topologicalSort(const string &predicate) {
+    return graph.topologicalSort(predicates.find(predicate));
 }
 
-KnowledgeGraph::KnowledgeGraph() : graph(&stringEQ, nullptr) {
-    // Khởi tạo đồ thị tri thức với hàm so sánh chuỗi và hàm chuyển đổi chuỗi
-    // Truyền nullptr để vertex2Str() gọi toString() cho BFS/DFS
+vector<string> KnowledgeGraph::findCycle() {
+    return graph.findCycle();
 }
 
-void KnowledgeGraph::addEntity(string entity) {
-    // TODO: Add a new entity to the Knowledge Graph (thêm thực thể mới vào đồ thị)
-    if (graph.contains(entity)) {
-        throw EntityExistsException();
-    }
-    graph.add(entity);
-    entities.push_back(entity);
+vector<string> KnowledgeGraph::findCycle(const string &predicate) {
+    return graph.findCycle(predicates.find(predicate));
 }
 
-void KnowledgeGraph::addRelation(string from, string to, float weight) {
-    // TODO: Add a directed relation from 'from' entity to 'to' entity with the specified weight
-    if (!graph.contains(from)) {
-        throw EntityNotFoundException();
-    }
-    if (!graph.contains(to)) {
-        throw EntityNotFoundException();
-    }
-    graph.connect(from, to, weight);
+void KnowledgeGraph::enforceAcyclic(bool enabled) {
+    graph.enforceAcyclic(enabled);
 }
 
-vector<string> KnowledgeGraph::getAllEntities() {
-    return entities;
+void KnowledgeGraph::enforceAcyclicOn(const string &predicate) {
+    // intern trước để các bộ ba thêm sau với vị từ này đều được kiểm tra
+    graph.enforceAcyclic(true, predicates.intern(predicate));
 }
 
-vector<string> KnowledgeGraph::getNeighbors(string entity) {
-    if (!graph.contains(entity)) {
-        throw EntityNotFoundException();
-    }
-    // Lấy tất cả các đỉnh kề (outward neighbors) của thực thể đã cho
-    vector<Edge<string>*> edges = graph.getOutwardEdges(entity);
-    vector<string> neighbors;
-    for (auto edge : edges) {
-        VertexNode<string>* toNode = edge->getTo();
-        neighbors.push_back(toNode->getVertex());
-    }
-    return neighbors;
+vector<vector<string> > KnowledgeGraph::stronglyConnectedComponents() {
+    return graph.stronglyConnectedComponents();
 }
 
-string KnowledgeGraph::bfs(string start) {
-    if (!graph.contains(start)) {
-        throw EntityNotFoundException();
-    }
-    return graph.BFS(start);
+vector<vector<string> > KnowledgeGraph::stronglyConnectedComponents(const string &predicate) {
+    return graph.stronglyConnectedComponents(predicates.find(predicate));
 }
 
-string KnowledgeGraph::dfs(string start) {
-    if (!graph.contains(start)) {
-        throw EntityNotFoundException();
+vector<string> KnowledgeGraph::entitiesWithinRadius(const Point &center, double radius) {
+    vector<string> result;
+    for (const pair<double, int> &hit : positions.within(center, radius)) {
+        result.push_back(graph.vertexAt(hit.second));
     }
-    return graph.DFS(start);
+    return result;
 }
 
-bool KnowledgeGraph::isReachable(string from, string to) {
-    if (!graph.contains(from)) {
-        throw EntityNotFoundException();
-    }
-    if (!graph.contains(to)) {
-        throw EntityNotFoundException();
-    }
-    
-    // Use BFS to check reachability
-    vector<bool> visited(entities.size(), false);
-    Queue<string> queue;
-    
-    // Find index of 'from' entity
-    int fromIdx = -1;
-    for (size_t i = 0; i < entities.size(); i++) {
-        if (entities[i] == from) {
-            fromIdx = i;
-            break;
-        }
-    }
-    
-    queue.enqueue(from);
-    visited[fromIdx] = true;
-    
-    while (!queue.isEmpty()) {
-        string current = queue.dequeue();
-        
-        if (current == to) {
-            return true;
-        }
-        // Explore neighbors - outward edges of current entity
-        vector<Edge<string>*> edges = graph.getOutwardEdges(current);
-        for (auto edge : edges) {
-            VertexNode<string>* toNode = edge->getTo();
-            string neighbor = toNode->getVertex();
-            for (size_t i = 0; i < entities.size(); i++) {
-                if (entities[i] == neighbor && !visited[i]) {
-                    visited[i] = true;
-                    queue.enqueue(neighbor);
-                    break;
-                }
-            }
-        }
-    }
-    
-    return false;
+vector<string> KnowledgeGraph::getPredecessors(const string &entity) {
+    requireEntity(entity);
+    return graph.getPredecessors(entity);
 }
 
-string KnowledgeGraph::toString() {
-    return graph.toString();
+vector<string> KnowledgeGraph::getPredecessors(const string &entity, const string &predicate) {
+    requireEntity(entity);
+    return graph.getPredecessors(entity, predicates.find(predicate));
 }
 
-vector<string> KnowledgeGraph::getRelatedEntities(string entity, int depth) {
-    // TODO: Return all entities related to the given entity within the specified depth (use BFS)
-    if (!graph.contains(entity)) {
-        throw EntityNotFoundException();
-    }
-    
+string KnowledgeGraph::reverseBfs(const string &start) {
+    requireEntity(start);
+    return graph.reverseBFS(start);
+}
+
+string KnowledgeGraph::reverseDfs(const string &start) {
+    requireEntity(start);
+    return graph.reverseDFS(start);
+}
+
+vector<string> KnowledgeGraph::getAncestors(const string &entity, int depth) {
+    // các thực thể có đường đi tới entity trong vòng depth bước (BFS trên cạnh đi vào)
+    return related(requireEntity(entity), depth, PredicateTable::ANY, true);
+}
+
+vector<string> KnowledgeGraph::getAncestors(const string &entity, int depth, const string &predicate) {
+    return related(requireEntity(entity), depth, predicates.find(predicate), true);
+}
+
+vector<string> KnowledgeGraph::related(EntityNode *startNode, int depth, int predicate, bool reverse, const vector<bool> *region) {
     vector<string> result; // to store related entities
-    vector<bool> visited(entities.size(), false); // to track visited entities
-    Queue<pair<string, int>> queue; // queue to perform BFS, storing pairs of (entity, current depth)
+    vector<bool> visited(graph.size(), false); // to track visited entities (theo id của đỉnh)
+    Queue<pair<EntityNode*, int>> queue; // queue to perform BFS, storing pairs of (entity node, current depth)
     
-    // Find index of entity
-    int entityIdx = -1;
-    for (size_t i = 0; i < entities.size(); i++) {
-        if (entities[i] == entity) {
-            entityIdx = i;
-            break;
-        }
-    }
     // Start BFS (khởi tạo)
-    queue.enqueue(make_pair(entity, 0)); // enqueue starting entity with depth 0
-    visited[entityIdx] = true; // mark starting entity as visited
+    queue.enqueue(make_pair(startNode, 0)); // enqueue starting entity with depth 0
+    visited[startNode->getId()] = true; // mark starting entity as visited
     // BFS loop
     while (!queue.isEmpty()) {
-        pair<string, int> current = queue.dequeue();
-        string currentEntity = current.first; // current entity
+        pair<EntityNode*, int> current = queue.dequeue();
+        EntityNode* currentNode = current.first; // current entity
         int currentDepth = current.second; // current depth
         // If current depth reached the specified depth, skip further exploration
         if (currentDepth >= depth) {
             continue;
         }
         
-        vector<Edge<string>*> edges = graph.getOutwardEdges(currentEntity);
+        ArrayView<EntityEdge*> edges = reverse ? currentNode->getInList(predicate) : currentNode->getAdList(predicate);
         for (auto edge : edges) {
-            VertexNode<string>* toNode = edge->getTo();
-            string neighbor = toNode->getVertex();
-            int neighborIdx = -1;
-            for (size_t i = 0; i < entities.size(); i++) {
-                if (entities[i] == neighbor) {
-                    neighborIdx = i;
-                    break;
+            EntityNode* neighbor = reverse ? edge->getFrom() : edge->getTo();
+            if (!visited[neighbor->getId()]) {
+                visited[neighbor->getId()] = true;
+                if (region == nullptr || (*region)[neighbor->getId()]) {
+                    result.push_back(neighbor->getVertex());
                 }
-            }
-            
-            if (neighborIdx != -1 && !visited[neighborIdx]) {
-                visited[neighborIdx] = true;
-                result.push_back(neighbor);
                 queue.enqueue(make_pair(neighbor, currentDepth + 1));
             }
         }
@@ -737,13 +795,9 @@ vector<string> KnowledgeGraph::getRelatedEntities(string entity, int depth) {
     return result;
 }
 
-string KnowledgeGraph::findCommonAncestors(string entity1, string entity2) {
-    if (!graph.contains(entity1)) {
-        throw EntityNotFoundException();
-    }
-    if (!graph.contains(entity2)) {
-        throw EntityNotFoundException();
-    }
+string KnowledgeGraph::findCommonAncestors(const string &entity1, const string &entity2) {
+    requireEntity(entity1);
+    requireEntity(entity2);
     
     // Special case: same entity
     if (entity1 == entity2) {
@@ -760,84 +814,37 @@ string KnowledgeGraph::findCommonAncestors(string entity1, string entity2) {
         return entity2;
     }
     
-    // Helper function to get index of entity
-    auto getIndex = [&](const string& entity) -> int {
-        for (size_t i = 0; i < entities.size(); i++) {
-            if (entities[i] == entity) {
-                return i;
-            }
-        }
-        return -1;
-    };
-    
-    // Helper function to compute shortest weighted distance
-    auto getShortestDistance = [&](const string& from, const string& to) -> float {
-        int n = entities.size();
-        vector<float> dist(n, 1e9); // khoảng cách tới mỗi đỉnh ban đầu vô hạn
-        vector<bool> visited(n, false);
-        
-        int fromIdx = getIndex(from);
-        int toIdx = getIndex(to);
-        
-        if (fromIdx == -1 || toIdx == -1) return 1e9;
-        
-        dist[fromIdx] = 0; // khoảng cách từ đỉnh nguồn tới chính nó là 0
-        
-        // Dijkstra's algorithm
-        for (int i = 0; i < n; i++) {
-            // Find unvisited node with minimum distance
-            int u = -1;
-            float minDist = 1e9;
-            for (int j = 0; j < n; j++) {
-                if (!visited[j] && dist[j] < minDist) {
-                    minDist = dist[j];
-                    u = j;
-                }
-            }
-            
-            if (u == -1 || minDist == 1e9) break;
-            visited[u] = true;
-            
-            if (u == toIdx) break; // Reached destination
-            
-            // Get outward edges from current node => cập nhật khoảng cách cho các đỉnh kề
-            vector<Edge<string>*> edges = graph.getOutwardEdges(entities[u]);
-            for (auto edge : edges) {
-                string neighbor = edge->getTo()->getVertex();
-                int vIdx = getIndex(neighbor);
-                if (vIdx != -1) {
-                    float weight = edge->getWeight();
-                    if (dist[u] + weight < dist[vIdx]) {
-                        dist[vIdx] = dist[u] + weight;
-                    }
-                }
-            }
-        }
-        
-        return dist[toIdx];
-    };
+    // Khoảng cách ngắn nhất từ mọi thực thể TỚI entity1 / entity2: hai lần tìm đường trên cạnh đi vào
+    // thay cho việc chạy Dijkstra từ từng ứng viên (bảng đánh theo id đỉnh của thực thể entities[i])
+    vector<double> toEntity1, toEntity2;
+    try {
+        toEntity1 = graph.distanceTable(entity1, PredicateTable::ANY, true);
+        toEntity2 = graph.distanceTable(entity2, PredicateTable::ANY, true);
+    } catch (const NegativeCycleException &) {
+        // các thực thể đi vòng qua chu trình âm được coi như không tới được, những thực thể khác giữ khoảng cách thật
+        toEntity1 = graph.finiteDistanceTable(entity1, PredicateTable::ANY, true);
+        toEntity2 = graph.finiteDistanceTable(entity2, PredicateTable::ANY, true);
+    }
+    const vector<int> &ids = graph.insertionOrder();
     
     // Find all common ancestors with their total weighted distances
     string lca = "";
-    float minTotalDist = 1e9;
+    double minTotalDist = 0;
     
-    for (const string& candidate : entities) {
+    for (size_t i = 0; i < entities.size(); i++) {
+        const string& candidate = entities[i];
         if (candidate == entity1 || candidate == entity2) continue;
         
         // Check if candidate can reach both entities
-        if (isReachable(candidate, entity1) && isReachable(candidate, entity2)) {
-            float dist1 = getShortestDistance(candidate, entity1);
-            float dist2 = getShortestDistance(candidate, entity2);
+        int id = ids[i];
+        if (toEntity1[id] != EntityGraph::unreachable() && toEntity2[id] != EntityGraph::unreachable()) {
+            double totalDist = toEntity1[id] + toEntity2[id];
             
-            if (dist1 < 1e9 && dist2 < 1e9) {
-                float totalDist = dist1 + dist2;
-                
-                // Choose candidate with smaller total distance
-                // Or if equal, keep the later one (iterate through entities in order)
-                if (totalDist <= minTotalDist) {
-                    minTotalDist = totalDist;
-                    lca = candidate;
-                }
+            // Choose candidate with smaller total distance
+            // Or if equal, keep the later one (iterate through entities in order)
+            if (lca.empty() || totalDist <= minTotalDist) {
+                minTotalDist = totalDist;
+                lca = candidate;
             }
         }
     }
@@ -850,19 +857,240 @@ string KnowledgeGraph::findCommonAncestors(string entity1, string entity2) {
 }
 
 // =============================================================================
-// Explicit Template Instantiation
+// Truy vấn mẫu đồ thị (basic graph pattern)
 // =============================================================================
-template class Edge<string>;
-template class Edge<int>;
-template class Edge<float>;
-template class Edge<char>;
-
-template class VertexNode<string>;
-template class VertexNode<int>;
-template class VertexNode<float>;
-template class VertexNode<char>;
-
-template class DGraphModel<string>;
-template class DGraphModel<int>;
-template class DGraphModel<float>;
-template class DGraphModel<char>;
\ No newline at end of file
+struct KnowledgeGraph::QueryPlan
+{
+    struct Pattern
+    {
+        int subject, object;             // chỉ số biến, -1 nếu là hằng
+        EntityNode *subjectNode, *objectNode;
+        int predicate;
+    };
+
+    vector<string> variables;
+    vector<Pattern> patterns;            // chỉ các mẫu có biến
+    vector<int> order;                   // biến theo thứ tự gán
+    vector<int> position;                // position[biến] = vị trí trong order
+    vector<vector<int> > uses;           // các mẫu chứa từng biến
+    bool empty;                          // chắc chắn không có kết quả
+    vector<EntityNode *> binding;
+    vector<string> values;
+    vector<vector<unsigned int> > seen;  // khử trùng ứng viên khi danh sách kề là "*" (theo mức)
+    vector<unsigned int> stamp;
+};
+
+template <class Node>
+bool hasEdge(Node *from, Node *to, int predicate) {
+    // quét danh sách ngắn hơn trong (cạnh ra của from, cạnh vào của to)
+    auto out = from->getAdList(predicate);
+    auto in = to->getInList(predicate);
+    if (out.size() <= in.size()) {
+        for (auto edge : out) {
+            if (edge->getTo() == to) return true;
+        }
+    } else {
+        for (auto edge : in) {
+            if (edge->getFrom() == from) return true;
+        }
+    }
+    return false;
+}
+
+vector<string> KnowledgeGraph::queryVariables(const vector<TriplePattern> &patterns) {
+    vector<string> variables;
+    for (const TriplePattern &pattern : patterns) {
+        const string *terms[] = {&pattern.subject, &pattern.object};
+        for (const string *term : terms) {
+            if (TriplePattern::isVariable(*term) && std::find(variables.begin(), variables.end(), *term) == variables.end()) {
+                variables.push_back(*term);
+            }
+        }
+    }
+    return variables;
+}
+
+void KnowledgeGraph::compile(const vector<TriplePattern> &patterns, QueryPlan &plan) {
+    plan.variables = queryVariables(patterns);
+    plan.empty = false;
+    plan.uses.assign(plan.variables.size(), vector<int>());
+    for (const TriplePattern &pattern : patterns) {
+        QueryPlan::Pattern compiled;
+        compiled.subject = compiled.object = -1;
+        compiled.subjectNode = compiled.objectNode = nullptr;
+        if (TriplePattern::isVariable(pattern.subject)) {
+            compiled.subject = std::find(plan.variables.begin(), plan.variables.end(), pattern.subject) - plan.variables.begin();
+        } else {
+            compiled.subjectNode = requireEntity(pattern.subject);
+        }
+        if (TriplePattern::isVariable(pattern.object)) {
+            compiled.object = std::find(plan.variables.begin(), plan.variables.end(), pattern.object) - plan.variables.begin();
+        } else {
+            compiled.objectNode = requireEntity(pattern.object);
+        }
+        compiled.predicate = pattern.predicate == "*" ? PredicateTable::ANY : predicates.find(pattern.predicate);
+        if (compiled.predicate == PredicateTable::UNKNOWN) {
+            plan.empty = true;
+        } else if (compiled.subject < 0 && compiled.object < 0) {
+            plan.empty = plan.empty || !hasEdge(compiled.subjectNode, compiled.objectNode, compiled.predicate);
+        } else {
+            int index = plan.patterns.size();
+            plan.patterns.push_back(compiled);
+            if (compiled.subject >= 0) plan.uses[compiled.subject].push_back(index);
+            if (compiled.object >= 0 && compiled.object != compiled.subject) plan.uses[compiled.object].push_back(index);
+        }
+    }
+
+    // chọn tham lam biến có ít ứng viên ước lượng nhất cho mỗi bộ gán hiện có
+    int n = plan.variables.size();
+    plan.position.assign(n, n);
+    plan.order.clear();
+    PredicateStats none;
+    for (int step = 0; step < n; step++) {
+        int best = -1;
+        double bestEstimate = 0;
+        for (int v = 0; v < n; v++) {
+            if (plan.position[v] < n) continue;
+            double estimate = std::numeric_limits<double>::infinity();
+            for (int index : plan.uses[v]) {
+                const QueryPlan::Pattern &pattern = plan.patterns[index];
+                const PredicateStats &stats = pattern.predicate == PredicateTable::ANY ? anyStats
+                    : static_cast<size_t>(pattern.predicate) < predicateStats.size() ? predicateStats[pattern.predicate] : none;
+                bool isSubject = pattern.subject == v;
+                int other = isSubject ? pattern.object : pattern.subject;
+                double candidates;
+                if (other == v) {
+                    candidates = stats.subjects; // ?x p ?x
+                } else if (other < 0) {
+                    candidates = isSubject ? pattern.objectNode->getInList(pattern.predicate).size()
+                                           : pattern.subjectNode->getAdList(pattern.predicate).size();
+                } else if (plan.position[other] < n) {
+                    candidates = isSubject ? static_cast<double>(stats.edges) / std::max<size_t>(1, stats.objects)
+                                           : static_cast<double>(stats.edges) / std::max<size_t>(1, stats.subjects);
+                } else {
+                    candidates = isSubject ? stats.subjects : stats.objects;
+                }
+                estimate = std::min(estimate, candidates);
+            }
+            if (best < 0 || estimate < bestEstimate) {
+                best = v;
+                bestEstimate = estimate;
+            }
+        }
+        plan.position[best] = step;
+        plan.order.push_back(best);
+    }
+    plan.binding.assign(n, nullptr);
+    plan.values.assign(n, "");
+    plan.seen.assign(n, vector<unsigned int>());
+    plan.stamp.assign(n, 0);
+}
+
+bool KnowledgeGraph::extend(QueryPlan &plan, size_t depth, const std::function<bool(const vector<string> &)> &emit) {
+    if (depth == plan.order.size()) {
+        for (size_t v = 0; v < plan.binding.size(); v++) {
+            plan.values[v] = plan.binding[v]->getVertex();
+        }
+        return emit(plan.values);
+    }
+    int v = plan.order[depth];
+    auto bound = [&plan, depth](int variable) { return variable < 0 || plan.position[variable] < static_cast<int>(depth); };
+    auto node = [&plan](int variable, EntityNode *constant) { return variable < 0 ? constant : plan.binding[variable]; };
+
+    // nguồn ứng viên: danh sách kề ngắn nhất trong các mẫu có đầu kia đã gán
+    int driver = -1;
+    ArrayView<EntityEdge *> candidates;
+    bool driverIsSubject = false;
+    for (int index : plan.uses[v]) {
+        const QueryPlan::Pattern &pattern = plan.patterns[index];
+        if (pattern.subject == pattern.object) continue;
+        bool isSubject = pattern.subject == v;
+        if (!bound(isSubject ? pattern.object : pattern.subject)) continue;
+        ArrayView<EntityEdge *> edges = isSubject ? node(pattern.object, pattern.objectNode)->getInList(pattern.predicate)
+                                                  : node(pattern.subject, pattern.subjectNode)->getAdList(pattern.predicate);
+        if (driver < 0 || edges.size() < candidates.size()) {
+            driver = index;
+            candidates = edges;
+            driverIsSubject = isSubject;
+        }
+    }
+
+    // thử một ứng viên: mọi mẫu khác chứa v có đầu kia đã gán (hoặc chính là v) phải có cạnh
+    auto accept = [&](EntityNode *candidate) {
+        plan.binding[v] = candidate;
+        for (int index : plan.uses[v]) {
+            const QueryPlan::Pattern &pattern = plan.patterns[index];
+            if (index == driver) continue;
+            int other = pattern.subject == v ? pattern.object : pattern.subject;
+            if (other != v && !bound(other)) continue;
+            if (!hasEdge(node(pattern.subject, pattern.subjectNode), node(pattern.object, pattern.objectNode), pattern.predicate)) {
+                return true; // bỏ qua ứng viên, tiếp tục
+            }
+        }
+        return extend(plan, depth + 1, emit);
+    };
+
+    if (driver < 0) {
+        // biến đầu tiên của một thành phần: mọi thực thể có cạnh phù hợp ở mẫu đầu tiên chứa v
+        const QueryPlan::Pattern &pattern = plan.patterns[plan.uses[v][0]];
+        bool isSubject = pattern.subject == v;
+        for (int id : graph.insertionOrder()) {
+            EntityNode *candidate = graph.nodeAt(id);
+            if ((isSubject ? candidate->getAdList(pattern.predicate) : candidate->getInList(pattern.predicate)).empty()) continue;
+            if (!accept(candidate)) return false;
+        }
+        return true;
+    }
+
+    // với "*" cùng một đỉnh có thể xuất hiện nhiều lần (nhiều vị từ) trong danh sách kề
+    bool dedup = plan.patterns[driver].predicate == PredicateTable::ANY;
+    if (dedup) {
+        plan.seen[depth].resize(graph.size(), 0);
+        if (++plan.stamp[depth] == 0) {
+            std::fill(plan.seen[depth].begin(), plan.seen[depth].end(), 0);
+            plan.stamp[depth] = 1;
+        }
+    }
+    for (auto edge : candidates) {
+        EntityNode *candidate = driverIsSubject ? edge->getFrom() : edge->getTo();
+        if (dedup) {
+            unsigned int &mark = plan.seen[depth][candidate->getId()];
+            if (mark == plan.stamp[depth]) continue;
+            mark = plan.stamp[depth];
+        }
+        if (!accept(candidate)) return false;
+    }
+    return true;
+}
+
+void KnowledgeGraph::query(const vector<TriplePattern> &patterns, const std::function<bool(const vector<string> &)> &emit) {
+    QueryPlan plan;
+    compile(patterns, plan);
+    if (plan.empty) {
+        return;
+    }
+    if (plan.order.empty()) {
+        emit(plan.values); // chỉ có mẫu hằng và tất cả đều khớp
+        return;
+    }
+    extend(plan, 0, emit);
+}
+
+vector<vector<string> > KnowledgeGraph::select(const vector<TriplePattern> &patterns, size_t limit) {
+    vector<vector<string> > rows;
+    query(patterns, [&rows, limit](const vector<string> &values) {
+        rows.push_back(values);
+        return limit == 0 || rows.size() < limit;
+    });
+    return rows;
+}
+
+vector<string> KnowledgeGraph::queryPlan(const vector<TriplePattern> &patterns) {
+    QueryPlan plan;
+    compile(patterns, plan);
+    vector<string> order;
+    for (int v : plan.order) {
+        order.push_back(plan.variables[v]);
+    }
+    return order;
+}
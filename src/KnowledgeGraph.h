@@ -2,46 +2,674 @@
 #define KNOWLEDGEGRAPH_H
 
 #include "main.h"
+#include "SpatialIndex.h"
+#include "NeighborIndex.h"
+#include "CompressedAdjacency.h"
+#include <set>
+#include <atomic>
+#include <mutex>
+
+// =====================================
+// Vertex policies
+// =====================================
+// So sánh / băm / định dạng đỉnh được chọn lúc biên dịch (template) để trình biên dịch có thể inline.
+// Bộ mặc định FunctionPointer* giữ nguyên hành vi cũ: con trỏ hàm truyền lúc chạy, nullptr thì dùng
+// operator== / operator<<. Policy so sánh cần có isIdentity() (true nếu tương đương operator==).
 
-// Forward declaration
 template <class T>
-class VertexNode;
+struct FunctionPointerEqual
+{
+    typedef bool (*argument_type)(T &, T &);
+    argument_type fn;
+
+    FunctionPointerEqual(argument_type fn = nullptr) : fn(fn) {}
+    // con trỏ hàm của người dùng nhận T& (chữ ký cũ) nhưng không được sửa giá trị đỉnh
+    bool operator()(const T &lhs, const T &rhs) const { return fn != nullptr ? fn(const_cast<T &>(lhs), const_cast<T &>(rhs)) : lhs == rhs; }
+    // true khi phép so sánh chính là operator== (chỉ khi không truyền con trỏ hàm)
+    bool isIdentity() const { return fn == nullptr; }
+};
+
+template <class T>
+struct NativeEqual
+{
+    typedef std::nullptr_t argument_type;
+
+    NativeEqual(argument_type = nullptr) {}
+    bool operator()(const T &lhs, const T &rhs) const { return lhs == rhs; }
+    bool isIdentity() const { return true; }
+};
+
+template <class T>
+struct FunctionPointerFormat
+{
+    typedef string (*argument_type)(T &);
+    argument_type fn;
+
+    FunctionPointerFormat(argument_type fn = nullptr) : fn(fn) {}
+    bool enabled() const { return fn != nullptr; }
+    string operator()(const T &value) const { return fn(const_cast<T &>(value)); }
+};
+
+// Không có hàm định dạng: Edge in giá trị bằng operator<<, vertex2Str() trả về toString() của đỉnh
+template <class T>
+struct NoFormat
+{
+    typedef std::nullptr_t argument_type;
+
+    NoFormat(argument_type = nullptr) {}
+    bool enabled() const { return false; }
+    string operator()(const T &) const { return string(); }
+};
+
+// Không có hàm băm: getVertexNode() tìm tuyến tính như cũ
+template <class T>
+struct NoHash
+{
+    static const bool enabled = false;
+    size_t operator()(const T &) const { return 0; }
+};
+
+// Hàm băm phải nhất quán với phép so sánh (hai đỉnh bằng nhau => cùng giá trị băm)
+template <class T>
+struct NativeHash
+{
+    static const bool enabled = true;
+    size_t operator()(const T &value) const { return std::hash<T>()(value); }
+};
+
+template <class T, class Equal = FunctionPointerEqual<T>, class Hash = NoHash<T>, class Format = FunctionPointerFormat<T> >
+struct VertexPolicy
+{
+    typedef Equal equal_type;
+    typedef Hash hash_type;
+    typedef Format format_type;
+};
+
+// Đỉnh int/char/string...: operator==, std::hash và operator<<, tất cả đều inline được
 template <class T>
+struct NativeVertexPolicy : public VertexPolicy<T, NativeEqual<T>, NativeHash<T>, NoFormat<T> >
+{
+};
+
+// =====================================
+// Weight policies
+// =====================================
+// Cách lưu trọng số cạnh được chọn lúc biên dịch. Mỗi policy cung cấp:
+//   value_type    - kiểu trọng số ở API (connect(), weight(), getWeight())
+//   distance_type - kiểu dùng để cộng dồn khoảng cách trong các thuật toán có trọng số
+//   slot_type     - phần dữ liệu nằm trong mỗi Edge (rỗng với Unweighted => Edge chỉ còn 2 con trỏ)
+
+// Đồ thị chỉ quan tâm cấu trúc: không lưu trọng số, mỗi cạnh có chi phí 1 (một bước nhảy)
+struct Unweighted
+{
+    typedef float value_type;
+    typedef unsigned int distance_type;
+    struct slot_type
+    {
+    };
+
+    static value_type read(const slot_type &) { return 1; }
+    static void write(slot_type &, value_type) {}
+};
+
+template <class V, class D>
+struct PlainWeight
+{
+    typedef V value_type;
+    typedef D distance_type;
+    struct slot_type
+    {
+        V stored;
+    };
+
+    static value_type read(const slot_type &slot) { return slot.stored; }
+    static void write(slot_type &slot, value_type weight) { slot.stored = weight; }
+};
+
+typedef PlainWeight<float, double> FloatWeight;
+typedef PlainWeight<double, double> DoubleWeight;
+
+// Trọng số lượng tử hóa: lưu round(weight * Scale) trong S (uint8_t/uint16_t), bị kẹp vào [0, max của S]
+template <class S, int Scale = 1>
+struct QuantizedWeight
+{
+    typedef float value_type;
+    typedef double distance_type;
+    struct slot_type
+    {
+        S stored;
+    };
+
+    static value_type read(const slot_type &slot) { return static_cast<value_type>(slot.stored) / Scale; }
+    static void write(slot_type &slot, value_type weight)
+    {
+        double level = std::floor(static_cast<double>(weight) * Scale + 0.5);
+        double maxLevel = static_cast<double>(std::numeric_limits<S>::max());
+        slot.stored = static_cast<S>(level < 0 ? 0 : (level > maxLevel ? maxLevel : level));
+    }
+};
+
+typedef QuantizedWeight<uint8_t> UInt8Weight;
+typedef QuantizedWeight<uint16_t> UInt16Weight;
+
+// Forward declaration
+template <class T, class P = VertexPolicy<T>, class W = FloatWeight>
+class Edge;
+template <class T, class P = VertexPolicy<T>, class W = FloatWeight>
+class VertexNode;
+template <class T, class P = VertexPolicy<T>, class W = FloatWeight>
 class DGraphModel;
+template <class K>
+class IndexedMinHeap;
 
 // =====================================
-// Class Edge
+// Struct MemoryUsage
+// =====================================
+// Bảng thống kê bộ nhớ (tính theo byte) của đồ thị, dùng để ước lượng cấu hình máy chủ.
+// Không tính phần overhead của bộ cấp phát (malloc header, làm tròn kích thước khối).
+struct MemoryUsage
+{
+    size_t vertexPayload;  // sizeof(T) của mỗi đỉnh + vùng heap mà giá trị sở hữu (vd: buffer của string)
+    size_t vertexNodes;    // phần còn lại của đối tượng VertexNode (bậc, vector header, con trỏ hàm)
+    size_t edges;          // các đối tượng Edge trên heap
+    size_t adListUsed;     // số slot đang dùng của adList (byte)
+    size_t adListSlack;    // capacity - size của adList (byte)
+    size_t adListFullUsed; // số slot đang dùng của adListFull (byte)
+    size_t adListFullSlack;
+    size_t inListUsed;     // danh sách cạnh đi vào (byte)
+    size_t inListSlack;
+    size_t indexes;        // nodeList và các cấu trúc chỉ mục khác (kể cả phần slack)
+
+    MemoryUsage();
+    size_t total() const;
+    size_t slack() const;
+    MemoryUsage &operator+=(const MemoryUsage &other);
+    string toString() const;
+};
+
+// =====================================
+// Struct PathResult
+// =====================================
+// Kết quả truy vấn đường đi: found = false nếu không tới được (khi đó path rỗng)
+template <class T, class D>
+struct PathResult
+{
+    bool found;
+    D distance;
+    vector<T> path; // from, ..., to
+    int expanded;   // số đỉnh đã chốt trong lúc tìm (chỉ các truy vấn điểm - điểm thống kê)
+
+    PathResult() : found(false), distance(D()), expanded(0) {}
+};
+
+// =====================================
+// Struct LandmarkTable
+// =====================================
+// Bảng landmark cho ALT (A* + landmark + bất đẳng thức tam giác): khoảng cách từ / tới mỗi landmark,
+// đánh theo id đỉnh. Tính trước (DGraphModel::buildLandmarks) rồi lưu / nạp bằng save() / load();
+// bảng nạp lại phải qua DGraphModel::bindLandmarks() (so dấu vân tay) mới được dùng.
+template <class D>
+struct LandmarkTable
+{
+    size_t vertexCount; // kích thước đồ thị lúc tính bảng
+    size_t edgeCount;
+    unsigned long long fingerprint; // DGraphModel::fingerprint() lúc tính bảng, được lưu cùng bảng
+    unsigned long long revision;    // phiên bản đồ thị đã khớp bảng (không lưu; 0: chưa gắn với đồ thị nào)
+    vector<int> landmarks;           // id các đỉnh được chọn làm landmark
+    vector<vector<D> > fromLandmark; // [k][v] = d(landmarks[k], v)
+    vector<vector<D> > toLandmark;   // [k][v] = d(v, landmarks[k])
+
+    LandmarkTable() : vertexCount(0), edgeCount(0), fingerprint(0), revision(0) {}
+
+    static D unreachable() { return std::numeric_limits<D>::max(); }
+    bool empty() const { return landmarks.empty(); }
+    void clear();
+
+    // cận dưới của d(v, t); unreachable() nếu chắc chắn v không tới được t
+    D lowerBound(int v, int t) const;
+
+    void save(ostream &out) const;
+    bool load(istream &in); // false nếu dữ liệu hỏng (khi đó bảng bị xóa)
+};
+
+template <class D>
+void LandmarkTable<D>::clear(){
+    vertexCount = edgeCount = 0;
+    fingerprint = revision = 0;
+    landmarks.clear();
+    fromLandmark.clear();
+    toLandmark.clear();
+}
+
+template <class D>
+D LandmarkTable<D>::lowerBound(int v, int t) const{
+    // d(L, t) <= d(L, v) + d(v, t)  và  d(v, L) <= d(v, t) + d(t, L)
+    D bound = 0;
+    for (size_t k = 0; k < landmarks.size(); k++){
+        const vector<D> &from = fromLandmark[k];
+        const vector<D> &to = toLandmark[k];
+        if (from[v] != unreachable()){
+            if (from[t] == unreachable())
+                return unreachable(); // L tới được v mà không tới được t
+            if (from[t] > from[v] && from[t] - from[v] > bound)
+                bound = from[t] - from[v];
+        }
+        if (to[t] != unreachable()){
+            if (to[v] == unreachable())
+                return unreachable(); // t tới được L mà v thì không
+            if (to[v] > to[t] && to[v] - to[t] > bound)
+                bound = to[v] - to[t];
+        }
+    }
+    return bound;
+}
+
+template <class D>
+void LandmarkTable<D>::save(ostream &out) const{
+    // định dạng văn bản: "landmarks <số landmark> <số đỉnh> <số cạnh> <dấu vân tay>", dòng id landmark,
+    // rồi mỗi landmark hai dòng khoảng cách (từ landmark, tới landmark)
+    std::streamsize precision = out.precision(std::numeric_limits<D>::max_digits10);
+    out << "landmarks " << landmarks.size() << ' ' << vertexCount << ' ' << edgeCount << ' ' << fingerprint << '\n';
+    for (size_t k = 0; k < landmarks.size(); k++){
+        out << (k > 0 ? " " : "") << landmarks[k];
+    }
+    out << '\n';
+    for (size_t k = 0; k < landmarks.size(); k++){
+        for (size_t v = 0; v < vertexCount; v++){
+            out << (v > 0 ? " " : "") << fromLandmark[k][v];
+        }
+        out << '\n';
+        for (size_t v = 0; v < vertexCount; v++){
+            out << (v > 0 ? " " : "") << toLandmark[k][v];
+        }
+        out << '\n';
+    }
+    out.precision(precision);
+}
+
+template <class D>
+bool LandmarkTable<D>::load(istream &in){
+    clear();
+    string tag;
+    size_t count = 0;
+    if (!(in >> tag >> count >> vertexCount >> edgeCount >> fingerprint) || tag != "landmarks"){
+        clear();
+        return false;
+    }
+    landmarks.resize(count);
+    fromLandmark.assign(count, vector<D>(vertexCount));
+    toLandmark.assign(count, vector<D>(vertexCount));
+    for (size_t k = 0; k < count; k++){
+        in >> landmarks[k];
+        if (!in || landmarks[k] < 0 || static_cast<size_t>(landmarks[k]) >= vertexCount){
+            clear();
+            return false;
+        }
+    }
+    for (size_t k = 0; k < count && in; k++){
+        for (size_t v = 0; v < vertexCount; v++) in >> fromLandmark[k][v];
+        for (size_t v = 0; v < vertexCount; v++) in >> toLandmark[k][v];
+    }
+    if (!in){
+        clear();
+        return false;
+    }
+    return true;
+}
+
+// =====================================
+// Struct AdjacencySnapshot
+// =====================================
+// Ảnh chụp danh sách kề dạng CSR (mảng liên tục) theo id đỉnh, cho các thuật toán duyệt toàn đồ thị
+// nhiều lần (PageRank...). Cạnh đi ra của v: outTargets/outWeights trong [outOffsets[v], outOffsets[v + 1]),
+// cạnh đi vào tương tự với in*. Không tự cập nhật khi đồ thị thay đổi.
+template <class V>
+struct AdjacencySnapshot
+{
+    vector<int> outOffsets;
+    vector<int> outTargets;
+    vector<V> outWeights;
+    vector<int> inOffsets;
+    vector<int> inSources;
+    vector<V> inWeights;
+
+    AdjacencySnapshot() : outOffsets(1, 0), inOffsets(1, 0) {}
+
+    int vertexCount() const { return outOffsets.size() - 1; }
+    int edgeCount() const { return outTargets.size(); }
+    int outDegree(int v) const { return outOffsets[v + 1] - outOffsets[v]; }
+    int inDegree(int v) const { return inOffsets[v + 1] - inOffsets[v]; }
+};
+
+// =====================================
+// PageRank
+// =====================================
+struct PageRankOptions
+{
+    double damping;     // xác suất đi theo cạnh (1 - damping: nhảy ngẫu nhiên)
+    double tolerance;   // dừng khi tổng |rank mới - rank cũ| < tolerance
+    int maxIterations;
+    bool weighted;      // chia rank theo trọng số cạnh (trọng số âm coi là 0) thay vì đều theo bậc ra
+    int threads;
+    vector<int> seeds;  // personalized PageRank: nhảy ngẫu nhiên về các id này (rỗng = mọi đỉnh)
+
+    PageRankOptions() : damping(0.85), tolerance(1e-10), maxIterations(100), weighted(false), threads(1) {}
+};
+
+// PageRank kiểu "pull": mỗi đỉnh cộng phần rank từ các cạnh đi vào, nên các luồng chỉ ghi vào khoảng
+// đỉnh của mình (không cần khóa). Rank của đỉnh không có cạnh ra được chia theo vector nhảy ngẫu nhiên.
+template <class V>
+vector<double> pageRank(const AdjacencySnapshot<V> &graph, const PageRankOptions &options)
+{
+    int n = graph.vertexCount();
+    vector<double> rank(n, 0), next(n, 0), share(n, 0), teleport(n, 0), outSum(n, 0);
+    if (n == 0)
+        return rank;
+    if (options.seeds.empty()){
+        teleport.assign(n, 1.0 / n);
+    }
+    else {
+        for (int seed : options.seeds){
+            if (seed < 0 || seed >= n)
+                throw VertexNotFoundException();
+            teleport[seed] += 1.0 / options.seeds.size();
+        }
+    }
+    for (int u = 0; u < n; u++){
+        if (!options.weighted){
+            outSum[u] = graph.outDegree(u);
+            continue;
+        }
+        for (int e = graph.outOffsets[u]; e < graph.outOffsets[u + 1]; e++){
+            outSum[u] += std::max(0.0, static_cast<double>(graph.outWeights[e]));
+        }
+    }
+
+    int threads = std::max(1, std::min(options.threads, n));
+    vector<double> partial(threads, 0);
+    double damping = options.damping;
+    bool weighted = options.weighted;
+    rank = teleport;
+    for (int iteration = 0; iteration < options.maxIterations; iteration++){
+        // bước 1: phần rank mỗi đỉnh gửi đi trên một đơn vị trọng số, cộng dồn rank của đỉnh cụt
+        parallelFor(n, threads, [&](int begin, int end, int part){
+            double dangling = 0;
+            for (int u = begin; u < end; u++){
+                if (outSum[u] > 0){
+                    share[u] = rank[u] / outSum[u];
+                }
+                else {
+                    share[u] = 0;
+                    dangling += rank[u];
+                }
+            }
+            partial[part] = dangling;
+        });
+        double dangling = 0;
+        for (double value : partial){
+            dangling += value;
+        }
+
+        // bước 2: mỗi đỉnh kéo rank từ các cạnh đi vào
+        parallelFor(n, threads, [&](int begin, int end, int part){
+            double change = 0;
+            for (int v = begin; v < end; v++){
+                double sum = 0;
+                for (int e = graph.inOffsets[v]; e < graph.inOffsets[v + 1]; e++){
+                    double weight = weighted ? std::max(0.0, static_cast<double>(graph.inWeights[e])) : 1.0;
+                    sum += share[graph.inSources[e]] * weight;
+                }
+                next[v] = (1 - damping) * teleport[v] + damping * (sum + dangling * teleport[v]);
+                change += std::fabs(next[v] - rank[v]);
+            }
+            partial[part] = change;
+        });
+        rank.swap(next);
+        double change = 0;
+        for (double value : partial){
+            change += value;
+        }
+        if (change < options.tolerance)
+            break;
+    }
+    return rank;
+}
+
+// =====================================
+// Multi-source BFS
+// =====================================
+// MS-BFS: mỗi đỉnh giữ một mặt nạ bit, bit i = "nguồn i đã tới / đang ở biên tại đỉnh này", nên một lần
+// quét cạnh mở rộng đồng thời mọi nguồn trong lô (64 nguồn với 1 từ, 256 nguồn với 4 từ; các phép
+// AND/OR trên 4 từ liên tiếp được trình biên dịch vector hóa).
+template <int Words>
+struct SourceMask
+{
+    uint64_t bits[Words];
+
+    SourceMask() { clear(); }
+    void clear() { for (int w = 0; w < Words; w++) bits[w] = 0; }
+    void set(int i) { bits[i >> 6] |= uint64_t(1) << (i & 63); }
+    bool any() const {
+        uint64_t result = 0;
+        for (int w = 0; w < Words; w++) result |= bits[w];
+        return result != 0;
+    }
+};
+
+// Các đỉnh tới được từ mỗi nguồn trong tối đa maxDepth bước (maxDepth < 0: không giới hạn), dạng
+// (id đỉnh, số bước), sắp theo số bước rồi theo id; không gồm chính nguồn. reverse = đi ngược cạnh.
+// Nguồn trùng nhau vẫn có kết quả riêng.
+template <int Words, class V>
+void multiSourceBatch(const AdjacencySnapshot<V> &graph, const vector<int> &sources, size_t first, size_t count,
+                      int maxDepth, bool reverse, vector<vector<pair<int, int> > > &reached)
+{
+    int n = graph.vertexCount();
+    const vector<int> &offsets = reverse ? graph.inOffsets : graph.outOffsets;
+    const vector<int> &targets = reverse ? graph.inSources : graph.outTargets;
+    vector<SourceMask<Words> > seen(n), visit(n), visitNext(n);
+    vector<int> frontier, nextFrontier;
+
+    for (size_t i = 0; i < count; i++){
+        int source = sources[first + i];
+        if (!visit[source].any())
+            frontier.push_back(source);
+        seen[source].set(i);
+        visit[source].set(i);
+    }
+    for (int depth = 0; !frontier.empty() && (maxDepth < 0 || depth < maxDepth); depth++){
+        for (int v : frontier){
+            const SourceMask<Words> &current = visit[v];
+            for (int e = offsets[v]; e < offsets[v + 1]; e++){
+                int u = targets[e];
+                SourceMask<Words> discovered;
+                for (int w = 0; w < Words; w++){
+                    discovered.bits[w] = current.bits[w] & ~seen[u].bits[w];
+                }
+                if (!discovered.any())
+                    continue;
+                if (!visitNext[u].any())
+                    nextFrontier.push_back(u);
+                for (int w = 0; w < Words; w++){
+                    visitNext[u].bits[w] |= discovered.bits[w];
+                    seen[u].bits[w] |= discovered.bits[w];
+                    for (uint64_t word = discovered.bits[w]; word != 0; word &= word - 1){
+                        reached[first + w * 64 + lowestSetBit(word)].push_back(make_pair(u, depth + 1));
+                    }
+                }
+            }
+        }
+        for (int v : frontier){
+            visit[v].clear();
+        }
+        frontier.swap(nextFrontier);
+        nextFrontier.clear();
+        visit.swap(visitNext);
+    }
+}
+
+template <class V>
+vector<vector<pair<int, int> > > multiSourceBFS(const AdjacencySnapshot<V> &graph, const vector<int> &sources,
+                                                int maxDepth = -1, bool reverse = false)
+{
+    for (int source : sources){
+        if (source < 0 || source >= graph.vertexCount())
+            throw VertexNotFoundException();
+    }
+    vector<vector<pair<int, int> > > reached(sources.size());
+    // lô 64 nguồn dùng mặt nạ 1 từ, lô lớn hơn dùng 4 từ (256 nguồn)
+    for (size_t first = 0; first < sources.size();){
+        size_t remaining = sources.size() - first;
+        if (remaining <= 64){
+            multiSourceBatch<1>(graph, sources, first, remaining, maxDepth, reverse, reached);
+            first += remaining;
+        }
+        else {
+            size_t count = std::min<size_t>(remaining, 256);
+            multiSourceBatch<4>(graph, sources, first, count, maxDepth, reverse, reached);
+            first += count;
+        }
+    }
+    for (auto &list : reached){
+        std::sort(list.begin(), list.end(), [](const pair<int, int> &a, const pair<int, int> &b) {
+            return a.second < b.second || (a.second == b.second && a.first < b.first);
+        });
+    }
+    return reached;
+}
+
+// k cặp (id, điểm) lớn nhất, điểm giảm dần (bằng nhau thì id nhỏ trước); dùng heap kích thước k, O(V log k)
+vector<pair<int, double> > topScores(const vector<double> &scores, int k);
+
 // =====================================
+// Struct ComponentLabels
+// =====================================
+// Thành phần liên thông mạnh: component[id đỉnh] trong [0, count). Số thứ tự theo thứ tự tô-pô của
+// đồ thị rút gọn (mọi cạnh giữa hai thành phần đi từ số nhỏ sang số lớn).
+struct ComponentLabels
+{
+    int count;
+    vector<int> component;
+
+    ComponentLabels() : count(0) {}
+};
+
+// Cách đánh lại id đỉnh cho DGraphModel::reorder() (mọi cạnh, bỏ qua chiều)
+enum ReorderStrategy
+{
+    REORDER_BFS,    // thứ tự BFS, gốc mỗi thành phần lấy theo thứ tự thêm
+    REORDER_RCM,    // Reverse Cuthill-McKee: BFS từ đỉnh bậc nhỏ, láng giềng theo bậc tăng, rồi đảo ngược
+    REORDER_DEGREE, // bậc (vào + ra) giảm dần: các đỉnh hub nằm liền nhau ở đầu
+    REORDER_GORDER  // kiểu Gorder: tham lam chọn đỉnh chung nhiều láng giềng nhất với cửa sổ đỉnh vừa đặt
+};
+
+// Số byte trên heap mà một giá trị đỉnh sở hữu ngoài sizeof(T)
 template <class T>
-class Edge
+inline size_t payloadHeapBytes(const T &)
+{
+    return 0;
+}
+
+inline size_t payloadHeapBytes(const string &value)
+{
+    // Chuỗi ngắn nằm trong chính đối tượng string (SSO) nên không chiếm heap
+    const char *data = value.data();
+    const char *self = reinterpret_cast<const char *>(&value);
+    if (data >= self && data < self + sizeof(string))
+        return 0;
+    return value.capacity() + 1;
+}
+
+// =====================================
+// Class PredicateTable
+// =====================================
+// Bảng intern tên vị từ ("isA", "partOf", "locatedIn", ...) <-> id nguyên.
+// NONE (0) là quan hệ không nhãn; ANY (-1) dùng làm bộ lọc "mọi cạnh"; UNKNOWN (-2) là tên chưa từng intern.
+class PredicateTable
+{
+private:
+    unordered_map<string, int> ids;
+    vector<string> names;
+
+public:
+    enum
+    {
+        UNKNOWN = -2,
+        ANY = -1,
+        NONE = 0
+    };
+
+    PredicateTable();
+
+    int intern(const string &name);
+    int find(const string &name) const;
+    const string &name(int id) const;
+    int size() const;
+    size_t memoryBytes() const;
+};
+
+// =====================================
+// Class ArrayView
+// =====================================
+// View chỉ đọc (kiểu span) trên một mảng liên tục, không sao chép. View hết hiệu lực khi mảng gốc
+// thay đổi (thêm/xóa cạnh); chuyển ngầm được thành vector khi thật sự cần một bản sao.
+template <class E>
+class ArrayView
+{
+private:
+    const E *first;
+    size_t count;
+
+public:
+    ArrayView() : first(nullptr), count(0) {}
+    ArrayView(const vector<E> &data) : first(data.data()), count(data.size()) {}
+    ArrayView(const E *first, size_t count) : first(first), count(count) {}
+
+    const E *begin() const { return first; }
+    const E *end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const E &operator[](size_t i) const { return first[i]; }
+
+    operator vector<E>() const { return vector<E>(first, first + count); }
+};
+
+// =====================================
+// Class Edge
+// =====================================
+template <class T, class P, class W>
+class Edge : private W::slot_type
 {
 #ifdef TESTING
     friend class TestHelper;
 #endif
 private:
-    VertexNode<T> *from;
-    VertexNode<T> *to;
-    float weight;
+    VertexNode<T, P, W> *from;
+    VertexNode<T, P, W> *to;
+    // trọng số nằm trong W::slot_type (lớp cơ sở rỗng khi không lưu trọng số)
 
 public:
-    Edge(VertexNode<T> *from = nullptr, VertexNode<T> *to = nullptr, float weight = 0);
+    typedef typename W::value_type weight_type;
 
-    bool equals(Edge<T> *edge);
-    static bool edgeEQ(Edge<T> *&edge1, Edge<T> *&edge2);
+    Edge(VertexNode<T, P, W> *from = nullptr, VertexNode<T, P, W> *to = nullptr, weight_type weight = 0);
+
+    bool equals(Edge<T, P, W> *edge);
+    static bool edgeEQ(Edge<T, P, W> *&edge1, Edge<T, P, W> *&edge2);
     string toString();
 
-    VertexNode<T> *getFrom() { return from; }
-    VertexNode<T> *getTo() { return to; }
-    float getWeight() { return weight; }
+    VertexNode<T, P, W> *getFrom() { return from; }
+    VertexNode<T, P, W> *getTo() { return to; }
+    weight_type getWeight() { return W::read(*this); }
+    // đồ thị sở hữu đỉnh from đổi phiên bản, và bị đánh dấu nếu trọng số lưu là âm (xem DGraphModel::hasNegativeWeights)
+    void setWeight(weight_type weight);
 
-    friend class VertexNode<T>;
-    friend class DGraphModel<T>;
+    friend class VertexNode<T, P, W>;
+    friend class DGraphModel<T, P, W>;
 };
 
 // =====================================
 // Class VertexNode
 // =====================================
-template <class T>
+template <class T, class P, class W>
 class VertexNode
 {
 #ifdef TESTING
@@ -49,112 +677,2918 @@ class VertexNode
 #endif
 private:
     T vertex;
+    int id_; // chỉ số của đỉnh trong nodeList, dùng để đánh chỉ số các mảng visited
     int inDegree_;
     int outDegree_;
-    vector<Edge<T> *> adList;
-    vector<Edge<T> *> adListFull;
+    vector<Edge<T, P, W> *> adList;
+    vector<Edge<T, P, W> *> adListFull;
+    vector<Edge<T, P, W> *> inList; // chỉ các cạnh đi vào, theo thứ tự tạo (đồng bộ bởi connect/removeTo)
+    DGraphModel<T, P, W> *graph; // đồ thị sở hữu, được báo khi cạnh đi ra đổi (nullptr: không thuộc đồ thị)
 
-    // Function pointers
-    bool (*vertexEQ)(T &, T &);
-    string (*vertex2str)(T &);
+    // Phân vùng kề theo vị từ: chỉ chứa các cạnh có nhãn, sắp theo id vị từ
+    struct PredicateEdges
+    {
+        int predicate;
+        vector<Edge<T, P, W> *> edges;
+    };
+    vector<PredicateEdges> outByPredicate;
+    vector<PredicateEdges> inByPredicate;
+
+    static PredicateEdges *partition(vector<PredicateEdges> &parts, int predicate, bool create);
+    static void erasePartitioned(vector<PredicateEdges> &parts, Edge<T, P, W> *edge);
+    int predicateOf(Edge<T, P, W> *edge);
+    void detach(Edge<T, P, W> *edge);
+
+    // Policies (với policy mặc định đây là hai con trỏ hàm như trước)
+    typename P::equal_type vertexEQ;
+    typename P::format_type vertex2str;
 
 public:
-    VertexNode(T vertex, bool (*vertexEQ)(T &, T &) = nullptr, string (*vertex2str)(T &) = nullptr);
+    typedef typename P::equal_type::argument_type EqualArg;
+    typedef typename P::format_type::argument_type FormatArg;
+
+    VertexNode(const T &vertex, EqualArg vertexEQ = nullptr, FormatArg vertex2str = nullptr);
     ~VertexNode();
     T &getVertex();
-    void connect(VertexNode<T> *to, float weight = 0);
-    Edge<T> *getEdge(VertexNode<T> *to);
-    bool equals(VertexNode<T> *node);
-    void removeTo(VertexNode<T> *to);
+    void connect(VertexNode<T, P, W> *to, typename W::value_type weight = 0, int predicate = PredicateTable::NONE);
+    Edge<T, P, W> *getEdge(VertexNode<T, P, W> *to);
+    Edge<T, P, W> *getEdge(VertexNode<T, P, W> *to, int predicate);
+    bool equals(VertexNode<T, P, W> *node);
+    void removeTo(VertexNode<T, P, W> *to);
+    void removeTo(VertexNode<T, P, W> *to, int predicate);
     int inDegree();
     int outDegree();
+    int getId() { return id_; }
     string toString();
 
-    vector<Edge<T> *> getAdList()
+    MemoryUsage memoryUsage();
+    void compact();
+
+    // view chỉ đọc trên danh sách cạnh đi ra, không sao chép vector
+    ArrayView<Edge<T, P, W> *> getAdList()
+    {
+        return ArrayView<Edge<T, P, W> *>(this->adList);
+    }
+    ArrayView<Edge<T, P, W> *> getAdList(int predicate);
+
+    // view chỉ đọc trên danh sách cạnh đi vào
+    ArrayView<Edge<T, P, W> *> getInList(int predicate = PredicateTable::ANY);
+    // mọi cạnh kề (vào + ra) theo thứ tự tạo; cạnh tự vòng xuất hiện hai lần
+    ArrayView<Edge<T, P, W> *> getIncidentList() { return ArrayView<Edge<T, P, W> *>(adListFull); }
+
+    friend class Edge<T, P, W>;
+    friend class DGraphModel<T, P, W>;
+};
+
+// =====================================
+// Class VertexIndex
+// =====================================
+// Chỉ mục giá trị đỉnh -> VertexNode cho getVertexNode().
+// Bản tổng quát: băm bằng policy, mỗi bucket so sánh lại bằng vertexEQ (không lưu bản sao giá trị đỉnh).
+template <class T, class Node, class Hash, bool Integral = std::is_integral<T>::value>
+class VertexIndex
+{
+private:
+    unordered_multimap<size_t, Node *> buckets;
+    Hash hash;
+
+public:
+    // dùng được khi policy có hàm băm (hàm băm phải nhất quán với phép so sánh)
+    bool usable(bool) const { return Hash::enabled; }
+    bool dense() const { return false; }
+
+    template <class Equal>
+    Node *find(const T &vertex, const Equal &vertexEQ)
+    {
+        auto range = buckets.equal_range(hash(vertex));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (vertexEQ(it->second->getVertex(), vertex))
+                return it->second;
+        }
+        return nullptr;
+    }
+
+    void insert(Node *node) { buckets.insert(make_pair(hash(node->getVertex()), node)); }
+    void clear() { buckets.clear(); }
+
+    size_t memoryBytes() const
+    {
+        // mảng bucket + mỗi phần tử là một node (con trỏ next + cặp khóa/giá trị)
+        return buckets.bucket_count() * sizeof(void *) + buckets.size() * (sizeof(void *) + sizeof(pair<const size_t, Node *>));
+    }
+};
+
+// Bản cho kiểu nguyên (int, char, ...): khi các khóa nằm trong một khoảng đủ dày (vd 0..N-1) thì
+// đánh địa chỉ trực tiếp slots[v - base]; khi khóa thưa thì chuyển sang bảng băm và thử quay lại
+// chế độ dày mỗi khi số đỉnh tăng gấp đôi. Chỉ dùng được khi phép so sánh là operator==.
+template <class T, class Node, class Hash>
+class VertexIndex<T, Node, Hash, true>
+{
+private:
+    typedef unsigned long long Offset;
+
+    static const size_t MIN_DENSE_SLOTS = 1024; // khoảng nhỏ luôn được phép đánh địa chỉ trực tiếp
+    static const size_t MAX_SLOTS_PER_KEY = 4;  // mật độ tối thiểu: ít nhất 1/4 số slot có đỉnh
+
+    vector<Node *> slots; // chế độ dày
+    T base;
+    unordered_map<T, Node *> sparse; // chế độ thưa
+    bool denseMode;
+    T low, high;
+    size_t count;
+    size_t nextDensityCheck;
+
+    static Offset offset(T vertex, T from) { return static_cast<Offset>(vertex) - static_cast<Offset>(from); }
+
+    static bool fits(Offset slotCount, size_t keys)
+    {
+        // slotCount == 0 nghĩa là tràn số (khoảng phủ toàn bộ kiểu 64 bit)
+        return slotCount != 0 && (slotCount <= MIN_DENSE_SLOTS || slotCount / MAX_SLOTS_PER_KEY <= keys);
+    }
+
+    void rebase(T newLow, Offset slotCount)
+    {
+        if (newLow >= base && offset(newLow, base) + slotCount <= slots.size())
+            return;
+        if (newLow >= base)
+        {
+            slots.resize(offset(newLow, base) + slotCount, nullptr); // chỉ mở rộng phía trên
+            return;
+        }
+        // dời base xuống, chừa thêm khoảng trống bằng kích thước hiện tại để tránh dời lại liên tục
+        Offset headroom = min(static_cast<Offset>(slots.size()), offset(newLow, std::numeric_limits<T>::min()));
+        T newBase = static_cast<T>(static_cast<Offset>(newLow) - headroom);
+        vector<Node *> moved(offset(base, newBase) + slots.size(), nullptr);
+        for (size_t i = 0; i < slots.size(); i++)
+            moved[offset(base, newBase) + i] = slots[i];
+        if (moved.size() < offset(newLow, newBase) + slotCount)
+            moved.resize(offset(newLow, newBase) + slotCount, nullptr);
+        slots.swap(moved);
+        base = newBase;
+    }
+
+    void toSparse()
+    {
+        for (auto node : slots)
+        {
+            if (node != nullptr)
+                sparse[node->getVertex()] = node;
+        }
+        vector<Node *>().swap(slots);
+        denseMode = false;
+        nextDensityCheck = 2 * count;
+    }
+
+    void toDense()
+    {
+        slots.assign(offset(high, low) + 1, nullptr);
+        base = low;
+        for (auto &entry : sparse)
+            slots[offset(entry.first, base)] = entry.second;
+        unordered_map<T, Node *>().swap(sparse);
+        denseMode = true;
+    }
+
+public:
+    VertexIndex() : base(0), denseMode(true), low(0), high(0), count(0), nextDensityCheck(0) {}
+
+    bool usable(bool identityEqual) const { return identityEqual; }
+    bool dense() const { return denseMode; }
+
+    template <class Equal>
+    Node *find(const T &vertex, const Equal &)
+    {
+        if (denseMode)
+        {
+            Offset slot = offset(vertex, base);
+            return slot < slots.size() ? slots[slot] : nullptr;
+        }
+        auto it = sparse.find(vertex);
+        return it == sparse.end() ? nullptr : it->second;
+    }
+
+    void insert(Node *node)
+    {
+        T vertex = node->getVertex();
+        if (count == 0)
+        {
+            low = high = base = vertex;
+        }
+        low = min(low, vertex);
+        high = max(high, vertex);
+        count++;
+
+        if (denseMode)
+        {
+            Offset slotCount = offset(high, low) + 1;
+            if (fits(slotCount, count))
+            {
+                rebase(low, slotCount);
+                slots[offset(vertex, base)] = node;
+                return;
+            }
+            toSparse();
+        }
+        sparse[vertex] = node;
+        if (count >= nextDensityCheck)
+        {
+            if (fits(offset(high, low) + 1, count))
+                toDense();
+            else
+                nextDensityCheck = 2 * count;
+        }
+    }
+
+    void clear()
     {
-        return this->adList;
+        vector<Node *>().swap(slots);
+        unordered_map<T, Node *>().swap(sparse);
+        denseMode = true;
+        count = 0;
+        nextDensityCheck = 0;
     }
 
-    friend class Edge<T>;
-    friend class DGraphModel<T>;
+    size_t memoryBytes() const
+    {
+        return slots.capacity() * sizeof(Node *) + sparse.bucket_count() * sizeof(void *) + sparse.size() * (sizeof(void *) + sizeof(pair<const T, Node *>));
+    }
 };
 
 // =====================================
 // Class DGraphModel
 // =====================================
-template <class T>
+template <class T, class P, class W>
 class DGraphModel
 {
 #ifdef TESTING
     friend class TestHelper;
 #endif
+    friend class Edge<T, P, W>;
+    friend class VertexNode<T, P, W>;
 private:
-    vector<VertexNode<T> *> nodeList; // dùng để lưu toàn bộ đỉnh của đồ thị
+    vector<VertexNode<T, P, W> *> nodeList; // dùng để lưu toàn bộ đỉnh của đồ thị
+    VertexIndex<T, VertexNode<T, P, W>, typename P::hash_type> vertexIndex; // giá trị -> đỉnh, dùng khi indexed = true
+    bool indexed;
+    bool negativeWeights; // đã từng lưu một trọng số âm, qua connect() hay Edge::setWeight() (chỉ reset khi clear())
+    unsigned long long revision; // đổi sau mỗi thay đổi đỉnh / cạnh / trọng số, duy nhất giữa mọi đồ thị
+
+    static unsigned long long nextRevision();
+    void touch() { revision = nextRevision(); }
+
+    // Chế độ không chu trình (Pearce-Kelly): rank[id] là vị trí của đỉnh trong một thứ tự tô-pô
+    // của các cạnh thuộc acyclicPredicate, được sửa cục bộ mỗi khi thêm cạnh
+    bool acyclic;
+    int acyclicPredicate;
+    vector<int> rank;
+    vector<unsigned int> mark; // mark[id] == stamp: đã thăm trong lần kiểm tra hiện tại
+    unsigned int stamp;
+
+    vector<int> insertion; // insertion[i] = id của đỉnh được thêm thứ i (khác i sau khi reorder())
 
-    // Function pointers
-    bool (*vertexEQ)(T &, T &);
-    string (*vertex2str)(T &);
+    // Policies
+    typename P::equal_type vertexEQ;
+    typename P::format_type vertex2str;
 
 public:
-    DGraphModel(bool (*vertexEQ)(T &, T &) = nullptr, string (*vertex2str)(T &) = nullptr);
+    typedef typename P::equal_type::argument_type EqualArg;
+    typedef typename P::format_type::argument_type FormatArg;
+    typedef typename W::value_type weight_type;
+    typedef typename W::distance_type distance_type;
+
+    DGraphModel(EqualArg vertexEQ = nullptr, FormatArg vertex2str = nullptr);
     ~DGraphModel();
 
-    VertexNode<T> *getVertexNode(T &vertex);
-    string vertex2Str(VertexNode<T> &node);
-    string edge2Str(Edge<T> &edge);
+    VertexNode<T, P, W> *getVertexNode(const T &vertex);
+    string vertex2Str(VertexNode<T, P, W> &node);
+    string edge2Str(Edge<T, P, W> &edge);
+    bool denseIndexed() { return indexed && vertexIndex.dense(); } // tra cứu đỉnh bằng mảng trực tiếp?
 
-    void add(T vertex);
-    bool contains(T vertex);
-    float weight(T from, T to);
-    vector<Edge<T> *> getOutwardEdges(T from);
+    void add(const T &vertex);
+    bool contains(const T &vertex);
+    typename W::value_type weight(const T &from, const T &to);
+    ArrayView<Edge<T, P, W> *> getOutwardEdges(const T &from, int predicate = PredicateTable::ANY);
+    ArrayView<Edge<T, P, W> *> getInwardEdges(const T &to, int predicate = PredicateTable::ANY);
+    vector<T> getPredecessors(const T &vertex, int predicate = PredicateTable::ANY);
 
-    void connect(T from, T to, float weight = 0);
-    void disconnect(T from, T to);
-    bool connected(T from, T to);
+    void connect(const T &from, const T &to, typename W::value_type weight = 0, int predicate = PredicateTable::NONE);
+    // như connect() nhưng nhận đỉnh đã tra cứu sẵn (kiểm tra chu trình khi enforceAcyclic bật)
+    void connectNodes(VertexNode<T, P, W> *fromNode, VertexNode<T, P, W> *toNode, typename W::value_type weight = 0,
+                      int predicate = PredicateTable::NONE);
+    void disconnect(const T &from, const T &to);
+    void disconnect(const T &from, const T &to, int predicate);
+    bool connected(const T &from, const T &to);
+    bool connected(const T &from, const T &to, int predicate);
 
     int size();
     bool empty();
     void clear();
 
-    int inDegree(T vertex);
-    int outDegree(T vertex);
+    int inDegree(const T &vertex);
+    int outDegree(const T &vertex);
     vector<T> vertices();
 
+    MemoryUsage memoryUsage();
+    void compact();
+    // Đánh lại id đỉnh theo strategy và cấp phát lại đỉnh / cạnh theo thứ tự mới để các đỉnh kề nhau nằm
+    // gần nhau trong bộ nhớ. Thứ tự thêm (vertices(), toString()) và thứ tự cạnh trong từng danh sách kề
+    // được giữ nguyên nên BFS / DFS / đường đi cho cùng kết quả; chỉ id (getId(), các bảng theo id, thứ tự
+    // hòa "theo id") thay đổi. Mọi con trỏ VertexNode / Edge, ArrayView và snapshot cũ đều mất hiệu lực.
+    void reorder(ReorderStrategy strategy = REORDER_RCM);
+    // id của đỉnh được thêm thứ i; bằng i cho tới lần reorder() đầu tiên
+    const vector<int> &insertionOrder() { return insertion; }
+    const T &vertexAt(int id) { return nodeList[id]->vertex; }
+    VertexNode<T, P, W> *nodeAt(int id) { return nodeList[id]; }
+
     string toString();
-    string BFS(T start);
-    string DFS(T start);
+    string BFS(const T &start, int predicate = PredicateTable::ANY);
+    string DFS(const T &start, int predicate = PredicateTable::ANY);
+    // duyệt theo chiều ngược của cạnh (từ start đi tới các đỉnh trỏ vào nó)
+    string reverseBFS(const T &start, int predicate = PredicateTable::ANY);
+    string reverseDFS(const T &start, int predicate = PredicateTable::ANY);
+
+    // Đường đi ngắn nhất: Dijkstra dùng heap khi trọng số không âm; gặp cạnh âm thì chuyển sang
+    // SPFA (Bellman-Ford dùng hàng đợi). Ném NegativeCycleException nếu có chu trình âm tới được.
+    static distance_type unreachable() { return std::numeric_limits<distance_type>::max(); }
+    // đã có cạnh lưu trọng số âm: các truy vấn đường đi không còn dừng sớm mà dùng SPFA
+    bool hasNegativeWeights() { return negativeWeights; }
+    PathResult<T, distance_type> shortestPath(const T &from, const T &to, int predicate = PredicateTable::ANY);
+    vector<pair<T, distance_type> > shortestDistances(const T &from, int predicate = PredicateTable::ANY);
+    // bảng khoảng cách theo id đỉnh (getId()), unreachable() nếu không tới được;
+    // reverse = true: khoảng cách từ mọi đỉnh TỚI source (đi ngược cạnh)
+    vector<distance_type> distanceTable(const T &source, int predicate = PredicateTable::ANY, bool reverse = false);
+    // như distanceTable() nhưng không ném NegativeCycleException: đỉnh mà đường đi có thể vòng qua một chu
+    // trình âm (khoảng cách -vô cùng) nhận unreachable(). Bellman-Ford O(V * E), chỉ dùng khi đã gặp chu trình âm
+    vector<distance_type> finiteDistanceTable(const T &source, int predicate = PredicateTable::ANY, bool reverse = false);
+    // Các đỉnh (trừ source) có khoảng cách ngắn nhất từ source <= budget, theo khoảng cách tăng dần (hòa thì
+    // theo id đỉnh); chỉ đi qua cạnh có trọng số <= maxEdgeWeight, limit > 0: chỉ lấy limit đỉnh đầu tiên.
+    // Dijkstra cắt cụt: heap và bảng khoảng cách chỉ chứa vùng đã chạm tới, dừng ngay khi khóa nhỏ nhất vượt
+    // budget hoặc đủ limit. Đồ thị có trọng số âm thì dùng SPFA trên toàn bộ phần tới được rồi lọc.
+    vector<pair<T, distance_type> > withinDistance(const T &source, distance_type budget,
+                                                   weight_type maxEdgeWeight = std::numeric_limits<weight_type>::max(),
+                                                   size_t limit = 0, int predicate = PredicateTable::ANY);
+
+    // Truy vấn điểm - điểm (chỉ duyệt phần đồ thị cần thiết). Khi đồ thị có trọng số âm cả hai đều
+    // chuyển sang shortestPath().
+    // Dijkstra hai chiều: tiến từ from theo cạnh đi ra, lùi từ to theo cạnh đi vào
+    PathResult<T, distance_type> bidirectionalPath(const T &from, const T &to, int predicate = PredicateTable::ANY);
+    // ALT: chọn count landmark (đỉnh xa nhất lần lượt) và tính khoảng cách từ / tới chúng trên mọi cạnh
+    LandmarkTable<distance_type> buildLandmarks(int count);
+    // bảng tính từ đúng trạng thái hiện tại của đồ thị này (O(1), mọi thay đổi sau đó làm bảng hết khớp)
+    bool landmarksMatch(const LandmarkTable<distance_type> &table);
+    // gắn bảng nạp từ ngoài vào đồ thị nếu dấu vân tay khớp; false nếu bảng của đồ thị khác / đã cũ
+    bool bindLandmarks(LandmarkTable<distance_type> &table);
+    // băm FNV-1a trên mọi cạnh (id đầu, id cuối, trọng số) theo thứ tự id đỉnh và thứ tự kề
+    unsigned long long fingerprint();
+    // A* với cận dưới lấy từ bảng landmark; bảng không khớp đồ thị thì dùng bidirectionalPath()
+    PathResult<T, distance_type> landmarkPath(const T &from, const T &to, const LandmarkTable<distance_type> &table,
+                                             int predicate = PredicateTable::ANY);
+
+    // ảnh chụp CSR của các cạnh mang predicate (ANY = mọi cạnh), đánh theo id đỉnh
+    AdjacencySnapshot<weight_type> snapshot(int predicate = PredicateTable::ANY);
+    // bản nén chỉ đọc (delta + varint, trọng số ở cột riêng) dựng trực tiếp từ danh sách kề, không qua
+    // snapshot; reverse = true: theo cạnh đi vào
+    CompressedAdjacency compress(WeightEncoding encoding = WEIGHT_QUANTIZED, int predicate = PredicateTable::ANY,
+                                 bool reverse = false);
+
+    // Thứ tự tô-pô (Kahn, dựa trên bậc vào): đỉnh không còn cạnh vào được lấy theo thứ tự thêm.
+    // Ném CycleException nếu có chu trình.
+    vector<T> topologicalSort(int predicate = PredicateTable::ANY);
+    // một chu trình dạng [v0, v1, ..., v0]; rỗng nếu đồ thị không có chu trình
+    vector<T> findCycle(int predicate = PredicateTable::ANY);
+    // Chế độ tăng dần: từ chối (CycleException) mọi connect() khép kín một chu trình giữa các cạnh mang
+    // predicate (ANY = mọi cạnh). Mỗi lần thêm cạnh chỉ sắp lại vùng giữa hai đầu mút (Pearce-Kelly).
+    // Bật chế độ khi đồ thị đã có chu trình sẽ ném CycleException.
+    void enforceAcyclic(bool enabled, int predicate = PredicateTable::ANY);
+    bool acyclicEnforced() { return acyclic; }
+
+    // Thành phần liên thông mạnh (Tarjan không đệ quy, O(V + E), không tràn stack trên chuỗi dài)
+    ComponentLabels componentLabels(int predicate = PredicateTable::ANY);
+    // các thành phần theo thứ tự của ComponentLabels, đỉnh trong mỗi thành phần theo thứ tự thêm
+    vector<vector<T> > stronglyConnectedComponents(int predicate = PredicateTable::ANY);
+    // Đồ thị rút gọn (DAG): đỉnh i là thành phần i, một cạnh cho mỗi cặp thành phần có cạnh nối, trọng số
+    // là trọng số nhỏ nhất trong các cạnh đó. threads > 1: duyệt cạnh song song theo khoảng đỉnh.
+    void condensation(const ComponentLabels &labels, DGraphModel<int, NativeVertexPolicy<int>, W> &dag,
+                      int threads = 1, int predicate = PredicateTable::ANY);
+
+    // A* cho đồ thị gắn với không gian: position(vertex) trả về const Point* (nullptr nếu đỉnh không có
+    // tọa độ, khi đó h = 0) và h(v) = heuristicScale * khoảng cách Euclid từ v tới to. Với scale = 1 kết quả
+    // tối ưu nếu mỗi cạnh không ngắn hơn khoảng cách giữa hai đầu mút; scale > 1 là weighted A*
+    // (duyệt ít đỉnh hơn, chi phí không quá scale lần tối ưu). Đỉnh có thể được mở lại khi tìm thấy
+    // đường ngắn hơn nên h không cần nhất quán.
+    template <class Position>
+    PathResult<T, distance_type> astarPath(const T &from, const T &to, Position position, double heuristicScale = 1.0,
+                                          int predicate = PredicateTable::ANY);
+
+    // Liệt kê đường đi đơn (không lặp đỉnh; các cạnh song song giữa hai đỉnh gộp làm một, lấy trọng số nhỏ
+    // nhất). Kết quả được tính dần và đưa lần lượt cho emit; emit trả false để dừng.
+    // Yen: k đường ngắn nhất theo chi phí tăng dần (k < 0: tới khi hết). Khoảng cách thật tới to (một lần
+    // tìm đường trên cạnh đi vào) là heuristic chính xác cho A* của mỗi lần tìm nhánh rẽ và loại luôn các
+    // đỉnh không tới được to; chạy được với trọng số âm nếu không có chu trình âm.
+    void kShortestPaths(const T &from, const T &to, int k,
+                        const std::function<bool(const PathResult<T, distance_type> &)> &emit,
+                        int predicate = PredicateTable::ANY);
+    // Mọi đường đi đơn tối đa maxHops cạnh, theo thứ tự DFS; nhánh bị cắt khi số bước + số bước ít nhất
+    // còn lại tới to (BFS ngược từ to) vượt maxHops
+    void simplePaths(const T &from, const T &to, int maxHops,
+                     const std::function<bool(const PathResult<T, distance_type> &)> &emit,
+                     int predicate = PredicateTable::ANY);
+
+private:
+    bool dijkstra(VertexNode<T, P, W> *source, int predicate, bool reverse, VertexNode<T, P, W> *target,
+                  vector<distance_type> &dist, vector<Edge<T, P, W> *> &via);
+    // maxWeight: bỏ qua các cạnh nặng hơn
+    void spfa(VertexNode<T, P, W> *source, int predicate, bool reverse,
+              vector<distance_type> &dist, vector<Edge<T, P, W> *> &via,
+              weight_type maxWeight = std::numeric_limits<weight_type>::max());
+    void singleSource(VertexNode<T, P, W> *source, int predicate, bool reverse, VertexNode<T, P, W> *target,
+                      vector<distance_type> &dist, vector<Edge<T, P, W> *> &via);
+    bool boundedDijkstra(VertexNode<T, P, W> *source, distance_type budget, weight_type maxEdgeWeight, size_t limit,
+                         int predicate, vector<pair<T, distance_type> > &result);
+    string label(VertexNode<T, P, W> *node);
+    vector<int> kahnOrder(int predicate, vector<int> &inDegree);
+    string cycleMessage(const vector<VertexNode<T, P, W> *> &cycle);
+    void insertOrdered(VertexNode<T, P, W> *fromNode, VertexNode<T, P, W> *toNode);
+    size_t edgeCount();
+    PathResult<T, distance_type> tracePath(VertexNode<T, P, W> *meet, distance_type distance,
+                                           const vector<Edge<T, P, W> *> &forward, const vector<Edge<T, P, W> *> &backward);
+
+    // bộ nhớ tạm dùng lại giữa các lần tìm nhánh rẽ (chỉ các đỉnh đã chạm được đặt lại)
+    struct SpurSearch
+    {
+        vector<distance_type> g;
+        vector<int> parent;
+        vector<char> closed;
+        vector<int> touched;
+        IndexedMinHeap<distance_type> open;
+        int expanded;
+
+        explicit SpurSearch(size_t n) : g(n, unreachable()), parent(n, -1), closed(n, 0), open(n), expanded(0) {}
+    };
+    // A* cho một nhánh rẽ của Yen: h là khoảng cách thật tới target, bỏ các đỉnh blocked, các cạnh
+    // source -> skip và mọi đỉnh mà chi phí qua nó chắc chắn vượt bound; path / costs nhận các đỉnh và chi
+    // phí cộng dồn từ source (costs[0] = base)
+    bool spurPath(SpurSearch &search, int source, int target, distance_type base, distance_type bound,
+                  const vector<distance_type> &h,
+                  const vector<char> &blocked, const vector<int> &skip, int predicate,
+                  vector<int> &path, vector<distance_type> &costs);
+
+    vector<int> reorderPermutation(ReorderStrategy strategy);
+    vector<VertexNode<T, P, W> *> bfsOrder(VertexNode<T, P, W> *startNode, int predicate, bool reverse);
+    vector<VertexNode<T, P, W> *> dfsOrder(VertexNode<T, P, W> *startNode, int predicate, bool reverse);
+    string visitString(const vector<VertexNode<T, P, W> *> &visitOrder);
 };
 
 // =====================================
-// Class KnowledgeGraph
+// Queue / Stack (BFS use Queue and DFS use stack)
 // =====================================
-class KnowledgeGraph
+template <class T>
+class Queue
 {
-#ifdef TESTING
-    friend class TestHelper;
-#endif
 private:
-    DGraphModel<string> graph; // lưu tất cả các thực thể và mối quan hệ trong đồ thị tri thức
-    vector<string> entities; // lưu danh sách tất cả các thực thể trong đồ thị tri thức \
-    (đồng bộ vs graph để dễ truy xuất)
+    vector<T> data;
+    int frontIndex;
+    int rearIndex;
 
 public:
-    KnowledgeGraph();
+    Queue() : frontIndex(0), rearIndex(-1) {}
 
-    void addEntity(string entity);
-    void addRelation(string from, string to, float weight = 1.0f);
+    // TODO
+    void enqueue(T item){
+        data.push_back(item);
+        rearIndex++;
+    }
+
+    T dequeue(){
+        return data[frontIndex++];
+    }
+
+    bool isEmpty(){
+        return frontIndex > rearIndex;
+    }
+};
+
+template <class T>
+class Stack
+{
+private:
+    vector<T> data;
+
+public:
+    Stack() = default;
+
+    void push(T item){
+        data.push_back(item);
+    }
+
+    T pop(){
+        T item = data.back();
+        data.pop_back();
+        return item;
+    }
+
+    bool isEmpty(){
+        return data.empty();
+    }
+};
+
+// =====================================
+// IndexedMinHeap (dùng cho A*)
+// =====================================
+// Binary heap trên các id 0..n-1, mỗi id có mặt tối đa một lần nên push() với id đã có là giảm khóa
+// (không có phần tử thừa như heap xóa lười). Cùng khóa thì id nhỏ ra trước.
+template <class K>
+class IndexedMinHeap
+{
+private:
+    vector<int> heap;     // các id, heap[0] có khóa nhỏ nhất
+    vector<K> keys;       // keys[id]
+    vector<int> position; // vị trí của id trong heap, -1 nếu không có
+
+    bool less(int a, int b) const { return keys[a] < keys[b] || (keys[a] == keys[b] && a < b); }
+    void place(int index, int id){
+        heap[index] = id;
+        position[id] = index;
+    }
+    void siftUp(int index){
+        int id = heap[index];
+        while (index > 0 && less(id, heap[(index - 1) / 2])){
+            place(index, heap[(index - 1) / 2]);
+            index = (index - 1) / 2;
+        }
+        place(index, id);
+    }
+    void siftDown(int index){
+        int id = heap[index];
+        int size = heap.size();
+        while (2 * index + 1 < size){
+            int child = 2 * index + 1;
+            if (child + 1 < size && less(heap[child + 1], heap[child]))
+                child++;
+            if (!less(heap[child], id))
+                break;
+            place(index, heap[child]);
+            index = child;
+        }
+        place(index, id);
+    }
+
+public:
+    explicit IndexedMinHeap(int capacity) : keys(capacity), position(capacity, -1) {}
+
+    bool empty() const { return heap.empty(); }
+    int size() const { return heap.size(); }
+    bool contains(int id) const { return position[id] >= 0; }
+    const K &key(int id) const { return keys[id]; }
+
+    // thêm id, hoặc giảm khóa nếu id đã có trong heap và key nhỏ hơn
+    void push(int id, const K &key){
+        if (position[id] < 0){
+            keys[id] = key;
+            heap.push_back(id);
+            siftUp(heap.size() - 1);
+        }
+        else if (key < keys[id]){
+            keys[id] = key;
+            siftUp(position[id]);
+        }
+    }
+
+    int pop(){
+        int top = heap[0];
+        position[top] = -1;
+        int last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()){
+            place(0, last);
+            siftDown(0);
+        }
+        return top;
+    }
+};
+
+// =====================================
+// Class Edge Implementation
+// =====================================
+
+template <class T, class P, class W>
+Edge<T, P, W>::Edge(VertexNode<T, P, W> *from, VertexNode<T, P, W> *to, weight_type weight){
+    // khởi tạo các tham số chỉ định
+    this->from = from;
+    this->to = to;
+    this->setWeight(weight);
+}
+
+template <class T, class P, class W>
+void Edge<T, P, W>::setWeight(weight_type weight){
+    W::write(*this, weight);
+    if (from != nullptr && from->graph != nullptr){
+        if (W::read(*this) < 0)
+            from->graph->negativeWeights = true;
+        from->graph->touch();
+    }
+}
+
+template <class T, class P, class W>
+string Edge<T, P, W>::toString(){
+    stringstream ss;
+    ss << "(";
+    if (from != nullptr){
+        if (from->vertex2str.enabled())
+            ss << from->vertex2str(from->vertex);
+        else
+            ss << from->vertex;  
+    }
+    ss << ", ";
+    if (to != nullptr){
+        if (to->vertex2str.enabled())
+            ss << to->vertex2str(to->vertex);
+        else
+            ss << to->vertex;  
+    }
+    ss << ", ";
+    
+    // Format float with 6 decimal places using stringstream methods
+    ss.precision(6); // đặt độ chính xác là 6 chữ số thập phân
+    ss.setf(std::ios::fixed, std::ios::floatfield); // sử dụng định dạng số thập phân cố định
+    ss << getWeight(); // in ra trọng số với thiết lập ở trên
+    
+    ss << ")";
+    return ss.str();
+}
+
+// TODO: Implement other methods of Edge:
+template <class T, class P, class W>
+bool Edge<T, P, W>::equals(Edge<T, P, W> *edge){
+    // so sánh cạnh hiện tại vs 1 cạnh khác, true nếu from và to giống nhau, ngược lại false
+    if (edge == nullptr)
+        return false;
+    return (this->from == edge->from && this->to == edge->to);
+}
+
+template <class T, class P, class W>
+bool Edge<T, P, W>::edgeEQ(Edge<T, P, W> *&edge1, Edge<T, P, W> *&edge2)
+{
+    if (edge1 == nullptr || edge2 == nullptr)
+        return false;
+    return edge1->equals(edge2);
+}
+
+// =====================================
+// Class VertexNode Implementation
+// =====================================
+template <class T, class P, class W>
+VertexNode<T, P, W>::VertexNode(const T &vertex, EqualArg vertexEQ, FormatArg vertex2str)
+    : vertexEQ(vertexEQ), vertex2str(vertex2str){
+    this->vertex = vertex;
+    this->id_ = 0;
+    this->inDegree_ = 0;
+    this->outDegree_ = 0;
+    this->graph = nullptr;
+}
+
+template <class T, class P, class W>
+VertexNode<T, P, W>::~VertexNode(){
+    // Clean up all edges in adjacency list
+    for (auto edge : adList){
+        delete edge;
+    }
+    adList.clear();
+    adListFull.clear(); // Clear full adjacency list as well (bao gồm cả incoming và outcoming edges)
+    inList.clear();
+}
+
+template <class T, class P, class W>
+T &VertexNode<T, P, W>::getVertex(){
+    return this->vertex;
+}
+
+template <class T, class P, class W>
+void VertexNode<T, P, W>::connect(VertexNode<T, P, W> *to, typename W::value_type weight, int predicate){
+    // kết nối đỉnh hiện tại vs đỉnh to bằng cách tạo 1 canh với trọng số weight (mặc định là 0)
+    // predicate != NONE: cạnh có nhãn, được thêm vào phân vùng kề của vị từ đó
+    if (to == nullptr)
+        return;
+
+    // Check if edge already exists (cùng đỉnh đích và cùng vị từ)
+    Edge<T, P, W> *edge = getEdge(to, predicate);
+    if (edge != nullptr){
+        edge->setWeight(weight); // Update weight if exists
+        return;
+    }
+
+    // Create new edge
+    Edge<T, P, W> *newEdge = new Edge<T, P, W>(this, to, weight); // from ,to, weight
+    
+    // Add to outgoing edges list of 'from' node (this)
+    adList.push_back(newEdge);
+    adListFull.push_back(newEdge);
+    this->outDegree_++;
+    if (predicate != PredicateTable::NONE){
+        partition(outByPredicate, predicate, true)->edges.push_back(newEdge);
+        partition(to->inByPredicate, predicate, true)->edges.push_back(newEdge);
+    }
+    
+    // Add to full edges list and incoming list of 'to' node (incoming edge)
+    to->adListFull.push_back(newEdge);
+    to->inList.push_back(newEdge);
+    to->inDegree_++;
+}
+
+template <class T, class P, class W>
+Edge<T, P, W> *VertexNode<T, P, W>::getEdge(VertexNode<T, P, W> *to){
+    // trả về con trỏ nối đỉnh hiện tại vs đỉnh to (bất kể vị từ), nếu k có trả về nullptr
+    for (auto edge : adList){
+        if (edge->to == to)
+            return edge;
+    }
+    return nullptr;
+}
+
+template <class T, class P, class W>
+Edge<T, P, W> *VertexNode<T, P, W>::getEdge(VertexNode<T, P, W> *to, int predicate){
+    if (predicate == PredicateTable::ANY)
+        return getEdge(to);
+    if (predicate == PredicateTable::NONE){
+        // cạnh không nhãn là cạnh không nằm trong phân vùng nào
+        for (auto edge : adList){
+            if (edge->to == to && predicateOf(edge) == PredicateTable::NONE)
+                return edge;
+        }
+        return nullptr;
+    }
+    for (auto edge : getAdList(predicate)){
+        if (edge->to == to)
+            return edge;
+    }
+    return nullptr;
+}
+
+template <class T, class P, class W>
+bool VertexNode<T, P, W>::equals(VertexNode<T, P, W> *node){
+    if (node == nullptr)
+        return false;
+    return this->vertexEQ(this->vertex, node->vertex); // policy tự xử lý trường hợp không có con trỏ hàm
+}
+
+template <class T, class P, class W>
+void VertexNode<T, P, W>::removeTo(VertexNode<T, P, W> *to){
+    // xóa (mọi) cạnh nối đỉnh hiện tại vs đỉnh to, kể cả các cạnh có nhãn
+    Edge<T, P, W> *edge;
+    while ((edge = getEdge(to)) != nullptr){
+        detach(edge);
+    }
+}
+
+template <class T, class P, class W>
+void VertexNode<T, P, W>::removeTo(VertexNode<T, P, W> *to, int predicate){
+    Edge<T, P, W> *edge = getEdge(to, predicate);
+    if (edge != nullptr)
+        detach(edge);
+}
+
+template <class T, class P, class W>
+void VertexNode<T, P, W>::detach(Edge<T, P, W> *edgeToRemove){
+    // gỡ cạnh (đi ra từ đỉnh này) khỏi mọi danh sách rồi giải phóng
+    VertexNode<T, P, W> *to = edgeToRemove->to;
+    adList.erase(std::find(adList.begin(), adList.end(), edgeToRemove));
+    
+    // Remove from adListFull of 'from' node (this)
+    this->adListFull.erase(std::find(this->adListFull.begin(), this->adListFull.end(), edgeToRemove));
+    
+    // Remove from adListFull and incoming list of 'to' node
+    to->adListFull.erase(std::find(to->adListFull.begin(), to->adListFull.end(), edgeToRemove));
+    to->inList.erase(std::find(to->inList.begin(), to->inList.end(), edgeToRemove));
+
+    // Remove from its predicate partitions (if typed)
+    erasePartitioned(outByPredicate, edgeToRemove);
+    erasePartitioned(to->inByPredicate, edgeToRemove);
+    if (graph != nullptr)
+        graph->touch();
+    
+    delete edgeToRemove;
+    this->outDegree_--;
+    to->inDegree_--;
+}
+
+template <class T, class P, class W>
+typename VertexNode<T, P, W>::PredicateEdges *VertexNode<T, P, W>::partition(vector<PredicateEdges> &parts, int predicate, bool create){
+    // các phân vùng được sắp theo id vị từ; mỗi đỉnh thường chỉ có vài vị từ
+    auto it = std::lower_bound(parts.begin(), parts.end(), predicate,
+                               [](const PredicateEdges &part, int id) { return part.predicate < id; });
+    if (it != parts.end() && it->predicate == predicate)
+        return &*it;
+    if (!create)
+        return nullptr;
+    PredicateEdges part;
+    part.predicate = predicate;
+    return &*parts.insert(it, part);
+}
+
+template <class T, class P, class W>
+void VertexNode<T, P, W>::erasePartitioned(vector<PredicateEdges> &parts, Edge<T, P, W> *edge){
+    for (auto it = parts.begin(); it != parts.end(); ++it){
+        auto pos = std::find(it->edges.begin(), it->edges.end(), edge);
+        if (pos != it->edges.end()){
+            it->edges.erase(pos);
+            if (it->edges.empty())
+                parts.erase(it);
+            return;
+        }
+    }
+}
+
+template <class T, class P, class W>
+int VertexNode<T, P, W>::predicateOf(Edge<T, P, W> *edge){
+    for (auto &part : outByPredicate){
+        if (std::find(part.edges.begin(), part.edges.end(), edge) != part.edges.end())
+            return part.predicate;
+    }
+    return PredicateTable::NONE;
+}
+
+template <class T, class P, class W>
+ArrayView<Edge<T, P, W> *> VertexNode<T, P, W>::getAdList(int predicate){
+    // ANY: toàn bộ cạnh đi ra; id vị từ: chỉ các cạnh của vị từ đó (không quét các cạnh khác)
+    if (predicate == PredicateTable::ANY)
+        return getAdList();
+    PredicateEdges *part = partition(outByPredicate, predicate, false);
+    if (part == nullptr)
+        return ArrayView<Edge<T, P, W> *>();
+    return ArrayView<Edge<T, P, W> *>(part->edges);
+}
+
+template <class T, class P, class W>
+ArrayView<Edge<T, P, W> *> VertexNode<T, P, W>::getInList(int predicate){
+    if (predicate == PredicateTable::ANY)
+        return ArrayView<Edge<T, P, W> *>(inList);
+    PredicateEdges *part = partition(inByPredicate, predicate, false);
+    if (part == nullptr)
+        return ArrayView<Edge<T, P, W> *>();
+    return ArrayView<Edge<T, P, W> *>(part->edges);
+}
+
+template <class T, class P, class W>
+int VertexNode<T, P, W>::inDegree(){
+    return this->inDegree_;
+}
+
+template <class T, class P, class W>
+int VertexNode<T, P, W>::outDegree(){
+    return this->outDegree_;
+}
+
+template <class T, class P, class W>
+string VertexNode<T, P, W>::toString(){
+    stringstream ss;
+    ss << "(";
+    if (this->vertex2str.enabled())
+        ss << this->vertex2str(this->vertex);
+    else
+        ss << this->vertex;
+    ss << ", " << this->inDegree_ << ", " << this->outDegree_ << ", [";
+    
+    for (size_t i = 0; i < adListFull.size(); i++){
+        if (i > 0) ss << ", ";
+        ss << adListFull[i]->toString();
+    }
+    ss << "])";
+    return ss.str();
+}
+
+template <class T, class P, class W>
+MemoryUsage VertexNode<T, P, W>::memoryUsage(){
+    // Thống kê bộ nhớ của riêng đỉnh này; cạnh được tính cho đỉnh nguồn (đỉnh sở hữu nó)
+    MemoryUsage usage;
+    usage.vertexPayload = sizeof(T) + payloadHeapBytes(this->vertex);
+    usage.vertexNodes = sizeof(VertexNode<T, P, W>) - sizeof(T);
+    usage.edges = adList.size() * sizeof(Edge<T, P, W>);
+    usage.adListUsed = adList.size() * sizeof(Edge<T, P, W> *);
+    usage.adListSlack = (adList.capacity() - adList.size()) * sizeof(Edge<T, P, W> *);
+    usage.adListFullUsed = adListFull.size() * sizeof(Edge<T, P, W> *);
+    usage.adListFullSlack = (adListFull.capacity() - adListFull.size()) * sizeof(Edge<T, P, W> *);
+    usage.inListUsed = inList.size() * sizeof(Edge<T, P, W> *);
+    usage.inListSlack = (inList.capacity() - inList.size()) * sizeof(Edge<T, P, W> *);
+    // phân vùng theo vị từ được tính vào phần chỉ mục
+    usage.indexes = (outByPredicate.capacity() + inByPredicate.capacity()) * sizeof(PredicateEdges);
+    for (auto &part : outByPredicate){
+        usage.indexes += part.edges.capacity() * sizeof(Edge<T, P, W> *);
+    }
+    for (auto &part : inByPredicate){
+        usage.indexes += part.edges.capacity() * sizeof(Edge<T, P, W> *);
+    }
+    return usage;
+}
+
+template <class T, class P, class W>
+void VertexNode<T, P, W>::compact(){
+    // giải phóng phần capacity dư của các danh sách kề (sau khi nạp dữ liệu hàng loạt)
+    adList.shrink_to_fit();
+    adListFull.shrink_to_fit();
+    inList.shrink_to_fit();
+    for (auto &part : outByPredicate){
+        part.edges.shrink_to_fit();
+    }
+    for (auto &part : inByPredicate){
+        part.edges.shrink_to_fit();
+    }
+    outByPredicate.shrink_to_fit();
+    inByPredicate.shrink_to_fit();
+}
+
+// =====================================
+// Class DGraphModel Implementation
+// =====================================
+template <class T, class P, class W>
+DGraphModel<T, P, W>::DGraphModel(EqualArg vertexEQ, FormatArg vertex2str)
+    : negativeWeights(false), revision(nextRevision()), acyclic(false), acyclicPredicate(PredicateTable::ANY), stamp(0),
+      vertexEQ(vertexEQ), vertex2str(vertex2str){
+    this->indexed = vertexIndex.usable(this->vertexEQ.isIdentity());
+}
+
+template <class T, class P, class W>
+DGraphModel<T, P, W>::~DGraphModel(){
+    // TODO: Clear all vertices and edges to avoid memory leaks
+    clear();
+}
+
+template <class T, class P, class W>
+VertexNode<T, P, W> *DGraphModel<T, P, W>::getVertexNode(const T &vertex){
+    // tìm kiếm và trả về con trỏ đỉnh có giá trị vertex, nếu ko tìm thấy trả về nullptr
+    if (indexed){
+        return vertexIndex.find(vertex, vertexEQ);
+    }
+    for (auto node : nodeList){
+        if (vertexEQ(node->vertex, vertex))
+            return node;
+    }
+    return nullptr;
+}
+
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::vertex2Str(VertexNode<T, P, W> &node){
+    // Nếu có function pointer vertex2str, dùng nó (trả về giá trị đơn giản là gtri vertex)
+    if (this->vertex2str.enabled()) {
+        return this->vertex2str(node.vertex);
+    }
+    
+    // Nếu không có function pointer vertex2str, trả về format đầy đủ như toString()
+    return node.toString();
+}
+
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::edge2Str(Edge<T, P, W> &edge){
+    return edge.toString();
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::add(const T &vertex){
+    // TODO: Add a new vertex to the graph
+    if (contains(vertex)) return; // Vertex already exists
+    VertexNode<T, P, W> *newNode = new VertexNode<T, P, W>(vertex);
+    newNode->vertexEQ = this->vertexEQ;
+    newNode->vertex2str = this->vertex2str;
+    newNode->id_ = nodeList.size();
+    newNode->graph = this;
+    nodeList.push_back(newNode);
+    insertion.push_back(newNode->id_);
+    touch();
+    if (indexed){
+        vertexIndex.insert(newNode);
+    }
+    if (acyclic){
+        rank.push_back(newNode->id_); // đỉnh mới chưa có cạnh: đứng cuối thứ tự
+        mark.push_back(0);
+    }
+}
+
+template <class T, class P, class W>
+bool DGraphModel<T, P, W>::contains(const T &vertex){
+    return getVertexNode(vertex) != nullptr;
+}
+
+template <class T, class P, class W>
+typename W::value_type DGraphModel<T, P, W>::weight(const T &from, const T &to){
+    // trả về trọng số của cạnh nối đỉnh from vs đỉnh to
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    if (fromNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    Edge<T, P, W> *edge = fromNode->getEdge(toNode);
+    if (edge == nullptr){
+        throw EdgeNotFoundException();
+    }
+
+    return edge->getWeight();
+}
+
+template <class T, class P, class W>
+ArrayView<Edge<T, P, W> *> DGraphModel<T, P, W>::getOutwardEdges(const T &from, int predicate){
+    // trả về danh sách các cạnh đi ra từ đỉnh from
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    if (fromNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    return fromNode->getAdList(predicate);
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::connect(const T &from, const T &to, typename W::value_type weight, int predicate){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    if (fromNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    connectNodes(fromNode, toNode, weight, predicate);
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::connectNodes(VertexNode<T, P, W> *fromNode, VertexNode<T, P, W> *toNode, typename W::value_type weight, int predicate){
+    if (acyclic && (acyclicPredicate == PredicateTable::ANY || acyclicPredicate == predicate)){
+        insertOrdered(fromNode, toNode); // ném CycleException, không thêm cạnh
+    }
+    fromNode->connect(toNode, weight, predicate); // Edge::setWeight() bật negativeWeights nếu cần
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::disconnect(const T &from, const T &to){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    if (fromNode == nullptr){
+        throw VertexNotFoundException();
+    }
 
-    vector<string> getAllEntities();
-    vector<string> getNeighbors(string entity);
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    fromNode->removeTo(toNode); // disconnect nghĩa là xóa cạnh nối từ 'from' đến 'to'
+}
+
+template <class T, class P, class W>
+bool DGraphModel<T, P, W>::connected(const T &from, const T &to){
+    // kiểm tra xem có cạnh nối đỉnh from vs đỉnh to hay ko
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    if (fromNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    return (fromNode->getEdge(toNode) != nullptr);
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::disconnect(const T &from, const T &to, int predicate){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    if (fromNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    fromNode->removeTo(toNode, predicate); // chỉ xóa cạnh mang vị từ predicate
+}
 
-    string bfs(string start);
-    string dfs(string start);
+template <class T, class P, class W>
+bool DGraphModel<T, P, W>::connected(const T &from, const T &to, int predicate){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    if (fromNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    return (fromNode->getEdge(toNode, predicate) != nullptr);
+}
+
+template <class T, class P, class W>
+int DGraphModel<T, P, W>::size(){
+    return nodeList.size(); // trả về số đỉnh trong đồ thị
+}
+
+template <class T, class P, class W>
+bool DGraphModel<T, P, W>::empty(){
+    return nodeList.empty(); // kiểm tra đồ thị có rỗng hay ko
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::clear(){
+    // xóa tất cả các cạnh và node trong đồ thị (bắt buộc phải xóa cạnh trước nếu ko sẽ bị rò rỉ bộ nhớ)
+    for (auto node : nodeList){
+        for (auto edge : node->adList){
+            delete edge;
+        }
+        node->adList.clear();
+        node->adListFull.clear();
+        node->inList.clear();
+        delete node;
+    }
+    nodeList.clear();
+    insertion.clear();
+    vertexIndex.clear();
+    negativeWeights = false;
+    rank.clear();
+    mark.clear();
+    touch();
+}
+
+template <class T, class P, class W>
+int DGraphModel<T, P, W>::inDegree(const T &vertex){
+    VertexNode<T, P, W> *node = getVertexNode(vertex);
+    if (node == nullptr){
+        throw VertexNotFoundException();
+    }
+    return node->inDegree();
+}
+
+template <class T, class P, class W>
+int DGraphModel<T, P, W>::outDegree(const T &vertex){
+    VertexNode<T, P, W> *node = getVertexNode(vertex);
+    if (node == nullptr){
+        throw VertexNotFoundException();
+    }
+    return node->outDegree();
+}
+
+template <class T, class P, class W>
+vector<T> DGraphModel<T, P, W>::vertices(){
+    // trả về danh sách tất cả các đỉnh trong đồ thị
+    vector<T> result;
+    for (int id : insertion){
+        result.push_back(nodeList[id]->vertex);
+    }
+    return result;
+}
+
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::toString(){
+    // trả về chuỗi biểu diễn toàn bộ đồ thị, bao gồm danh sách các đỉnh theo đúng thứ tự thêm và các cạnh của chúng
+    // mỗi đỉnh dc in bằng phương thức toString() của VertexNode
+    stringstream ss;
+    ss << "[";
+    
+    for (size_t i = 0; i < insertion.size(); i++){
+        if (i > 0) ss << ", ";
+        ss << nodeList[insertion[i]]->toString();
+    }
+    
+    ss << "]";
+    return ss.str();
+}
+
+template <class T, class P, class W>
+MemoryUsage DGraphModel<T, P, W>::memoryUsage(){
+    MemoryUsage usage;
+    for (auto node : nodeList){
+        usage += node->memoryUsage();
+    }
+    usage.indexes += sizeof(DGraphModel<T, P, W>) + nodeList.capacity() * sizeof(VertexNode<T, P, W> *);
+    usage.indexes += vertexIndex.memoryBytes();
+    return usage;
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::compact(){
+    for (auto node : nodeList){
+        node->compact();
+    }
+    nodeList.shrink_to_fit();
+}
+
+// =====================================
+// Cache-locality reordering
+// =====================================
+template <class T, class P, class W>
+vector<int> DGraphModel<T, P, W>::reorderPermutation(ReorderStrategy strategy){
+    // trả về order: order[i] = id hiện tại của đỉnh sẽ mang id mới i
+    int n = nodeList.size();
+    vector<int> order;
+    order.reserve(n);
+    vector<bool> placed(n, false);
+    auto degree = [this](int v) { return nodeList[v]->inDegree_ + nodeList[v]->outDegree_; };
+
+    if (strategy == REORDER_DEGREE){
+        order = insertion;
+        std::stable_sort(order.begin(), order.end(), [&degree](int a, int b) { return degree(a) > degree(b); });
+        return order;
+    }
+
+    if (strategy == REORDER_BFS || strategy == REORDER_RCM){
+        // gốc: BFS lấy theo thứ tự thêm, RCM lấy đỉnh bậc nhỏ nhất còn lại (gần ngoại vi)
+        vector<int> roots = insertion;
+        if (strategy == REORDER_RCM)
+            std::stable_sort(roots.begin(), roots.end(), [&degree](int a, int b) { return degree(a) < degree(b); });
+        vector<int> level;
+        for (int root : roots){
+            if (placed[root])
+                continue;
+            placed[root] = true;
+            order.push_back(root);
+            for (size_t head = order.size() - 1; head < order.size(); head++){
+                VertexNode<T, P, W> *node = nodeList[order[head]];
+                level.clear();
+                for (auto edge : node->adList){
+                    if (!placed[edge->to->id_]){
+                        placed[edge->to->id_] = true;
+                        level.push_back(edge->to->id_);
+                    }
+                }
+                for (auto edge : node->inList){
+                    if (!placed[edge->from->id_]){
+                        placed[edge->from->id_] = true;
+                        level.push_back(edge->from->id_);
+                    }
+                }
+                if (strategy == REORDER_RCM)
+                    std::stable_sort(level.begin(), level.end(), [&degree](int a, int b) { return degree(a) < degree(b); });
+                order.insert(order.end(), level.begin(), level.end());
+            }
+        }
+        if (strategy == REORDER_RCM)
+            std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    // Gorder (rút gọn): điểm của v = số cạnh nối v với WINDOW đỉnh vừa đặt + số đỉnh trong cửa sổ có chung
+    // một đỉnh cha với v. Mỗi lần chọn đỉnh điểm cao nhất (hòa: id nhỏ); heap xóa lười, mỗi lần đổi điểm
+    // đẩy một bản ghi mới. Cha có quá nhiều con (hub) bị bỏ qua khi tính đỉnh anh em để tránh O(bậc^2).
+    const int WINDOW = 5;
+    const int hubLimit = std::max(16, static_cast<int>(std::sqrt(static_cast<double>(n))));
+    vector<int> score(n, 0);
+    std::priority_queue<pair<int, int> > heap; // (điểm, -id)
+    auto bump = [&](int v, int delta){
+        if (placed[v])
+            return;
+        score[v] += delta;
+        heap.push(make_pair(score[v], -v));
+    };
+    auto update = [&](int u, int delta){
+        VertexNode<T, P, W> *node = nodeList[u];
+        for (auto edge : node->adList)
+            bump(edge->to->id_, delta);
+        for (auto edge : node->inList){
+            bump(edge->from->id_, delta);
+            if (edge->from->outDegree_ > hubLimit)
+                continue;
+            for (auto sibling : edge->from->adList)
+                bump(sibling->to->id_, delta);
+        }
+    };
+    size_t cursor = 0; // đỉnh chưa đặt kế tiếp theo thứ tự thêm, dùng khi không còn ứng viên có điểm
+    while (static_cast<int>(order.size()) < n){
+        int next = -1;
+        while (!heap.empty()){
+            pair<int, int> top = heap.top();
+            heap.pop();
+            if (!placed[-top.second] && score[-top.second] == top.first && top.first > 0){
+                next = -top.second;
+                break;
+            }
+        }
+        if (next < 0){
+            while (placed[insertion[cursor]])
+                cursor++;
+            next = insertion[cursor];
+        }
+        placed[next] = true;
+        order.push_back(next);
+        update(next, 1);
+        if (static_cast<int>(order.size()) > WINDOW)
+            update(order[order.size() - 1 - WINDOW], -1);
+    }
+    return order;
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::reorder(ReorderStrategy strategy){
+    int n = nodeList.size();
+    if (n == 0)
+        return;
+    vector<int> order = reorderPermutation(strategy);
+    vector<int> newId(n);
+    for (int i = 0; i < n; i++){
+        newId[order[i]] = i;
+    }
+
+    // Đỉnh mới được cấp phát theo thứ tự id mới, danh sách kề chuyển sang nguyên vẹn
+    vector<VertexNode<T, P, W> *> nodes(n);
+    for (int i = 0; i < n; i++){
+        VertexNode<T, P, W> *old = nodeList[order[i]];
+        VertexNode<T, P, W> *node = new VertexNode<T, P, W>(old->vertex);
+        node->vertexEQ = old->vertexEQ;
+        node->vertex2str = old->vertex2str;
+        node->id_ = i;
+        node->graph = this;
+        node->inDegree_ = old->inDegree_;
+        node->outDegree_ = old->outDegree_;
+        node->adList.swap(old->adList);
+        node->adListFull.swap(old->adListFull);
+        node->inList.swap(old->inList);
+        node->outByPredicate.swap(old->outByPredicate);
+        node->inByPredicate.swap(old->inByPredicate);
+        nodes[i] = node;
+    }
+
+    // Cạnh được cấp phát lại theo đỉnh nguồn (thứ tự id mới) rồi thay mọi con trỏ cũ
+    std::unordered_map<Edge<T, P, W> *, Edge<T, P, W> *> moved;
+    for (auto node : nodes){
+        for (auto &edge : node->adList){
+            Edge<T, P, W> *copy = new Edge<T, P, W>(nodes[newId[edge->from->id_]], nodes[newId[edge->to->id_]]);
+            static_cast<typename W::slot_type &>(*copy) = static_cast<typename W::slot_type &>(*edge);
+            moved[edge] = copy;
+            delete edge;
+            edge = copy;
+        }
+    }
+    for (auto node : nodes){
+        for (auto &edge : node->adListFull) edge = moved[edge];
+        for (auto &edge : node->inList) edge = moved[edge];
+        for (auto &part : node->outByPredicate){
+            for (auto &edge : part.edges) edge = moved[edge];
+        }
+        for (auto &part : node->inByPredicate){
+            for (auto &edge : part.edges) edge = moved[edge];
+        }
+    }
+    for (auto old : nodeList){
+        delete old;
+    }
+    nodeList.swap(nodes);
+
+    for (auto &id : insertion){
+        id = newId[id];
+    }
+    if (indexed){
+        vertexIndex.clear();
+        for (int id : insertion){
+            vertexIndex.insert(nodeList[id]);
+        }
+    }
+    if (acyclic){
+        vector<int> ranks(n);
+        for (int v = 0; v < n; v++){
+            ranks[newId[v]] = rank[v];
+        }
+        rank.swap(ranks);
+        mark.assign(n, 0);
+        stamp = 0;
+    }
+    touch(); // id đỉnh đổi: bảng theo id cũ không còn đúng
+}
+
+template <class T, class P, class W>
+vector<VertexNode<T, P, W> *> DGraphModel<T, P, W>::bfsOrder(VertexNode<T, P, W> *startNode, int predicate, bool reverse){
+    // Bước 1: Khởi tạo cấu trúc dữ liệu cần thiết cho BFS
+    vector<bool> visited(nodeList.size(), false);       // theo dõi và đánh dấu đỉnh đã thăm
+    vector<VertexNode<T, P, W>*> visitOrder;                  // lưu thứ tự các đỉnh được thăm
+    Queue<VertexNode<T, P, W> *> queue;                       // hàng đợi để hỗ trợ quá trình duyệt BFS
+
+    // Bước 2: Bắt đầu quá trình duyệt BFS - thêm đỉnh bắt đầu vào hàng đợi và đánh dấu là đã thăm
+    // (chỉ số của đỉnh trong nodeList chính là id_, không cần tìm tuyến tính)
+    queue.enqueue(startNode);
+    visited[startNode->id_] = true;
+
+    // Bước 3: Thực hiện duyệt BFS
+    while (!queue.isEmpty()){
+        // Lấy đỉnh hiện tại từ hàng đợi
+        VertexNode<T, P, W> *current = queue.dequeue();
+        visitOrder.push_back(current);
+
+        // Duyệt qua các đỉnh kề của đỉnh hiện tại: cạnh đi ra, hoặc cạnh đi vào khi duyệt ngược
+        // (chỉ các cạnh của vị từ nếu có lọc)
+        ArrayView<Edge<T, P, W> *> edges = reverse ? current->getInList(predicate) : current->getAdList(predicate);
+        for (auto edge : edges){
+            VertexNode<T, P, W> *neighbor = reverse ? edge->from : edge->to;
+            if (!visited[neighbor->id_]) {
+                visited[neighbor->id_] = true;
+                queue.enqueue(neighbor);
+            }
+        }
+    }
+    return visitOrder;
+}
+
+template <class T, class P, class W>
+vector<VertexNode<T, P, W> *> DGraphModel<T, P, W>::dfsOrder(VertexNode<T, P, W> *startNode, int predicate, bool reverse){
+    vector<bool> visited(nodeList.size(), false);
+    vector<VertexNode<T, P, W>*> visitOrder;
+    Stack<VertexNode<T, P, W> *> stack;
+
+    stack.push(startNode);
+    
+    while (!stack.isEmpty()){
+        VertexNode<T, P, W> *current = stack.pop();
+        
+        if (visited[current->id_]) continue;
+        visited[current->id_] = true;
+        visitOrder.push_back(current);
+        
+        ArrayView<Edge<T, P, W> *> edges = reverse ? current->getInList(predicate) : current->getAdList(predicate);
+        for (int i = edges.size() - 1; i >= 0; i--){
+            VertexNode<T, P, W> *neighbor = reverse ? edges[i]->from : edges[i]->to;
+            if (!visited[neighbor->id_]){
+                stack.push(neighbor);
+            }
+        }
+    }
+    return visitOrder;
+}
+
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::visitString(const vector<VertexNode<T, P, W> *> &visitOrder){
+    // Tạo chuỗi kết quả
+    stringstream ss;
+    ss << "[";
+    for (size_t i = 0; i < visitOrder.size(); i++){
+        if (i > 0) ss << ", ";
+        ss << vertex2Str(*visitOrder[i]); // LUÔN dùng vertex2Str
+    }
+    ss << "]";
+    return ss.str();
+}
+
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::BFS(const T &start, int predicate){
+    // ktra đỉnh bắt đầu có tồn tại ko 
+    VertexNode<T, P, W> *startNode = getVertexNode(start);
+    if (startNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    return visitString(bfsOrder(startNode, predicate, false));
+}
+
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::DFS(const T &start, int predicate){
+    VertexNode<T, P, W> *startNode = getVertexNode(start);
+    if (startNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    return visitString(dfsOrder(startNode, predicate, false));
+}
+
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::reverseBFS(const T &start, int predicate){
+    VertexNode<T, P, W> *startNode = getVertexNode(start);
+    if (startNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    return visitString(bfsOrder(startNode, predicate, true));
+}
+
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::reverseDFS(const T &start, int predicate){
+    VertexNode<T, P, W> *startNode = getVertexNode(start);
+    if (startNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    return visitString(dfsOrder(startNode, predicate, true));
+}
 
-    bool isReachable(string from, string to);
+template <class T, class P, class W>
+vector<T> DGraphModel<T, P, W>::getPredecessors(const T &vertex, int predicate){
+    // các đỉnh có cạnh đi tới vertex, theo thứ tự cạnh được tạo; O(bậc vào)
+    VertexNode<T, P, W> *node = getVertexNode(vertex);
+    if (node == nullptr){
+        throw VertexNotFoundException();
+    }
+    vector<T> result;
+    for (auto edge : node->getInList(predicate)){
+        result.push_back(edge->from->vertex);
+    }
+    return result;
+}
+
+template <class T, class P, class W>
+ArrayView<Edge<T, P, W> *> DGraphModel<T, P, W>::getInwardEdges(const T &to, int predicate){
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    return toNode->getInList(predicate);
+}
+
+// =====================================
+// Shortest paths
+// =====================================
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::label(VertexNode<T, P, W> *node){
+    // tên ngắn gọn của đỉnh (dùng trong thông báo lỗi), giống cách Edge::toString() in đỉnh
+    if (vertex2str.enabled())
+        return vertex2str(node->vertex);
+    stringstream ss;
+    ss << node->vertex;
+    return ss.str();
+}
+
+template <class T, class P, class W>
+bool DGraphModel<T, P, W>::dijkstra(VertexNode<T, P, W> *source, int predicate, bool reverse, VertexNode<T, P, W> *target,
+                                    vector<distance_type> &dist, vector<Edge<T, P, W> *> &via){
+    // Dijkstra với binary heap (xóa lười): O((V + E) log V). Trả về false nếu gặp cạnh trọng số âm.
+    typedef pair<distance_type, int> Entry;
+    std::priority_queue<Entry, vector<Entry>, std::greater<Entry> > heap;
+    vector<bool> settled(nodeList.size(), false);
+
+    dist[source->id_] = 0;
+    heap.push(Entry(0, source->id_));
+    while (!heap.empty()){
+        Entry top = heap.top();
+        heap.pop();
+        if (settled[top.second])
+            continue;
+        settled[top.second] = true;
+        VertexNode<T, P, W> *current = nodeList[top.second];
+        if (current == target)
+            return true; // khoảng cách tới target đã chốt
+
+        ArrayView<Edge<T, P, W> *> edges = reverse ? current->getInList(predicate) : current->getAdList(predicate);
+        for (auto edge : edges){
+            weight_type weight = edge->getWeight();
+            if (weight < 0)
+                return false;
+            VertexNode<T, P, W> *neighbor = reverse ? edge->from : edge->to;
+            distance_type candidate = top.first + static_cast<distance_type>(weight);
+            if (!settled[neighbor->id_] && candidate < dist[neighbor->id_]){
+                dist[neighbor->id_] = candidate;
+                via[neighbor->id_] = edge;
+                heap.push(Entry(candidate, neighbor->id_));
+            }
+        }
+    }
+    return true;
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::spfa(VertexNode<T, P, W> *source, int predicate, bool reverse,
+                                vector<distance_type> &dist, vector<Edge<T, P, W> *> &via, weight_type maxWeight){
+    // SPFA: Bellman-Ford chỉ nới lỏng các đỉnh vừa thay đổi. Đường đi ngắn nhất có >= V cạnh
+    // nghĩa là có chu trình âm tới được từ source.
+    size_t n = nodeList.size();
+    vector<int> hops(n, 0);
+    vector<bool> queued(n, false);
+    std::queue<int> pending;
+
+    dist[source->id_] = 0;
+    pending.push(source->id_);
+    queued[source->id_] = true;
+    while (!pending.empty()){
+        int u = pending.front();
+        pending.pop();
+        queued[u] = false;
+
+        ArrayView<Edge<T, P, W> *> edges = reverse ? nodeList[u]->getInList(predicate) : nodeList[u]->getAdList(predicate);
+        for (auto edge : edges){
+            if (edge->getWeight() > maxWeight)
+                continue;
+            VertexNode<T, P, W> *neighbor = reverse ? edge->from : edge->to;
+            int v = neighbor->id_;
+            distance_type candidate = dist[u] + static_cast<distance_type>(edge->getWeight());
+            if (candidate < dist[v]){
+                dist[v] = candidate;
+                via[v] = edge;
+                hops[v] = hops[u] + 1;
+                if (static_cast<size_t>(hops[v]) >= n){
+                    // đường đi có >= V cạnh => có chu trình âm; chu trình sẽ xuất hiện trong cây via
+                    // (mọi chu trình của cây via đều âm). Nếu chưa thấy thì chạy tiếp và kiểm tra lại.
+                    VertexNode<T, P, W> *onCycle = nullptr;
+                    vector<bool> seen(n, false);
+                    for (VertexNode<T, P, W> *walk = neighbor; walk != nullptr && via[walk->id_] != nullptr;
+                         walk = reverse ? via[walk->id_]->to : via[walk->id_]->from){
+                        if (seen[walk->id_]){
+                            onCycle = walk;
+                            break;
+                        }
+                        seen[walk->id_] = true;
+                    }
+                    if (onCycle != nullptr){
+                        vector<VertexNode<T, P, W> *> cycle(1, onCycle);
+                        VertexNode<T, P, W> *walk = reverse ? via[onCycle->id_]->to : via[onCycle->id_]->from;
+                        while (walk != onCycle){
+                            cycle.push_back(walk);
+                            walk = reverse ? via[walk->id_]->to : via[walk->id_]->from;
+                        }
+                        cycle.push_back(onCycle);
+                        if (!reverse)
+                            std::reverse(cycle.begin(), cycle.end()); // via trỏ ngược chiều cạnh
+                        stringstream ss;
+                        ss << "Negative cycle: ";
+                        for (size_t i = 0; i < cycle.size(); i++){
+                            if (i > 0) ss << " -> ";
+                            ss << label(cycle[i]);
+                        }
+                        throw NegativeCycleException(ss.str());
+                    }
+                }
+                if (!queued[v]){
+                    queued[v] = true;
+                    pending.push(v);
+                }
+            }
+        }
+    }
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::singleSource(VertexNode<T, P, W> *source, int predicate, bool reverse, VertexNode<T, P, W> *target,
+                                        vector<distance_type> &dist, vector<Edge<T, P, W> *> &via){
+    dist.assign(nodeList.size(), unreachable());
+    via.assign(nodeList.size(), nullptr);
+    // Dijkstra dừng sớm ở target nên có thể chưa gặp cạnh âm nằm ngoài biên: chỉ dùng khi đồ thị
+    // chưa từng lưu trọng số âm (cờ được bật bởi Edge::setWeight(), kể cả khi gọi trực tiếp)
+    if (!negativeWeights && dijkstra(source, predicate, reverse, target, dist, via))
+        return;
+    // có cạnh âm tới được từ source: tính lại bằng SPFA
+    dist.assign(nodeList.size(), unreachable());
+    via.assign(nodeList.size(), nullptr);
+    spfa(source, predicate, reverse, dist, via);
+}
+
+template <class T, class P, class W>
+PathResult<T, typename W::distance_type> DGraphModel<T, P, W>::shortestPath(const T &from, const T &to, int predicate){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (fromNode == nullptr || toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+
+    vector<distance_type> dist;
+    vector<Edge<T, P, W> *> via;
+    singleSource(fromNode, predicate, false, toNode, dist, via);
+
+    PathResult<T, distance_type> result;
+    if (dist[toNode->id_] == unreachable())
+        return result;
+    result.found = true;
+    result.distance = dist[toNode->id_];
+    for (VertexNode<T, P, W> *walk = toNode; walk != fromNode; walk = via[walk->id_]->from){
+        result.path.push_back(walk->vertex);
+    }
+    result.path.push_back(fromNode->vertex);
+    std::reverse(result.path.begin(), result.path.end());
+    return result;
+}
+
+template <class T, class P, class W>
+vector<pair<T, typename W::distance_type> > DGraphModel<T, P, W>::shortestDistances(const T &from, int predicate){
+    // các đỉnh tới được (kể cả from) theo thứ tự thêm
+    vector<distance_type> dist = distanceTable(from, predicate, false);
+    vector<pair<T, distance_type> > result;
+    for (int id : insertion){
+        if (dist[id] != unreachable())
+            result.push_back(make_pair(nodeList[id]->vertex, dist[id]));
+    }
+    return result;
+}
+
+template <class T, class P, class W>
+vector<typename W::distance_type> DGraphModel<T, P, W>::distanceTable(const T &source, int predicate, bool reverse){
+    VertexNode<T, P, W> *sourceNode = getVertexNode(source);
+    if (sourceNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    vector<distance_type> dist;
+    vector<Edge<T, P, W> *> via;
+    singleSource(sourceNode, predicate, reverse, nullptr, dist, via);
+    return dist;
+}
+
+template <class T, class P, class W>
+bool DGraphModel<T, P, W>::boundedDijkstra(VertexNode<T, P, W> *source, distance_type budget, weight_type maxEdgeWeight,
+                                           size_t limit, int predicate, vector<pair<T, distance_type> > &result){
+    // Dijkstra cắt cụt (xóa lười), bảng khoảng cách là hash map nên chi phí chỉ tỉ lệ với vùng đã chạm tới.
+    // Đỉnh được chốt theo đúng thứ tự (khoảng cách, id) của kết quả. Trả về false nếu gặp cạnh trọng số âm.
+    typedef pair<distance_type, int> Entry;
+    std::priority_queue<Entry, vector<Entry>, std::greater<Entry> > heap;
+    unordered_map<int, distance_type> dist;
+
+    dist[source->id_] = 0;
+    heap.push(Entry(0, source->id_));
+    while (!heap.empty() && heap.top().first <= budget){
+        Entry top = heap.top();
+        heap.pop();
+        if (top.first > dist[top.second])
+            continue; // bản cũ: đỉnh đã được đẩy lại với khóa nhỏ hơn
+        if (top.second != source->id_){
+            result.push_back(make_pair(nodeList[top.second]->vertex, top.first));
+            if (limit > 0 && result.size() == limit)
+                return true;
+        }
+
+        for (auto edge : nodeList[top.second]->getAdList(predicate)){
+            weight_type weight = edge->getWeight();
+            if (weight < 0)
+                return false;
+            if (weight > maxEdgeWeight)
+                continue;
+            distance_type candidate = top.first + static_cast<distance_type>(weight);
+            if (candidate > budget)
+                continue;
+            typename unordered_map<int, distance_type>::iterator known = dist.find(edge->to->id_);
+            if (known == dist.end()){
+                dist.insert(make_pair(edge->to->id_, candidate));
+                heap.push(Entry(candidate, edge->to->id_));
+            }
+            else if (candidate < known->second){
+                known->second = candidate;
+                heap.push(Entry(candidate, edge->to->id_));
+            }
+        }
+    }
+    return true;
+}
+
+template <class T, class P, class W>
+vector<pair<T, typename W::distance_type> > DGraphModel<T, P, W>::withinDistance(const T &source, distance_type budget,
+                                                                                weight_type maxEdgeWeight, size_t limit,
+                                                                                int predicate){
+    VertexNode<T, P, W> *sourceNode = getVertexNode(source);
+    if (sourceNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    vector<pair<T, distance_type> > result;
+    // như singleSource(): cạnh âm nằm ngoài vùng budget vẫn có thể rút ngắn đường tới một đỉnh trong vùng,
+    // nên chỉ cắt cụt khi đồ thị chưa từng có trọng số âm
+    if (!negativeWeights && (budget < 0 || boundedDijkstra(sourceNode, budget, maxEdgeWeight, limit, predicate, result)))
+        return result;
+
+    result.clear();
+    vector<distance_type> dist(nodeList.size(), unreachable());
+    vector<Edge<T, P, W> *> via(nodeList.size(), nullptr);
+    spfa(sourceNode, predicate, false, dist, via, maxEdgeWeight);
+    vector<pair<distance_type, int> > reached;
+    for (size_t id = 0; id < dist.size(); id++){
+        if (static_cast<int>(id) != sourceNode->id_ && dist[id] <= budget)
+            reached.push_back(make_pair(dist[id], static_cast<int>(id)));
+    }
+    std::sort(reached.begin(), reached.end());
+    if (limit > 0 && reached.size() > limit)
+        reached.resize(limit);
+    for (const pair<distance_type, int> &hit : reached){
+        result.push_back(make_pair(nodeList[hit.second]->vertex, hit.first));
+    }
+    return result;
+}
+
+template <class T, class P, class W>
+vector<typename W::distance_type> DGraphModel<T, P, W>::finiteDistanceTable(const T &source, int predicate, bool reverse){
+    VertexNode<T, P, W> *sourceNode = getVertexNode(source);
+    if (sourceNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    size_t n = nodeList.size();
+    vector<distance_type> dist(n, unreachable());
+    dist[sourceNode->id_] = 0;
+    // V - 1 vòng nới lỏng là đủ cho mọi đỉnh không bị chu trình âm ảnh hưởng; vòng thứ V còn nới được
+    // đỉnh nào thì đỉnh đó (và mọi đỉnh đi tiếp được từ nó) có khoảng cách -vô cùng
+    vector<bool> unbounded(n, false);
+    std::queue<int> spread;
+    for (size_t round = 0; round < n; round++){
+        bool changed = false;
+        for (size_t u = 0; u < n; u++){
+            if (dist[u] == unreachable())
+                continue;
+            ArrayView<Edge<T, P, W> *> edges = reverse ? nodeList[u]->getInList(predicate) : nodeList[u]->getAdList(predicate);
+            for (auto edge : edges){
+                int v = (reverse ? edge->from : edge->to)->id_;
+                distance_type candidate = dist[u] + static_cast<distance_type>(edge->getWeight());
+                if (candidate < dist[v]){
+                    changed = true;
+                    if (round + 1 < n){
+                        dist[v] = candidate;
+                    }
+                    else if (!unbounded[v]){
+                        unbounded[v] = true;
+                        spread.push(v);
+                    }
+                }
+            }
+        }
+        if (!changed)
+            break;
+    }
+    while (!spread.empty()){
+        int u = spread.front();
+        spread.pop();
+        dist[u] = unreachable();
+        ArrayView<Edge<T, P, W> *> edges = reverse ? nodeList[u]->getInList(predicate) : nodeList[u]->getAdList(predicate);
+        for (auto edge : edges){
+            int v = (reverse ? edge->from : edge->to)->id_;
+            if (!unbounded[v]){
+                unbounded[v] = true;
+                spread.push(v);
+            }
+        }
+    }
+    return dist;
+}
+
+template <class T, class P, class W>
+size_t DGraphModel<T, P, W>::edgeCount(){
+    size_t count = 0;
+    for (auto node : nodeList){
+        count += node->outDegree_;
+    }
+    return count;
+}
+
+template <class T, class P, class W>
+PathResult<T, typename W::distance_type> DGraphModel<T, P, W>::tracePath(VertexNode<T, P, W> *meet, distance_type distance,
+                                                                         const vector<Edge<T, P, W> *> &forward,
+                                                                         const vector<Edge<T, P, W> *> &backward){
+    // forward[v]: cạnh đi vào v trên đường từ from; backward[v]: cạnh đi ra từ v trên đường tới to
+    PathResult<T, distance_type> result;
+    result.found = true;
+    result.distance = distance;
+    for (VertexNode<T, P, W> *walk = meet; walk != nullptr; walk = forward[walk->id_] != nullptr ? forward[walk->id_]->from : nullptr){
+        result.path.push_back(walk->vertex);
+    }
+    std::reverse(result.path.begin(), result.path.end());
+    for (Edge<T, P, W> *edge = backward[meet->id_]; edge != nullptr; edge = backward[edge->to->id_]){
+        result.path.push_back(edge->to->vertex);
+    }
+    return result;
+}
+
+template <class T, class P, class W>
+PathResult<T, typename W::distance_type> DGraphModel<T, P, W>::bidirectionalPath(const T &from, const T &to, int predicate){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (fromNode == nullptr || toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    if (negativeWeights){
+        return shortestPath(from, to, predicate);
+    }
+
+    // hai Dijkstra (heap xóa lười) chạy xen kẽ, mỗi bước mở rộng phía có đỉnh heap nhỏ hơn.
+    // best = đường ngắn nhất đã thấy qua một đỉnh mà cả hai phía đã gán nhãn; dừng khi
+    // topF + topB >= best vì mọi đường chưa xét đều dài ít nhất chừng đó.
+    typedef pair<distance_type, int> Entry;
+    typedef std::priority_queue<Entry, vector<Entry>, std::greater<Entry> > Heap;
+    size_t n = nodeList.size();
+    vector<distance_type> dist[2] = {vector<distance_type>(n, unreachable()), vector<distance_type>(n, unreachable())};
+    vector<Edge<T, P, W> *> via[2] = {vector<Edge<T, P, W> *>(n, nullptr), vector<Edge<T, P, W> *>(n, nullptr)};
+    vector<bool> settled[2] = {vector<bool>(n, false), vector<bool>(n, false)};
+    Heap heap[2];
+
+    dist[0][fromNode->id_] = 0;
+    dist[1][toNode->id_] = 0;
+    heap[0].push(Entry(0, fromNode->id_));
+    heap[1].push(Entry(0, toNode->id_));
+    distance_type best = fromNode == toNode ? 0 : unreachable();
+    VertexNode<T, P, W> *meet = fromNode == toNode ? fromNode : nullptr;
+    int expanded = 0;
+
+    while (!heap[0].empty() && !heap[1].empty()){
+        distance_type topF = heap[0].top().first;
+        distance_type topB = heap[1].top().first;
+        if (best != unreachable() && topF + topB >= best)
+            break;
+        int side = topF <= topB ? 0 : 1;
+        Entry top = heap[side].top();
+        heap[side].pop();
+        if (settled[side][top.second])
+            continue;
+        settled[side][top.second] = true;
+        expanded++;
+
+        VertexNode<T, P, W> *current = nodeList[top.second];
+        ArrayView<Edge<T, P, W> *> edges = side == 0 ? current->getAdList(predicate) : current->getInList(predicate);
+        for (auto edge : edges){
+            weight_type weight = edge->getWeight();
+            if (weight < 0)
+                return shortestPath(from, to, predicate);
+            VertexNode<T, P, W> *neighbor = side == 0 ? edge->to : edge->from;
+            int v = neighbor->id_;
+            distance_type candidate = top.first + static_cast<distance_type>(weight);
+            if (!settled[side][v] && candidate < dist[side][v]){
+                dist[side][v] = candidate;
+                via[side][v] = edge;
+                heap[side].push(Entry(candidate, v));
+            }
+            if (dist[1 - side][v] != unreachable() && dist[side][v] + dist[1 - side][v] < best){
+                best = dist[side][v] + dist[1 - side][v];
+                meet = neighbor;
+            }
+        }
+    }
+
+    PathResult<T, distance_type> result;
+    if (meet != nullptr){
+        result = tracePath(meet, best, via[0], via[1]);
+    }
+    result.expanded = expanded;
+    return result;
+}
+
+template <class T, class P, class W>
+LandmarkTable<typename W::distance_type> DGraphModel<T, P, W>::buildLandmarks(int count){
+    // chọn landmark kiểu "xa nhất lần lượt": landmark đầu là đỉnh có bậc ra lớn nhất, mỗi landmark
+    // tiếp theo là đỉnh có khoảng cách nhỏ nhất tới các landmark đã chọn lớn nhất (không tới được
+    // coi là xa nhất), hòa thì lấy id nhỏ hơn
+    LandmarkTable<distance_type> table;
+    table.vertexCount = nodeList.size();
+    table.edgeCount = edgeCount();
+    table.fingerprint = fingerprint();
+    table.revision = revision;
+    if (nodeList.empty() || count <= 0)
+        return table;
+    count = std::min<size_t>(count, nodeList.size());
+
+    int next = 0;
+    for (size_t i = 1; i < nodeList.size(); i++){
+        if (nodeList[i]->outDegree_ > nodeList[next]->outDegree_)
+            next = i;
+    }
+    vector<distance_type> nearest(nodeList.size(), unreachable());
+    vector<bool> chosen(nodeList.size(), false);
+    vector<Edge<T, P, W> *> via;
+    for (int k = 0; k < count; k++){
+        table.landmarks.push_back(next);
+        chosen[next] = true;
+        table.fromLandmark.push_back(vector<distance_type>());
+        table.toLandmark.push_back(vector<distance_type>());
+        singleSource(nodeList[next], PredicateTable::ANY, false, nullptr, table.fromLandmark.back(), via);
+        singleSource(nodeList[next], PredicateTable::ANY, true, nullptr, table.toLandmark.back(), via);
+
+        next = -1;
+        for (size_t v = 0; v < nodeList.size(); v++){
+            distance_type d = std::min(table.fromLandmark.back()[v], table.toLandmark.back()[v]);
+            if (d < nearest[v])
+                nearest[v] = d;
+            if (!chosen[v] && (next < 0 || nearest[v] > nearest[next]))
+                next = v;
+        }
+        if (next < 0)
+            break;
+    }
+    return table;
+}
+
+template <class T, class P, class W>
+bool DGraphModel<T, P, W>::landmarksMatch(const LandmarkTable<distance_type> &table){
+    // bảng chỉ đúng cho đồ thị lúc tính (connect()/disconnect()/setWeight() sau đó có thể làm cận dưới sai);
+    // chỉ đọc nên an toàn khi nhiều truy vấn chạy song song
+    return !table.empty() && table.revision == revision;
+}
+
+template <class T, class P, class W>
+bool DGraphModel<T, P, W>::bindLandmarks(LandmarkTable<distance_type> &table){
+    if (table.empty() || table.vertexCount != nodeList.size() || table.edgeCount != edgeCount()
+        || table.fingerprint != fingerprint())
+        return false;
+    table.revision = revision;
+    return true;
+}
+
+template <class T, class P, class W>
+unsigned long long DGraphModel<T, P, W>::fingerprint(){
+    unsigned long long hash = fnv1a(nullptr, 0);
+    for (auto node : nodeList){
+        for (auto edge : node->adList){
+            int ends[2] = {edge->from->id_, edge->to->id_};
+            distance_type weight = W::read(*edge); // trọng số đúng như khoảng cách trong bảng đã tính
+            hash = fnv1a(ends, sizeof(ends), hash);
+            hash = fnv1a(&weight, sizeof(weight), hash);
+        }
+    }
+    return hash;
+}
+
+template <class T, class P, class W>
+unsigned long long DGraphModel<T, P, W>::nextRevision(){
+    static std::atomic<unsigned long long> counter(0);
+    return ++counter;
+}
+
+template <class T, class P, class W>
+PathResult<T, typename W::distance_type> DGraphModel<T, P, W>::landmarkPath(const T &from, const T &to,
+                                                                            const LandmarkTable<distance_type> &table, int predicate){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (fromNode == nullptr || toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    if (negativeWeights){
+        return shortestPath(from, to, predicate);
+    }
+    if (!landmarksMatch(table)){
+        return bidirectionalPath(from, to, predicate);
+    }
+
+    // A* với h(v) = table.lowerBound(v, to): h nhất quán (suy ra từ bất đẳng thức tam giác) nên đỉnh
+    // lấy ra khỏi heap là đã chốt; đỉnh có h = unreachable() bị bỏ qua. Cận dưới tính trên mọi cạnh
+    // vẫn đúng khi chỉ đi theo một vị từ.
+    typedef pair<distance_type, int> Entry;
+    std::priority_queue<Entry, vector<Entry>, std::greater<Entry> > heap;
+    size_t n = nodeList.size();
+    int target = toNode->id_;
+    vector<distance_type> dist(n, unreachable());
+    vector<Edge<T, P, W> *> via(n, nullptr);
+    vector<bool> settled(n, false);
+    PathResult<T, distance_type> result;
+
+    distance_type h = table.lowerBound(fromNode->id_, target);
+    if (h == unreachable())
+        return result;
+    dist[fromNode->id_] = 0;
+    heap.push(Entry(h, fromNode->id_));
+    while (!heap.empty()){
+        Entry top = heap.top();
+        heap.pop();
+        if (settled[top.second])
+            continue;
+        settled[top.second] = true;
+        result.expanded++;
+        if (top.second == target){
+            int expanded = result.expanded;
+            result = tracePath(toNode, dist[target], via, vector<Edge<T, P, W> *>(n, nullptr));
+            result.expanded = expanded;
+            return result;
+        }
+
+        VertexNode<T, P, W> *current = nodeList[top.second];
+        for (auto edge : current->getAdList(predicate)){
+            weight_type weight = edge->getWeight();
+            if (weight < 0)
+                return shortestPath(from, to, predicate);
+            int v = edge->to->id_;
+            distance_type candidate = dist[top.second] + static_cast<distance_type>(weight);
+            if (settled[v] || candidate >= dist[v])
+                continue;
+            h = table.lowerBound(v, target);
+            if (h == unreachable())
+                continue;
+            dist[v] = candidate;
+            via[v] = edge;
+            heap.push(Entry(candidate + h, v));
+        }
+    }
+    return result;
+}
+
+
+// =====================================
+// Snapshot
+// =====================================
+template <class T, class P, class W>
+AdjacencySnapshot<typename W::value_type> DGraphModel<T, P, W>::snapshot(int predicate){
+    AdjacencySnapshot<weight_type> csr;
+    size_t n = nodeList.size();
+    csr.outOffsets.resize(n + 1);
+    csr.inOffsets.resize(n + 1);
+    for (size_t v = 0; v < n; v++){
+        ArrayView<Edge<T, P, W> *> out = nodeList[v]->getAdList(predicate);
+        ArrayView<Edge<T, P, W> *> in = nodeList[v]->getInList(predicate);
+        csr.outOffsets[v + 1] = csr.outOffsets[v] + out.size();
+        csr.inOffsets[v + 1] = csr.inOffsets[v] + in.size();
+    }
+    csr.outTargets.reserve(csr.outOffsets[n]);
+    csr.outWeights.reserve(csr.outOffsets[n]);
+    csr.inSources.reserve(csr.inOffsets[n]);
+    csr.inWeights.reserve(csr.inOffsets[n]);
+    for (size_t v = 0; v < n; v++){
+        for (auto edge : nodeList[v]->getAdList(predicate)){
+            csr.outTargets.push_back(edge->to->id_);
+            csr.outWeights.push_back(edge->getWeight());
+        }
+        for (auto edge : nodeList[v]->getInList(predicate)){
+            csr.inSources.push_back(edge->from->id_);
+            csr.inWeights.push_back(edge->getWeight());
+        }
+    }
+    return csr;
+}
+
+template <class T, class P, class W>
+CompressedAdjacency DGraphModel<T, P, W>::compress(WeightEncoding encoding, int predicate, bool reverse){
+    CompressedAdjacency compressed;
+    compressed.start(encoding);
+    vector<pair<int, double> > edges;
+    for (auto node : nodeList){
+        edges.clear();
+        for (auto edge : reverse ? node->getInList(predicate) : node->getAdList(predicate)){
+            edges.push_back(make_pair(reverse ? edge->from->id_ : edge->to->id_, static_cast<double>(edge->getWeight())));
+        }
+        compressed.appendVertex(edges);
+    }
+    compressed.finish();
+    return compressed;
+}
+
+// =====================================
+// Topological order
+// =====================================
+template <class T, class P, class W>
+vector<int> DGraphModel<T, P, W>::kahnOrder(int predicate, vector<int> &inDegree){
+    // Kahn: inDegree lấy từ inDegree_ (mọi cạnh) hoặc số cạnh vào mang predicate; sau khi chạy,
+    // các đỉnh còn inDegree > 0 là các đỉnh nằm trên hoặc sau một chu trình
+    size_t n = nodeList.size();
+    inDegree.resize(n);
+    std::queue<int> ready;
+    for (int v : insertion){
+        inDegree[v] = predicate == PredicateTable::ANY ? nodeList[v]->inDegree_ : static_cast<int>(nodeList[v]->getInList(predicate).size());
+        if (inDegree[v] == 0)
+            ready.push(v);
+    }
+    vector<int> order;
+    order.reserve(n);
+    while (!ready.empty()){
+        int u = ready.front();
+        ready.pop();
+        order.push_back(u);
+        for (auto edge : nodeList[u]->getAdList(predicate)){
+            if (--inDegree[edge->to->id_] == 0)
+                ready.push(edge->to->id_);
+        }
+    }
+    return order;
+}
+
+template <class T, class P, class W>
+string DGraphModel<T, P, W>::cycleMessage(const vector<VertexNode<T, P, W> *> &cycle){
+    stringstream ss;
+    ss << "Cycle: ";
+    for (size_t i = 0; i < cycle.size(); i++){
+        if (i > 0) ss << " -> ";
+        ss << label(cycle[i]);
+    }
+    return ss.str();
+}
+
+template <class T, class P, class W>
+vector<T> DGraphModel<T, P, W>::topologicalSort(int predicate){
+    vector<int> inDegree;
+    vector<int> order = kahnOrder(predicate, inDegree);
+    if (order.size() < nodeList.size()){
+        vector<T> cycle = findCycle(predicate);
+        vector<VertexNode<T, P, W> *> nodes;
+        for (const T &vertex : cycle){
+            nodes.push_back(getVertexNode(vertex));
+        }
+        throw CycleException(cycleMessage(nodes));
+    }
+    vector<T> result;
+    result.reserve(order.size());
+    for (int id : order){
+        result.push_back(nodeList[id]->vertex);
+    }
+    return result;
+}
+
+template <class T, class P, class W>
+vector<T> DGraphModel<T, P, W>::findCycle(int predicate){
+    vector<int> inDegree;
+    vector<int> order = kahnOrder(predicate, inDegree);
+    vector<T> result;
+    if (order.size() == nodeList.size())
+        return result;
+
+    // mỗi đỉnh còn lại đều có một cạnh vào từ một đỉnh còn lại: đi ngược theo các cạnh đó cho tới khi
+    // gặp lại một đỉnh, đoạn lặp chính là chu trình (đi ngược nên đảo lại ở cuối)
+    size_t first = 0;
+    while (inDegree[insertion[first]] == 0)
+        first++;
+    int start = insertion[first];
+    vector<int> seenAt(nodeList.size(), -1);
+    vector<VertexNode<T, P, W> *> walk;
+    VertexNode<T, P, W> *current = nodeList[start];
+    while (seenAt[current->id_] < 0){
+        seenAt[current->id_] = walk.size();
+        walk.push_back(current);
+        for (auto edge : current->getInList(predicate)){
+            if (inDegree[edge->from->id_] > 0){
+                current = edge->from;
+                break;
+            }
+        }
+    }
+    // walk[i + 1] -> walk[i] là cạnh, và current (= walk[s]) -> walk.back()
+    size_t s = seenAt[current->id_];
+    result.push_back(current->vertex);
+    for (size_t i = walk.size(); i-- > s;){
+        result.push_back(walk[i]->vertex);
+    }
+    return result;
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::enforceAcyclic(bool enabled, int predicate){
+    acyclic = false;
+    rank.clear();
+    mark.clear();
+    if (!enabled)
+        return;
+    vector<int> inDegree;
+    vector<int> order = kahnOrder(predicate, inDegree);
+    if (order.size() < nodeList.size()){
+        topologicalSort(predicate); // ném CycleException kèm chu trình
+    }
+    rank.resize(nodeList.size());
+    for (size_t i = 0; i < order.size(); i++){
+        rank[order[i]] = i;
+    }
+    mark.assign(nodeList.size(), 0);
+    acyclic = true;
+    acyclicPredicate = predicate;
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::insertOrdered(VertexNode<T, P, W> *fromNode, VertexNode<T, P, W> *toNode){
+    // Pearce-Kelly: cạnh x -> y với rank[x] < rank[y] không làm sai thứ tự. Ngược lại chỉ các đỉnh có
+    // rank trong [rank[y], rank[x]] bị ảnh hưởng: forward = tới được từ y, backward = tới được x.
+    // Nếu forward chứa x thì cạnh khép kín chu trình. Nếu không, xếp backward rồi forward vào đúng các
+    // vị trí rank mà chúng đang chiếm.
+    int x = fromNode->id_, y = toNode->id_;
+    if (x == y){
+        throw CycleException(cycleMessage(vector<VertexNode<T, P, W> *>(2, fromNode)));
+    }
+    int lower = rank[y], upper = rank[x];
+    if (lower > upper)
+        return;
+    if (++stamp == 0){ // tràn số: xóa dấu cũ
+        mark.assign(mark.size(), 0);
+        stamp = 1;
+    }
+
+    vector<int> forward, backward;
+    std::unordered_map<int, Edge<T, P, W> *> parent; // để in chu trình y -> ... -> x
+    vector<int> pending(1, y);
+    mark[y] = stamp;
+    while (!pending.empty()){
+        int u = pending.back();
+        pending.pop_back();
+        forward.push_back(u);
+        for (auto edge : nodeList[u]->getAdList(acyclicPredicate)){
+            int v = edge->to->id_;
+            if (v == x || (mark[v] != stamp && rank[v] <= upper)){
+                parent[v] = edge;
+                if (v == x){
+                    vector<VertexNode<T, P, W> *> cycle(1, fromNode);
+                    for (int walk = x; walk != y; walk = parent[walk]->from->id_){
+                        cycle.push_back(parent[walk]->from);
+                    }
+                    std::reverse(cycle.begin() + 1, cycle.end());
+                    cycle.push_back(fromNode);
+                    throw CycleException(cycleMessage(cycle));
+                }
+                mark[v] = stamp;
+                pending.push_back(v);
+            }
+        }
+    }
+
+    pending.assign(1, x);
+    mark[x] = stamp;
+    while (!pending.empty()){
+        int u = pending.back();
+        pending.pop_back();
+        backward.push_back(u);
+        for (auto edge : nodeList[u]->getInList(acyclicPredicate)){
+            int v = edge->from->id_;
+            if (mark[v] != stamp && rank[v] >= lower){
+                mark[v] = stamp;
+                pending.push_back(v);
+            }
+        }
+    }
+
+    // giữ thứ tự tương đối trong từng nhóm, backward đứng trước forward
+    const vector<int> &ranks = rank;
+    auto byRank = [&ranks](int a, int b) { return ranks[a] < ranks[b]; };
+    std::sort(forward.begin(), forward.end(), byRank);
+    std::sort(backward.begin(), backward.end(), byRank);
+    vector<int> slots;
+    for (int v : backward) slots.push_back(rank[v]);
+    for (int v : forward) slots.push_back(rank[v]);
+    std::sort(slots.begin(), slots.end());
+    size_t next = 0;
+    for (int v : backward) rank[v] = slots[next++];
+    for (int v : forward) rank[v] = slots[next++];
+}
+
+// =====================================
+// Strongly connected components
+// =====================================
+template <class T, class P, class W>
+ComponentLabels DGraphModel<T, P, W>::componentLabels(int predicate){
+    // Tarjan với stack tường minh: mỗi khung giữ đỉnh và vị trí cạnh kế tiếp cần xét
+    int n = nodeList.size();
+    ComponentLabels labels;
+    labels.component.assign(n, -1);
+    vector<int> index(n, -1), low(n, 0);
+    vector<bool> onStack(n, false);
+    vector<int> members;              // stack các đỉnh chưa được gán thành phần
+    vector<pair<int, size_t> > frames; // (đỉnh, cạnh kế tiếp)
+    int counter = 0;
+
+    for (int root : insertion){
+        if (index[root] >= 0)
+            continue;
+        frames.push_back(make_pair(root, 0));
+        index[root] = low[root] = counter++;
+        members.push_back(root);
+        onStack[root] = true;
+
+        while (!frames.empty()){
+            int u = frames.back().first;
+            ArrayView<Edge<T, P, W> *> edges = nodeList[u]->getAdList(predicate);
+            if (frames.back().second < edges.size()){
+                int v = edges[frames.back().second++]->to->id_;
+                if (index[v] < 0){
+                    index[v] = low[v] = counter++;
+                    members.push_back(v);
+                    onStack[v] = true;
+                    frames.push_back(make_pair(v, 0));
+                }
+                else if (onStack[v]){
+                    low[u] = std::min(low[u], index[v]);
+                }
+                continue;
+            }
+
+            // đã xét hết cạnh của u
+            frames.pop_back();
+            if (!frames.empty()){
+                int parent = frames.back().first;
+                low[parent] = std::min(low[parent], low[u]);
+            }
+            if (low[u] == index[u]){
+                int w;
+                do {
+                    w = members.back();
+                    members.pop_back();
+                    onStack[w] = false;
+                    labels.component[w] = labels.count;
+                } while (w != u);
+                labels.count++;
+            }
+        }
+    }
+
+    // Tarjan hoàn thành thành phần theo thứ tự tô-pô ngược: đảo lại
+    for (int v = 0; v < n; v++){
+        labels.component[v] = labels.count - 1 - labels.component[v];
+    }
+    return labels;
+}
+
+template <class T, class P, class W>
+vector<vector<T> > DGraphModel<T, P, W>::stronglyConnectedComponents(int predicate){
+    ComponentLabels labels = componentLabels(predicate);
+    vector<vector<T> > components(labels.count);
+    for (int id : insertion){
+        components[labels.component[id]].push_back(nodeList[id]->vertex);
+    }
+    return components;
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::condensation(const ComponentLabels &labels, DGraphModel<int, NativeVertexPolicy<int>, W> &dag,
+                                        int threads, int predicate){
+    typedef pair<pair<int, int>, weight_type> Link; // ((thành phần nguồn, thành phần đích), trọng số)
+    dag.clear();
+    for (int c = 0; c < labels.count; c++){
+        dag.add(c);
+    }
+
+    // mỗi luồng thu các cạnh giữa hai thành phần khác nhau của một khoảng đỉnh vào danh sách riêng,
+    // sau đó gộp, sắp xếp và giữ trọng số nhỏ nhất cho mỗi cặp => kết quả không phụ thuộc số luồng
+    int n = nodeList.size();
+    vector<vector<Link> > parts(std::max(1, std::min(threads, n)));
+    parallelFor(n, threads, [this, &labels, &parts, predicate](int begin, int end, int part){
+        for (int u = begin; u < end; u++){
+            int cu = labels.component[u];
+            for (auto edge : nodeList[u]->getAdList(predicate)){
+                int cv = labels.component[edge->to->id_];
+                if (cu != cv)
+                    parts[part].push_back(Link(make_pair(cu, cv), edge->getWeight()));
+            }
+        }
+    });
+
+    vector<Link> links;
+    for (auto &part : parts){
+        links.insert(links.end(), part.begin(), part.end());
+    }
+    std::sort(links.begin(), links.end());
+    for (size_t i = 0; i < links.size(); i++){
+        if (i == 0 || links[i].first != links[i - 1].first)
+            dag.connect(links[i].first.first, links[i].first.second, links[i].second);
+    }
+}
+
+template <class T, class P, class W>
+template <class Position>
+PathResult<T, typename W::distance_type> DGraphModel<T, P, W>::astarPath(const T &from, const T &to, Position position,
+                                                                         double heuristicScale, int predicate){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (fromNode == nullptr || toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    if (negativeWeights){
+        return shortestPath(from, to, predicate);
+    }
+
+    size_t n = nodeList.size();
+    const Point *goal = position(toNode->vertex);
+    Point target = goal != nullptr ? *goal : Point();
+    // h(v) chỉ tính một lần cho mỗi đỉnh (-1 = chưa tính)
+    vector<double> h(n, -1);
+    vector<distance_type> dist(n, unreachable());
+    vector<Edge<T, P, W> *> via(n, nullptr);
+    IndexedMinHeap<double> open(n);
+    PathResult<T, distance_type> result;
+
+    dist[fromNode->id_] = 0;
+    open.push(fromNode->id_, 0);
+    while (!open.empty()){
+        int u = open.pop();
+        result.expanded++;
+        if (u == toNode->id_){
+            int expanded = result.expanded;
+            result = tracePath(toNode, dist[u], via, vector<Edge<T, P, W> *>(n, nullptr));
+            result.expanded = expanded;
+            return result;
+        }
+
+        for (auto edge : nodeList[u]->getAdList(predicate)){
+            weight_type weight = edge->getWeight();
+            if (weight < 0)
+                return shortestPath(from, to, predicate);
+            int v = edge->to->id_;
+            distance_type candidate = dist[u] + static_cast<distance_type>(weight);
+            if (candidate >= dist[v])
+                continue;
+            dist[v] = candidate;
+            via[v] = edge;
+            if (h[v] < 0){
+                const Point *point = goal != nullptr ? position(edge->to->vertex) : nullptr;
+                h[v] = point != nullptr ? heuristicScale * point->distanceTo(target) : 0;
+            }
+            open.push(v, static_cast<double>(candidate) + h[v]); // mở lại v nếu đã lấy ra trước đó
+        }
+    }
+    return result;
+}
+
+template <class T, class P, class W>
+bool DGraphModel<T, P, W>::spurPath(SpurSearch &search, int source, int target, distance_type base,
+                                    distance_type bound, const vector<distance_type> &h, const vector<char> &blocked, const vector<int> &skip,
+                                    int predicate, vector<int> &path, vector<distance_type> &costs){
+    // h chính xác nên w(u, v) + h(v) - h(u) >= 0 trên mọi cạnh: A* không cần mở lại đỉnh đã đóng
+    vector<distance_type> &g = search.g;
+    vector<int> &parent = search.parent;
+    bool found = false;
+    g[source] = base;
+    search.touched.push_back(source);
+    search.open.push(source, base + h[source]);
+    while (!search.open.empty()){
+        int u = search.open.pop();
+        search.closed[u] = 1;
+        search.expanded++;
+        if (u == target){
+            path.clear();
+            costs.clear();
+            for (int v = target; v >= 0; v = parent[v]){
+                path.push_back(v);
+                costs.push_back(g[v]);
+            }
+            std::reverse(path.begin(), path.end());
+            std::reverse(costs.begin(), costs.end());
+            found = true;
+            break;
+        }
+        for (auto edge : nodeList[u]->getAdList(predicate)){
+            int v = edge->to->id_;
+            if (search.closed[v] || blocked[v] || h[v] == unreachable())
+                continue;
+            if (u == source && std::find(skip.begin(), skip.end(), v) != skip.end())
+                continue;
+            distance_type candidate = g[u] + static_cast<distance_type>(edge->getWeight());
+            if (candidate < g[v] && candidate + h[v] <= bound){
+                if (g[v] == unreachable())
+                    search.touched.push_back(v);
+                g[v] = candidate;
+                parent[v] = u;
+                search.open.push(v, candidate + h[v]);
+            }
+        }
+    }
+    while (!search.open.empty())
+        search.open.pop();
+    for (int v : search.touched){
+        g[v] = unreachable();
+        parent[v] = -1;
+        search.closed[v] = 0;
+    }
+    search.touched.clear();
+    return found;
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::kShortestPaths(const T &from, const T &to, int k,
+                                          const std::function<bool(const PathResult<T, distance_type> &)> &emit,
+                                          int predicate){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (fromNode == nullptr || toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    if (k == 0)
+        return;
+    vector<distance_type> h = distanceTable(to, predicate, true); // ném NegativeCycleException nếu có
+    int source = fromNode->id_, target = toNode->id_;
+    if (h[source] == unreachable())
+        return;
+
+    // một đường: các đỉnh + chi phí cộng dồn tại từng đỉnh
+    typedef pair<vector<int>, vector<distance_type> > Path;
+    vector<Path> accepted;
+    std::set<vector<int> > known; // mọi đường đã chấp nhận hoặc đang là ứng viên
+    // ứng viên theo (chi phí, dãy đỉnh): thứ tự xác định khi hòa
+    std::set<pair<distance_type, Path> > queue;
+    vector<char> blocked(nodeList.size(), 0);
+    SpurSearch search(nodeList.size());
+
+    Path first;
+    spurPath(search, source, target, 0, unreachable(), h, blocked, vector<int>(), predicate, first.first, first.second);
+    known.insert(first.first);
+    queue.insert(make_pair(first.second.back(), first));
+
+    while (!queue.empty() && (k < 0 || static_cast<int>(accepted.size()) < k)){
+        Path best = queue.begin()->second;
+        queue.erase(queue.begin());
+        accepted.push_back(best);
+
+        PathResult<T, distance_type> result;
+        result.found = true;
+        result.distance = best.second.back();
+        for (int v : best.first){
+            result.path.push_back(nodeList[v]->vertex);
+        }
+        result.expanded = search.expanded;
+        if (!emit(result) || (k >= 0 && static_cast<int>(accepted.size()) >= k))
+            return;
+
+        // nhánh rẽ tại từng đỉnh của đường vừa nhận: gốc chung giữ nguyên, cấm các cạnh tiếp theo
+        // mà các đường đã nhận có cùng gốc đã đi, và cấm các đỉnh của gốc (trừ đỉnh rẽ)
+        const vector<int> &previous = accepted.back().first;
+        for (size_t i = 0; i + 1 < previous.size(); i++){
+            // đã có đủ ứng viên cho các đường còn thiếu: nhánh rẽ đắt hơn ứng viên cuối cùng cần tới là vô ích
+            distance_type bound = unreachable();
+            size_t missing = k < 0 ? 0 : k - accepted.size();
+            if (missing > 0 && queue.size() >= missing){
+                typename std::set<pair<distance_type, Path> >::iterator last = queue.begin();
+                std::advance(last, missing - 1);
+                bound = last->first;
+            }
+            int spur = previous[i];
+            vector<int> skip;
+            for (const Path &path : accepted){
+                if (path.first.size() > i + 1 && std::equal(previous.begin(), previous.begin() + i + 1, path.first.begin()))
+                    skip.push_back(path.first[i + 1]);
+            }
+            for (size_t j = 0; j < i; j++)
+                blocked[previous[j]] = 1;
+            Path spurred;
+            bool found = spurPath(search, spur, target, accepted.back().second[i], bound, h, blocked, skip, predicate,
+                                  spurred.first, spurred.second);
+            for (size_t j = 0; j < i; j++)
+                blocked[previous[j]] = 0;
+            if (!found)
+                continue;
+            Path candidate(vector<int>(previous.begin(), previous.begin() + i),
+                           vector<distance_type>(accepted.back().second.begin(), accepted.back().second.begin() + i));
+            candidate.first.insert(candidate.first.end(), spurred.first.begin(), spurred.first.end());
+            candidate.second.insert(candidate.second.end(), spurred.second.begin(), spurred.second.end());
+            if (known.insert(candidate.first).second)
+                queue.insert(make_pair(candidate.second.back(), candidate));
+        }
+    }
+}
+
+template <class T, class P, class W>
+void DGraphModel<T, P, W>::simplePaths(const T &from, const T &to, int maxHops,
+                                       const std::function<bool(const PathResult<T, distance_type> &)> &emit,
+                                       int predicate){
+    VertexNode<T, P, W> *fromNode = getVertexNode(from);
+    VertexNode<T, P, W> *toNode = getVertexNode(to);
+    if (fromNode == nullptr || toNode == nullptr){
+        throw VertexNotFoundException();
+    }
+    if (maxHops < 0)
+        return;
+    size_t n = nodeList.size();
+    // hopsTo[v]: số cạnh ít nhất từ v tới to (BFS ngược, chỉ tới độ sâu maxHops; -1 = quá xa / không tới được)
+    vector<int> hopsTo(n, -1);
+    vector<int> frontier(1, toNode->id_), next;
+    hopsTo[toNode->id_] = 0;
+    for (int level = 1; level <= maxHops && !frontier.empty(); level++){
+        next.clear();
+        for (int v : frontier){
+            for (auto edge : nodeList[v]->getInList(predicate)){
+                int u = edge->from->id_;
+                if (hopsTo[u] < 0){
+                    hopsTo[u] = level;
+                    next.push_back(u);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+    if (hopsTo[fromNode->id_] < 0)
+        return;
+
+    // DFS tường minh; khung của mỗi độ sâu giữ các bước đi tiếp hợp lệ (đã gộp cạnh song song, đã cắt theo hopsTo)
+    struct Step
+    {
+        int vertex;
+        distance_type weight;
+    };
+    vector<vector<Step> > steps(maxHops + 1);
+    vector<size_t> cursor(maxHops + 1, 0);
+    vector<int> path(1, fromNode->id_);
+    vector<distance_type> costs(1, 0);
+    vector<char> onPath(n, 0);
+    vector<int> slot(n, -1), owner(n, -1); // slot[v] của khung owner[v] (khử cạnh song song)
+    int frames = 0, expanded = 0;
+    onPath[fromNode->id_] = 1;
+
+    auto open = [&](int depth){
+        int u = path.back();
+        steps[depth].clear();
+        cursor[depth] = 0;
+        expanded++;
+        if (u == toNode->id_)
+            return; // đường đơn không đi tiếp qua to
+        int stamp = frames++;
+        for (auto edge : nodeList[u]->getAdList(predicate)){
+            int v = edge->to->id_;
+            if (onPath[v] || hopsTo[v] < 0 || depth + 1 + hopsTo[v] > maxHops)
+                continue;
+            distance_type weight = static_cast<distance_type>(edge->getWeight());
+            if (owner[v] == stamp){
+                Step &step = steps[depth][slot[v]];
+                step.weight = std::min(step.weight, weight);
+                continue;
+            }
+            owner[v] = stamp;
+            slot[v] = steps[depth].size();
+            steps[depth].push_back(Step{v, weight});
+        }
+    };
+    auto report = [&](){
+        PathResult<T, distance_type> result;
+        result.found = true;
+        result.distance = costs.back();
+        for (int v : path){
+            result.path.push_back(nodeList[v]->vertex);
+        }
+        result.expanded = expanded;
+        return emit(result);
+    };
+
+    if (fromNode == toNode){
+        report();
+        return;
+    }
+    open(0);
+    int depth = 0;
+    while (depth >= 0){
+        if (cursor[depth] == steps[depth].size()){
+            onPath[path.back()] = 0;
+            path.pop_back();
+            costs.pop_back();
+            depth--;
+            continue;
+        }
+        Step step = steps[depth][cursor[depth]++];
+        path.push_back(step.vertex);
+        costs.push_back(costs.back() + step.weight);
+        onPath[step.vertex] = 1;
+        depth++;
+        if (step.vertex == toNode->id_ && !report())
+            return;
+        open(depth);
+    }
+}
+
+// =====================================
+// Struct TriplePattern
+// =====================================
+// Một mẫu (subject, predicate, object) của truy vấn mẫu đồ thị cơ bản: subject / object là tên thực thể
+// hoặc biến "?tên"; predicate là tên vị từ hoặc "*" (mọi quan hệ, kể cả quan hệ không nhãn).
+struct TriplePattern
+{
+    string subject;
+    string predicate;
+    string object;
+
+    TriplePattern(const string &subject, const string &predicate, const string &object)
+        : subject(subject), predicate(predicate), object(object) {}
+
+    static bool isVariable(const string &term) { return term.size() > 1 && term[0] == '?'; }
+};
+
+// =====================================
+// Class KnowledgeGraph
+// =====================================
+class KnowledgeGraph
+{
+#ifdef TESTING
+    friend class TestHelper;
+#endif
+private:
+    typedef NativeVertexPolicy<string> EntityPolicy;
+    typedef DGraphModel<string, EntityPolicy> EntityGraph;
+    typedef VertexNode<string, EntityPolicy> EntityNode;
+    typedef Edge<string, EntityPolicy> EntityEdge;
+
+    EntityGraph graph; // lưu tất cả các thực thể và mối quan hệ trong đồ thị tri thức
+    PredicateTable predicates; // tên vị từ của các quan hệ có nhãn (bộ ba chủ thể - vị từ - đối tượng)
+    LandmarkTable<double> landmarks; // bảng ALT cho findPath(), rỗng nếu chưa tính / đã cũ
+    SpatialIndex positions; // tọa độ thực thể theo id đỉnh
+    NeighborIndex neighborIndex; // láng giềng đã sắp cho các truy vấn tương đồng, dựng lại khi cần
+    std::atomic<bool> neighborsBuilt; // neighborIndex khớp đồ thị hiện tại (các thao tác ghi đặt lại false)
+    std::mutex neighborMutex;         // chỉ một truy vấn đọc dựng lại neighborIndex
+    vector<string> entities; // lưu danh sách tất cả các thực thể trong đồ thị tri thức \
+    (đồng bộ vs graph để dễ truy xuất)
+
+    // Thống kê cho việc chọn thứ tự nối của query(): số cạnh, số đỉnh nguồn / đích khác nhau theo từng vị từ
+    // (predicateStats[id]) và trên mọi quan hệ (anyStats); cập nhật mỗi khi thêm cạnh
+    struct PredicateStats
+    {
+        size_t edges;
+        size_t subjects;
+        size_t objects;
+
+        PredicateStats() : edges(0), subjects(0), objects(0) {}
+    };
+    vector<PredicateStats> predicateStats;
+    PredicateStats anyStats;
+    struct QueryPlan; // truy vấn mẫu đã biên dịch (KnowledgeGraph.cpp)
+
+    // trả về đỉnh của thực thể, ném EntityNotFoundException nếu không tồn tại
+    EntityNode *requireEntity(const string &entity);
+    // mọi cạnh thêm vào đồ thị đi qua đây để giữ predicateStats
+    void connectEntities(EntityNode *fromNode, EntityNode *toNode, float weight, int predicate);
+    void compile(const vector<TriplePattern> &patterns, QueryPlan &plan);
+    bool extend(QueryPlan &plan, size_t depth, const std::function<bool(const vector<string> &)> &emit);
+    const NeighborIndex &neighborSets();
+    bool reachable(EntityNode *fromNode, EntityNode *toNode, int predicate);
+    // region (nếu có): chỉ giữ các thực thể có region[id] = true, việc duyệt vẫn đi qua mọi thực thể
+    vector<string> related(EntityNode *startNode, int depth, int predicate, bool reverse, const vector<bool> *region = nullptr);
+
+public:
+    KnowledgeGraph();
+
+    void addEntity(const string &entity);
+    void addRelation(const string &from, const string &to, float weight = 1.0f);
+    // quan hệ có nhãn (subject, predicate, object); nhiều vị từ giữa cùng một cặp thực thể không ghi đè nhau
+    void addTriple(const string &subject, const string &predicate, const string &object, float weight = 1.0f);
+
+    const vector<string> &getAllEntities();
+    vector<string> getNeighbors(const string &entity);
+    vector<string> getNeighbors(const string &entity, const string &predicate);
+
+    // Các phiên bản có tham số predicate chỉ đi theo các cạnh mang vị từ đó
+    string bfs(const string &start);
+    string bfs(const string &start, const string &predicate);
+    string dfs(const string &start);
+    string dfs(const string &start, const string &predicate);
+
+    bool isReachable(const string &from, const string &to);
+    bool isReachable(const string &from, const string &to, const string &predicate);
     string toString();
 
-    vector<string> getRelatedEntities(string entity, int depth = 2);
-    string findCommonAncestors(string entity1, string entity2);
+    MemoryUsage memoryUsage();
+    void compact();
+    // sắp lại bộ nhớ đồ thị cho các phép duyệt (xem DGraphModel::reorder); kết quả truy vấn giữ nguyên,
+    // trừ thứ tự giữa các kết quả hòa vốn theo id đỉnh; bảng landmark đã tính bị xóa
+    void reorder(ReorderStrategy strategy = REORDER_RCM);
+
+    vector<string> getRelatedEntities(const string &entity, int depth = 2);
+    vector<string> getRelatedEntities(const string &entity, int depth, const string &predicate);
+    // chỉ giữ các thực thể liên quan có tọa độ nằm trong hình cầu tâm center, bán kính radius
+    vector<string> getRelatedEntities(const string &entity, int depth, const Point &center, double radius);
+    // Nhiều thực thể cùng lúc (MS-BFS, chung một lần duyệt cho tối đa 256 thực thể): mỗi danh sách sắp
+    // theo số bước rồi theo id đỉnh (= thứ tự thêm nếu chưa reorder(); trong cùng một mức có thể khác bản một thực thể)
+    vector<vector<string> > getRelatedEntities(const vector<string> &seeds, int depth = 2);
+    // số bước ngắn nhất từ mỗi seed tới các thực thể tới được (maxDepth < 0: không giới hạn)
+    vector<vector<pair<string, int> > > hopDistances(const vector<string> &seeds, int maxDepth = -1);
+
+    // Tọa độ thực thể (địa điểm, tài sản...) và truy vấn không gian qua cây k-d.
+    // Kết quả sắp theo khoảng cách tăng dần, hòa thì theo id đỉnh (= thứ tự thêm nếu chưa reorder()).
+    void setPosition(const string &entity, const Point &position);
+    bool hasPosition(const string &entity);
+    Point getPosition(const string &entity); // ném PositionNotFoundException nếu chưa đặt tọa độ
+    vector<string> nearestEntities(const Point &center, int k);
+    vector<string> entitiesWithinRadius(const Point &center, double radius);
+    // A* theo trọng số quan hệ, heuristic là khoảng cách tới tọa độ của to (thực thể không có tọa độ: h = 0)
+    PathResult<string, double> astarPath(const string &from, const string &to, double heuristicScale = 1.0);
+
+    // Dự đoán liên kết: láng giềng bỏ qua chiều quan hệ; giao tập bằng kernel SIMD trên mảng id đã sắp
+    vector<string> commonNeighbors(const string &entity1, const string &entity2); // theo id đỉnh
+    double similarity(const string &entity1, const string &entity2, SimilarityMetric metric = JACCARD);
+    long long triangleCount(const string &entity);
+    long long triangleCount(int threads = 1); // tổng số tam giác
+    // k thực thể giống nhất với mỗi thực thể trong batch (chỉ xét thực thể cách 2 bước)
+    vector<vector<pair<string, double> > > mostSimilar(const vector<string> &batch, int k, SimilarityMetric metric = JACCARD,
+                                                       int threads = 1);
+
+    // Mức độ quan trọng (PageRank) của mọi thực thể, theo thứ tự getAllEntities()
+    vector<double> pageRank(const PageRankOptions &options = PageRankOptions());
+    // k thực thể quan trọng nhất; bản có seeds là personalized PageRank quanh các thực thể đó
+    vector<pair<string, double> > topEntities(int k, const PageRankOptions &options = PageRankOptions());
+    vector<pair<string, double> > topEntities(int k, const vector<string> &seeds, const PageRankOptions &options = PageRankOptions());
+
+    // Thứ tự tô-pô / tìm chu trình (chu trình dạng [A, B, ..., A], rỗng nếu không có)
+    vector<string> topologicalSort(); // ném CycleException nếu có chu trình
+    vector<string> topologicalSort(const string &predicate);
+    vector<string> findCycle();
+    vector<string> findCycle(const string &predicate);
+    // Từ chối (CycleException) addRelation / addTriple khép kín một chu trình: trên mọi quan hệ,
+    // hoặc chỉ trên các bộ ba mang predicate (ví dụ "isA")
+    void enforceAcyclic(bool enabled = true);
+    void enforceAcyclicOn(const string &predicate);
+
+    // Thành phần liên thông mạnh (kiểm tra chu trình trong ontology...), theo thứ tô-pô của đồ thị rút gọn
+    vector<vector<string> > stronglyConnectedComponents();
+    vector<vector<string> > stronglyConnectedComponents(const string &predicate);
+
+    // Đường đi ngắn nhất theo trọng số (hỗ trợ trọng số âm, ném NegativeCycleException nếu có chu trình âm)
+    PathResult<string, double> shortestPath(const string &from, const string &to);
+    vector<pair<string, double> > shortestDistances(const string &from);
+    // Vùng lân cận theo chi phí: các thực thể có đường đi ngắn nhất từ entity với tổng trọng số <= budget,
+    // kèm chi phí, gần nhất trước (xem DGraphModel::withinDistance). maxEdgeWeight: bỏ qua các quan hệ nặng
+    // hơn; limit > 0: chỉ lấy limit thực thể gần nhất
+    vector<pair<string, double> > entitiesWithinCost(const string &entity, double budget,
+                                                     double maxEdgeWeight = std::numeric_limits<double>::infinity(),
+                                                     size_t limit = 0);
+
+    // Truy vấn điểm - điểm "A liên quan tới B thế nào": ALT nếu bảng landmark còn khớp đồ thị,
+    // không thì Dijkstra hai chiều. Bảng bị xóa khi thêm thực thể / quan hệ.
+    PathResult<string, double> findPath(const string &from, const string &to);
+    // Giải thích "A liên quan tới B thế nào" bằng nhiều đường đi đơn (xem DGraphModel::kShortestPaths /
+    // simplePaths): kết quả được tính dần và đưa cho emit (trả false để dừng), hoặc gom vào vector
+    void kShortestPaths(const string &from, const string &to, int k,
+                        const std::function<bool(const PathResult<string, double> &)> &emit);
+    vector<PathResult<string, double> > kShortestPaths(const string &from, const string &to, int k);
+    void simplePaths(const string &from, const string &to, int maxHops,
+                     const std::function<bool(const PathResult<string, double> &)> &emit);
+    vector<PathResult<string, double> > simplePaths(const string &from, const string &to, int maxHops, size_t limit = 0);
+    void buildLandmarks(int count = 8);
+    bool hasLandmarks();
+    void saveLandmarks(ostream &out);
+    bool loadLandmarks(istream &in); // false nếu dữ liệu hỏng hoặc không khớp đồ thị hiện tại
+    // Ảnh chụp nhị phân của thực thể, quan hệ (kèm vị từ, trọng số) và tọa độ. Các quan hệ được ghi theo một
+    // thứ tự tạo khớp với danh sách kề của mọi thực thể nên đồ thị nạp lại duyệt giống hệt bản gốc.
+    // loadSnapshot() chỉ dùng cho đồ thị rỗng; ném StorageException nếu dữ liệu hỏng.
+    void saveSnapshot(ostream &out);
+    void loadSnapshot(istream &in);
+
+    // Truy vấn mẫu đồ thị cơ bản (các mẫu nối với nhau qua biến chung), ví dụ
+    // {("?x", "partOf", "?y"), ("?y", "locatedIn", "Europe")}. Nối kiểu generic join: gán lần lượt từng biến,
+    // ứng viên lấy từ danh sách kề ngắn nhất trong các mẫu đã có đầu kia được gán, rồi kiểm tra các mẫu còn lại.
+    // Thứ tự biến chọn theo thống kê bậc (bậc thật của hằng, bậc trung bình / số đỉnh khác nhau của vị từ).
+    // Mỗi kết quả được đưa ngay cho emit (giá trị theo thứ tự queryVariables()); emit trả false để dừng.
+    // Ném EntityNotFoundException nếu một thực thể hằng không tồn tại; vị từ chưa từng dùng cho kết quả rỗng.
+    void query(const vector<TriplePattern> &patterns, const std::function<bool(const vector<string> &)> &emit);
+    vector<vector<string> > select(const vector<TriplePattern> &patterns, size_t limit = 0); // 0: không giới hạn
+    vector<string> queryPlan(const vector<TriplePattern> &patterns); // các biến theo thứ tự được gán
+    static vector<string> queryVariables(const vector<TriplePattern> &patterns); // theo thứ tự xuất hiện
+
+    // Truy vấn ngược (dựa trên danh sách cạnh đi vào, O(bậc vào) mỗi bước)
+    vector<string> getPredecessors(const string &entity);
+    vector<string> getPredecessors(const string &entity, const string &predicate);
+    string reverseBfs(const string &start);
+    string reverseDfs(const string &start);
+    vector<string> getAncestors(const string &entity, int depth = 2);
+    vector<string> getAncestors(const string &entity, int depth, const string &predicate);
+    // Thực thể có đường tới entity1 / entity2 vòng qua một chu trình âm (khoảng cách không xác định) bị bỏ qua
+    string findCommonAncestors(const string &entity1, const string &entity2);
 
     static bool stringEQ(string &lhs, string &rhs);
 };
@@ -0,0 +1,620 @@
+#include "MappedGraph.h"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+typedef unsigned long long Offset;
+
+const char *const SEGMENTS[] = {"entities", "index", "edges", "adjacency"};
+
+template <class V>
+void put(ofstream &out, const V &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(V));
+}
+
+// fsync một tệp (hoặc thư mục, để các lần đổi tên trong nó bền vững)
+void syncPath(const string &file) {
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw StorageException("Cannot open " + file + ": " + strerror(errno));
+    }
+    int result = fsync(fd);
+    int error = errno;
+    ::close(fd);
+    if (result != 0) {
+        throw StorageException("Cannot sync " + file + ": " + strerror(error));
+    }
+}
+
+// đóng tệp vừa ghi và fsync nó: chỉ tệp đã nằm trên đĩa mới được manifest trỏ tới
+void finishWrite(ofstream &out, const string &file) {
+    out.close();
+    if (!out) {
+        throw StorageException("Cannot write " + file);
+    }
+    syncPath(file);
+}
+
+} // namespace
+
+// =============================================================================
+// MappedFile
+// =============================================================================
+MappedFile::MappedFile() : fd(-1), data_(nullptr), size_(0) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::open(const string &path, bool writable) {
+    close();
+    fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        throw StorageException("Cannot open " + path + ": " + strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close();
+        throw StorageException("Cannot stat " + path);
+    }
+    size_ = info.st_size;
+    if (size_ == 0) {
+        return;
+    }
+    void *mapped = mmap(nullptr, size_, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close();
+        throw StorageException("Cannot map " + path + ": " + strerror(errno));
+    }
+    data_ = static_cast<char *>(mapped);
+}
+
+void MappedFile::swap(MappedFile &other) {
+    std::swap(fd, other.fd);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+}
+
+void MappedFile::sync() {
+    if (data_ != nullptr && msync(data_, size_, MS_SYNC) != 0) {
+        throw StorageException(string("Cannot sync mapped file: ") + strerror(errno));
+    }
+}
+
+void MappedFile::close() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+        data_ = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    size_ = 0;
+}
+
+// =============================================================================
+// MappedKnowledgeGraph
+// =============================================================================
+const unsigned long long MappedKnowledgeGraph::INDEX_FORMAT;
+const unsigned long long MappedKnowledgeGraph::MANIFEST_FORMAT;
+
+MappedKnowledgeGraph::MappedKnowledgeGraph(const string &directory, size_t bufferLimit)
+    : directory(directory), bufferLimit(std::max<size_t>(bufferLimit, 1)), generation_(0), diskVertices(0), diskEdges(0),
+      indexCapacity(0) {
+    static_assert(sizeof(EdgeRecord) == 12, "EdgeRecord must be packed");
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw StorageException("Cannot create " + directory + ": " + strerror(errno));
+    }
+    ifstream manifest(path("manifest").c_str(), ios::binary);
+    if (!manifest) {
+        createEmpty();
+    } else {
+        unsigned long long format = 0;
+        manifest.read(reinterpret_cast<char *>(&format), sizeof(format));
+        manifest.read(reinterpret_cast<char *>(&generation_), sizeof(generation_));
+        if (!manifest || format != MANIFEST_FORMAT) {
+            throw StorageException("Corrupt manifest in " + directory);
+        }
+    }
+    mapFiles();
+    // dọn thế hệ cũ còn sót (sập ngay sau khi đổi manifest) và thế hệ mới ghi dở (sập trước khi đổi)
+    removeGeneration(generation_ - 1);
+    removeGeneration(generation_ + 1);
+}
+
+MappedKnowledgeGraph::~MappedKnowledgeGraph() {
+    try {
+        flush();
+    } catch (const StorageException &) {
+        // không ném từ destructor; dữ liệu trong bộ đệm bị mất
+    }
+}
+
+void MappedKnowledgeGraph::remove(const string &directory) {
+    DIR *dir = opendir(directory.c_str());
+    if (dir != nullptr) {
+        vector<string> files;
+        while (struct dirent *entry = readdir(dir)) {
+            string file = entry->d_name;
+            bool owned = file == "manifest" || file == "manifest.tmp";
+            for (const char *segment : SEGMENTS) {
+                owned = owned || (file.compare(0, strlen(segment) + 1, string(segment) + ".") == 0 &&
+                                  file.size() > 4 && file.compare(file.size() - 4, 4, ".dat") == 0);
+            }
+            if (owned) {
+                files.push_back(directory + "/" + file);
+            }
+        }
+        closedir(dir);
+        for (const string &file : files) {
+            std::remove(file.c_str());
+        }
+    }
+    rmdir(directory.c_str());
+}
+
+string MappedKnowledgeGraph::segmentPath(const char *segment, unsigned long long generation) const {
+    return path(string(segment) + "." + std::to_string(generation) + ".dat");
+}
+
+void MappedKnowledgeGraph::removeGeneration(unsigned long long generation) {
+    for (const char *segment : SEGMENTS) {
+        std::remove(segmentPath(segment, generation).c_str());
+    }
+}
+
+void MappedKnowledgeGraph::publish(unsigned long long generation) {
+    // đổi tên là nguyên tử: manifest luôn trỏ tới một thế hệ đã ghi đủ và đã fsync. Việc đổi tên chỉ bền
+    // vững sau khi người gọi fsync thư mục
+    ofstream manifest(path("manifest.tmp").c_str(), ios::binary);
+    put(manifest, MANIFEST_FORMAT);
+    put(manifest, generation);
+    finishWrite(manifest, path("manifest.tmp"));
+    if (rename(path("manifest.tmp").c_str(), path("manifest").c_str()) != 0) {
+        throw StorageException("Cannot replace " + path("manifest") + ": " + strerror(errno));
+    }
+}
+
+void MappedKnowledgeGraph::createEmpty() {
+    generation_ = 1;
+    Offset zero = 0;
+    ofstream entities(segmentPath("entities", generation_).c_str(), ios::binary);
+    put(entities, zero);
+    put(entities, zero);
+    finishWrite(entities, segmentPath("entities", generation_));
+    ofstream index(segmentPath("index", generation_).c_str(), ios::binary);
+    put(index, INDEX_FORMAT);
+    put(index, zero);
+    finishWrite(index, segmentPath("index", generation_));
+    ofstream edges(segmentPath("edges", generation_).c_str(), ios::binary);
+    put(edges, zero);
+    finishWrite(edges, segmentPath("edges", generation_));
+    ofstream adjacency(segmentPath("adjacency", generation_).c_str(), ios::binary);
+    put(adjacency, zero);
+    put(adjacency, zero);
+    put(adjacency, zero);
+    finishWrite(adjacency, segmentPath("adjacency", generation_));
+    publish(generation_);
+    syncPath(directory);
+}
+
+void MappedKnowledgeGraph::openGeneration(unsigned long long generation, MappedFile &entities, MappedFile &index,
+                                          MappedFile &edges, MappedFile &adjacency) const {
+    entities.open(segmentPath("entities", generation), false);
+    index.open(segmentPath("index", generation), false);
+    edges.open(segmentPath("edges", generation), true); // trọng số được sửa tại chỗ
+    adjacency.open(segmentPath("adjacency", generation), false);
+    if (entities.size() < 2 * sizeof(Offset) || index.size() < 2 * sizeof(Offset) || edges.size() < sizeof(Offset) ||
+        adjacency.size() < 3 * sizeof(Offset)) {
+        throw StorageException("Corrupt graph files in " + directory);
+    }
+    if (*index.at<Offset>(0) != INDEX_FORMAT) {
+        throw StorageException("Unsupported index format in " + directory);
+    }
+    Offset vertices = *entities.at<Offset>(0), capacity = *index.at<Offset>(sizeof(Offset));
+    if (index.size() != 2 * sizeof(Offset) + capacity * sizeof(unsigned int)) {
+        throw StorageException("Corrupt graph files in " + directory);
+    }
+    Offset count = *edges.at<Offset>(0);
+    if (*adjacency.at<Offset>(0) != vertices || edges.size() != sizeof(Offset) + count * sizeof(EdgeRecord)) {
+        throw StorageException("Corrupt graph files in " + directory);
+    }
+}
+
+void MappedKnowledgeGraph::mapFiles() {
+    openGeneration(generation_, entityFile, indexFile, edgeFile, adjacencyFile);
+    readHeaders();
+}
+
+void MappedKnowledgeGraph::readHeaders() {
+    diskVertices = *entityFile.at<Offset>(0);
+    indexCapacity = *indexFile.at<Offset>(sizeof(Offset));
+    diskEdges = *edgeFile.at<Offset>(0);
+}
+
+int MappedKnowledgeGraph::find(const string &entity) const {
+    if (indexCapacity > 0) {
+        const unsigned int *slots = indexFile.at<unsigned int>(2 * sizeof(Offset));
+        const Offset *offsets = entityFile.at<Offset>(sizeof(Offset));
+        const char *names = entityFile.at<char>((diskVertices + 2) * sizeof(Offset));
+        for (Offset h = fnv1a(entity) & (indexCapacity - 1); slots[h] != 0; h = (h + 1) & (indexCapacity - 1)) {
+            int id = slots[h] - 1;
+            Offset length = offsets[id + 1] - offsets[id];
+            if (length == entity.size() && memcmp(names + offsets[id], entity.data(), length) == 0) {
+                return id;
+            }
+        }
+    }
+    auto it = newIndex.find(entity);
+    return it == newIndex.end() ? -1 : it->second;
+}
+
+int MappedKnowledgeGraph::require(const string &entity) const {
+    int id = find(entity);
+    if (id < 0) {
+        throw EntityNotFoundException();
+    }
+    return id;
+}
+
+string MappedKnowledgeGraph::name(int id) const {
+    if (static_cast<Offset>(id) >= diskVertices) {
+        return newNames[id - diskVertices];
+    }
+    const Offset *offsets = entityFile.at<Offset>(sizeof(Offset));
+    return string(entityFile.at<char>((diskVertices + 2) * sizeof(Offset) + offsets[id]), offsets[id + 1] - offsets[id]);
+}
+
+MappedKnowledgeGraph::EdgeRecord &MappedKnowledgeGraph::edge(unsigned int id) {
+    if (id >= diskEdges) {
+        return newEdges[id - diskEdges];
+    }
+    return *edgeFile.at<EdgeRecord>(sizeof(Offset) + id * sizeof(EdgeRecord));
+}
+
+size_t MappedKnowledgeGraph::outCount(int v) const {
+    size_t count = 0;
+    if (static_cast<Offset>(v) < diskVertices) {
+        const Offset *offsets = adjacencyFile.at<Offset>(sizeof(Offset));
+        count = offsets[v + 1] - offsets[v];
+    }
+    auto it = newOut.find(v);
+    return it == newOut.end() ? count : count + it->second.size();
+}
+
+size_t MappedKnowledgeGraph::fullCount(int v) const {
+    size_t count = 0;
+    if (static_cast<Offset>(v) < diskVertices) {
+        const Offset *offsets = adjacencyFile.at<Offset>((diskVertices + 2) * sizeof(Offset));
+        count = offsets[v + 1] - offsets[v];
+    }
+    auto it = newFull.find(v);
+    return it == newFull.end() ? count : count + it->second.size();
+}
+
+unsigned int MappedKnowledgeGraph::outEdge(int v, size_t i) const {
+    if (static_cast<Offset>(v) < diskVertices) {
+        const Offset *offsets = adjacencyFile.at<Offset>(sizeof(Offset));
+        if (i < offsets[v + 1] - offsets[v]) {
+            return *adjacencyFile.at<unsigned int>(2 * (diskVertices + 2) * sizeof(Offset) - sizeof(Offset) +
+                                                   (offsets[v] + i) * sizeof(unsigned int));
+        }
+        i -= offsets[v + 1] - offsets[v];
+    }
+    return newOut.at(v)[i];
+}
+
+unsigned int MappedKnowledgeGraph::fullEdge(int v, size_t i) const {
+    if (static_cast<Offset>(v) < diskVertices) {
+        const Offset *offsets = adjacencyFile.at<Offset>((diskVertices + 2) * sizeof(Offset));
+        if (i < offsets[v + 1] - offsets[v]) {
+            // id cạnh kề nằm sau toàn bộ diskEdges id cạnh đi ra
+            return *adjacencyFile.at<unsigned int>(2 * (diskVertices + 2) * sizeof(Offset) - sizeof(Offset) +
+                                                   (diskEdges + offsets[v] + i) * sizeof(unsigned int));
+        }
+        i -= offsets[v + 1] - offsets[v];
+    }
+    return newFull.at(v)[i];
+}
+
+void MappedKnowledgeGraph::addEntity(const string &entity) {
+    if (contains(entity)) {
+        throw EntityExistsException();
+    }
+    newIndex[entity] = size();
+    newNames.push_back(entity);
+    if (buffered() >= bufferLimit) {
+        merge();
+    }
+}
+
+void MappedKnowledgeGraph::addRelation(const string &from, const string &to, float weight) {
+    int u = require(from);
+    int v = require(to);
+    // quan hệ đã có: chỉ cập nhật trọng số (trên đĩa thì ghi thẳng vào trang ánh xạ)
+    for (size_t i = 0; i < outCount(u); i++) {
+        EdgeRecord &record = edge(outEdge(u, i));
+        if (record.to == v) {
+            record.weight = weight;
+            return;
+        }
+    }
+    EdgeRecord record;
+    record.from = u;
+    record.to = v;
+    record.weight = weight;
+    unsigned int id = relationCount();
+    newEdges.push_back(record);
+    newOut[u].push_back(id);
+    newFull[u].push_back(id);
+    newFull[v].push_back(id); // cạnh tự vòng xuất hiện hai lần, như adListFull
+    if (buffered() >= bufferLimit) {
+        merge();
+    }
+}
+
+void MappedKnowledgeGraph::flush() {
+    if (buffered() > 0) {
+        merge(); // thế hệ mới chép cả các trọng số đã sửa tại chỗ
+    } else {
+        edgeFile.sync();
+    }
+}
+
+void MappedKnowledgeGraph::merge() {
+    // ghi và ánh xạ thế hệ mới (phần trên đĩa + bộ đệm) trong khi thế hệ cũ vẫn được ánh xạ, rồi đổi manifest.
+    // Lỗi trước khi đổi: xóa các tệp ghi dở, đối tượng vẫn đọc thế hệ cũ và giữ bộ đệm. Sau khi đổi chỉ còn
+    // các bước không lỗi (tráo ánh xạ, xóa bộ đệm), trừ fsync thư mục
+    Offset next = generation_ + 1;
+    MappedFile entities, index, edges, adjacency;
+    try {
+        writeGeneration(next);
+        openGeneration(next, entities, index, edges, adjacency);
+        publish(next);
+    } catch (...) {
+        entities.close();
+        index.close();
+        edges.close();
+        adjacency.close();
+        removeGeneration(next);
+        std::remove(path("manifest.tmp").c_str());
+        throw;
+    }
+
+    Offset previous = generation_;
+    entityFile.swap(entities);
+    indexFile.swap(index);
+    edgeFile.swap(edges);
+    adjacencyFile.swap(adjacency);
+    generation_ = next;
+    readHeaders();
+    newNames.clear();
+    newIndex.clear();
+    newEdges.clear();
+    newOut.clear();
+    newFull.clear();
+    syncPath(directory); // manifest mới phải bền vững trước khi xóa thế hệ mà manifest cũ trỏ tới
+    removeGeneration(previous);
+}
+
+void MappedKnowledgeGraph::writeGeneration(unsigned long long generation) {
+    Offset n = size(), m = relationCount();
+
+    ofstream entities(segmentPath("entities", generation).c_str(), ios::binary);
+    put(entities, n);
+    Offset offset = 0;
+    put(entities, offset);
+    for (Offset v = 0; v < n; v++) {
+        offset += v < diskVertices ? entityFile.at<Offset>(sizeof(Offset))[v + 1] - entityFile.at<Offset>(sizeof(Offset))[v]
+                                   : newNames[v - diskVertices].size();
+        put(entities, offset);
+    }
+    for (Offset v = 0; v < n; v++) {
+        string entity = name(v);
+        entities.write(entity.data(), entity.size());
+    }
+    finishWrite(entities, segmentPath("entities", generation));
+
+    Offset capacity = 16;
+    while (capacity < 2 * n) {
+        capacity *= 2;
+    }
+    vector<unsigned int> slots(capacity, 0);
+    for (Offset v = 0; v < n; v++) {
+        Offset h = fnv1a(name(v)) & (capacity - 1);
+        while (slots[h] != 0) {
+            h = (h + 1) & (capacity - 1);
+        }
+        slots[h] = v + 1;
+    }
+    ofstream index(segmentPath("index", generation).c_str(), ios::binary);
+    put(index, INDEX_FORMAT);
+    put(index, capacity);
+    index.write(reinterpret_cast<const char *>(slots.data()), capacity * sizeof(unsigned int));
+    finishWrite(index, segmentPath("index", generation));
+    vector<unsigned int>().swap(slots);
+
+    ofstream edges(segmentPath("edges", generation).c_str(), ios::binary);
+    put(edges, m);
+    if (diskEdges > 0) {
+        edges.write(edgeFile.at<char>(sizeof(Offset)), diskEdges * sizeof(EdgeRecord));
+    }
+    edges.write(reinterpret_cast<const char *>(newEdges.data()), newEdges.size() * sizeof(EdgeRecord));
+    finishWrite(edges, segmentPath("edges", generation));
+
+    ofstream adjacency(segmentPath("adjacency", generation).c_str(), ios::binary);
+    put(adjacency, n);
+    offset = 0;
+    put(adjacency, offset);
+    for (Offset v = 0; v < n; v++) {
+        offset += outCount(v);
+        put(adjacency, offset);
+    }
+    offset = 0;
+    put(adjacency, offset);
+    for (Offset v = 0; v < n; v++) {
+        offset += fullCount(v);
+        put(adjacency, offset);
+    }
+    for (Offset v = 0; v < n; v++) {
+        for (size_t i = 0, count = outCount(v); i < count; i++) {
+            put(adjacency, outEdge(v, i));
+        }
+    }
+    for (Offset v = 0; v < n; v++) {
+        for (size_t i = 0, count = fullCount(v); i < count; i++) {
+            put(adjacency, fullEdge(v, i));
+        }
+    }
+    finishWrite(adjacency, segmentPath("adjacency", generation));
+}
+
+vector<string> MappedKnowledgeGraph::getAllEntities() const {
+    vector<string> result;
+    result.reserve(size());
+    for (int v = 0; v < size(); v++) {
+        result.push_back(name(v));
+    }
+    return result;
+}
+
+string MappedKnowledgeGraph::edgeString(unsigned int id) {
+    // cùng định dạng với Edge::toString()
+    const EdgeRecord &record = edge(id);
+    stringstream ss;
+    ss << "(" << name(record.from) << ", " << name(record.to) << ", ";
+    ss.precision(6);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    ss << record.weight << ")";
+    return ss.str();
+}
+
+string MappedKnowledgeGraph::nodeString(int v) {
+    // cùng định dạng với VertexNode::toString(): (tên, bậc vào, bậc ra, [các cạnh kề])
+    size_t out = outCount(v), full = fullCount(v);
+    stringstream ss;
+    ss << "(" << name(v) << ", " << full - out << ", " << out << ", [";
+    for (size_t i = 0; i < full; i++) {
+        if (i > 0) ss << ", ";
+        ss << edgeString(fullEdge(v, i));
+    }
+    ss << "])";
+    return ss.str();
+}
+
+vector<string> MappedKnowledgeGraph::getNeighbors(const string &entity) {
+    int v = require(entity);
+    vector<string> neighbors;
+    for (size_t i = 0, count = outCount(v); i < count; i++) {
+        neighbors.push_back(name(edge(outEdge(v, i)).to));
+    }
+    return neighbors;
+}
+
+string MappedKnowledgeGraph::bfs(const string &start) {
+    int source = require(start);
+    vector<bool> visited(size(), false);
+    std::queue<int> queue;
+    queue.push(source);
+    visited[source] = true;
+    stringstream ss;
+    ss << "[";
+    for (bool first = true; !queue.empty(); first = false) {
+        int current = queue.front();
+        queue.pop();
+        if (!first) ss << ", ";
+        ss << nodeString(current);
+        for (size_t i = 0, count = outCount(current); i < count; i++) {
+            int neighbor = edge(outEdge(current, i)).to;
+            if (!visited[neighbor]) {
+                visited[neighbor] = true;
+                queue.push(neighbor);
+            }
+        }
+    }
+    ss << "]";
+    return ss.str();
+}
+
+string MappedKnowledgeGraph::dfs(const string &start) {
+    // stack tường minh, láng giềng được đẩy theo thứ tự ngược (như DGraphModel::DFS)
+    vector<bool> visited(size(), false);
+    vector<int> stack(1, require(start));
+    stringstream ss;
+    ss << "[";
+    bool first = true;
+    while (!stack.empty()) {
+        int current = stack.back();
+        stack.pop_back();
+        if (visited[current]) continue;
+        visited[current] = true;
+        if (!first) ss << ", ";
+        first = false;
+        ss << nodeString(current);
+        for (size_t i = outCount(current); i-- > 0;) {
+            int neighbor = edge(outEdge(current, i)).to;
+            if (!visited[neighbor]) {
+                stack.push_back(neighbor);
+            }
+        }
+    }
+    ss << "]";
+    return ss.str();
+}
+
+bool MappedKnowledgeGraph::isReachable(const string &from, const string &to) {
+    int source = require(from), target = require(to);
+    vector<bool> visited(size(), false);
+    std::queue<int> queue;
+    queue.push(source);
+    visited[source] = true;
+    while (!queue.empty()) {
+        int current = queue.front();
+        queue.pop();
+        if (current == target) {
+            return true;
+        }
+        for (size_t i = 0, count = outCount(current); i < count; i++) {
+            int neighbor = edge(outEdge(current, i)).to;
+            if (!visited[neighbor]) {
+                visited[neighbor] = true;
+                queue.push(neighbor);
+            }
+        }
+    }
+    return false;
+}
+
+vector<string> MappedKnowledgeGraph::getRelatedEntities(const string &entity, int depth) {
+    int source = require(entity);
+    vector<string> result;
+    vector<bool> visited(size(), false);
+    std::queue<pair<int, int> > queue; // (đỉnh, số bước)
+    queue.push(make_pair(source, 0));
+    visited[source] = true;
+    while (!queue.empty()) {
+        pair<int, int> current = queue.front();
+        queue.pop();
+        if (current.second >= depth) {
+            continue;
+        }
+        for (size_t i = 0, count = outCount(current.first); i < count; i++) {
+            int neighbor = edge(outEdge(current.first, i)).to;
+            if (!visited[neighbor]) {
+                visited[neighbor] = true;
+                result.push_back(name(neighbor));
+                queue.push(make_pair(neighbor, current.second + 1));
+            }
+        }
+    }
+    return result;
+}
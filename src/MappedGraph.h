@@ -0,0 +1,132 @@
+#ifndef MAPPEDGRAPH_H
+#define MAPPEDGRAPH_H
+
+#include "main.h"
+
+// =====================================
+// Class MappedFile
+// =====================================
+// Một tệp được ánh xạ toàn bộ vào bộ nhớ (mmap, MAP_SHARED): hệ điều hành nạp trang khi cần và ghi lại
+// các trang bị sửa (sync() ép ghi ngay). Tệp rỗng không được ánh xạ.
+class MappedFile
+{
+private:
+    int fd;
+    char *data_;
+    size_t size_;
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    void open(const string &path, bool writable); // ném StorageException nếu không mở / ánh xạ được
+    void close();
+    void swap(MappedFile &other);
+    void sync(); // msync các trang đã sửa xuống tệp, ném StorageException nếu lỗi
+    bool isOpen() const { return fd >= 0; }
+    size_t size() const { return size_; }
+
+    template <class V>
+    V *at(size_t offset) const { return reinterpret_cast<V *>(data_ + offset); }
+};
+
+// =====================================
+// Class MappedKnowledgeGraph
+// =====================================
+// Đồ thị tri thức (quan hệ không nhãn) lưu ngoài bộ nhớ trong một thư mục, theo từng thế hệ g:
+//   manifest          MANIFEST_FORMAT, g (uint64): thế hệ hiện hành
+//   entities.<g>.dat  n, offset[n + 1] (uint64), tên thực thể nối liền
+//   index.<g>.dat     INDEX_FORMAT, capacity, slot[capacity] (uint32, id + 1, 0 = trống): bảng băm tên -> id
+//                     theo FNV-1a 64 bit (cố định giữa các bản build, khác std::hash), dò tuyến tính
+//   edges.<g>.dat     m, m bản ghi (from, to, weight) theo thứ tự tạo
+//   adjacency.<g>.dat n, outOffset[n + 1], fullOffset[n + 1] (uint64), rồi id cạnh đi ra và id mọi cạnh kề
+//                     (vào + ra, như adListFull) của từng đỉnh theo thứ tự tạo
+// Các tệp được mmap nên chỉ những trang bị duyệt tới mới nằm trong RAM. Thực thể / quan hệ mới vào một bộ
+// đệm trong bộ nhớ; khi bộ đệm vượt bufferLimit (hoặc gọi flush()) nó được trộn thành thế hệ g + 1: mỗi tệp
+// được fsync, rồi manifest.tmp đổi tên đè lên manifest và thư mục được fsync. Sập trước khi đổi tên thì lần
+// mở sau vẫn thấy nguyên thế hệ g; trộn lỗi thì đối tượng giữ nguyên thế hệ g và bộ đệm. Sửa trọng số của
+// một cạnh đã có trên đĩa ghi thẳng vào tệp ánh xạ, flush() msync nó xuống đĩa.
+// bfs / dfs / isReachable / getRelatedEntities / getNeighbors cho cùng kết quả với KnowledgeGraph được
+// dựng bằng cùng chuỗi addEntity / addRelation.
+class MappedKnowledgeGraph
+{
+private:
+    struct EdgeRecord
+    {
+        int from;
+        int to;
+        float weight;
+    };
+
+    string directory;
+    size_t bufferLimit;
+
+    MappedFile entityFile, indexFile, edgeFile, adjacencyFile;
+    unsigned long long generation_; // thế hệ đang ánh xạ
+    unsigned long long diskVertices, diskEdges, indexCapacity;
+
+    // bộ đệm ghi: id tiếp nối sau phần trên đĩa
+    vector<string> newNames;
+    unordered_map<string, int> newIndex;
+    vector<EdgeRecord> newEdges;
+    unordered_map<int, vector<unsigned int> > newOut;  // id cạnh đi ra mới của từng đỉnh
+    unordered_map<int, vector<unsigned int> > newFull; // id cạnh kề mới (vào + ra) của từng đỉnh
+
+    string path(const string &file) const { return directory + "/" + file; }
+    string segmentPath(const char *segment, unsigned long long generation) const;
+    void createEmpty();
+    void publish(unsigned long long generation); // đổi manifest sang thế hệ mới (điểm cam kết của merge)
+    void removeGeneration(unsigned long long generation); // xóa các tệp của một thế hệ, bỏ qua lỗi
+    // mở, ánh xạ và kiểm tra các tệp của một thế hệ; ném StorageException nếu thiếu / hỏng
+    void openGeneration(unsigned long long generation, MappedFile &entities, MappedFile &index, MappedFile &edges,
+                        MappedFile &adjacency) const;
+    void mapFiles();
+    void readHeaders();
+    void writeGeneration(unsigned long long generation); // ghi và fsync các tệp của thế hệ từ dữ liệu hiện tại
+    void merge();
+
+    int find(const string &entity) const; // -1 nếu không có
+    int require(const string &entity) const;
+    string name(int id) const;
+    EdgeRecord &edge(unsigned int id);
+    size_t outCount(int v) const;
+    size_t fullCount(int v) const;
+    unsigned int outEdge(int v, size_t i) const;
+    unsigned int fullEdge(int v, size_t i) const;
+    string edgeString(unsigned int id);
+    string nodeString(int v);
+
+public:
+    static const size_t DEFAULT_BUFFER_LIMIT = 1 << 16;
+    // từ đầu tiên của index.<g>.dat: đổi khi hàm băm hoặc bố cục bảng thay đổi; mở tệp khác phiên bản ném StorageException
+    static const unsigned long long INDEX_FORMAT = 0x314e46584449474bULL; // "KGIDXFN1" (little-endian)
+    static const unsigned long long MANIFEST_FORMAT = 0x31464e414d47474bULL; // "KGGMANF1" (little-endian)
+
+    // mở thư mục (tạo mới nếu chưa có dữ liệu)
+    explicit MappedKnowledgeGraph(const string &directory, size_t bufferLimit = DEFAULT_BUFFER_LIMIT);
+    ~MappedKnowledgeGraph(); // flush() bộ đệm còn lại
+    // xóa manifest và các tệp dữ liệu của mọi thế hệ, rồi xóa thư mục nếu nó đã rỗng
+    static void remove(const string &directory);
+
+    void addEntity(const string &entity);
+    void addRelation(const string &from, const string &to, float weight = 1.0f);
+    void flush();
+
+    bool contains(const string &entity) const { return find(entity) >= 0; }
+    int size() const { return static_cast<int>(diskVertices + newNames.size()); }
+    size_t relationCount() const { return diskEdges + newEdges.size(); }
+    size_t buffered() const { return newNames.size() + newEdges.size(); }
+    unsigned long long generation() const { return generation_; }
+    vector<string> getAllEntities() const;
+
+    vector<string> getNeighbors(const string &entity);
+    string bfs(const string &start);
+    string dfs(const string &start);
+    bool isReachable(const string &from, const string &to);
+    vector<string> getRelatedEntities(const string &entity, int depth = 2);
+};
+
+#endif // MAPPEDGRAPH_H
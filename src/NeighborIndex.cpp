@@ -0,0 +1,255 @@
+#include "NeighborIndex.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NEIGHBORINDEX_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// =============================================================================
+// Intersection kernels
+// =============================================================================
+namespace {
+
+// trộn hai mảng đã sắp (dùng cho phần đuôi của các bản SIMD)
+size_t intersectScalar(const int *a, size_t na, const int *b, size_t nb, int *out) {
+    size_t i = 0, j = 0, count = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (b[j] < a[i]) {
+            j++;
+        } else {
+            if (out != nullptr) out[count] = a[i];
+            count++;
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+#ifdef NEIGHBORINDEX_X86_SIMD
+// So khớp khối 4x4 (SSE) / 8x8 (AVX2): so khối của a với mọi phép xoay của khối b, bit thứ k của mặt nạ
+// cho biết a[i + k] có trong khối b. Mỗi lần tiến khối có phần tử lớn nhất nhỏ hơn (hoặc cả hai nếu bằng).
+__attribute__((target("sse4.1")))
+size_t intersectSSE(const int *a, size_t na, const int *b, size_t nb, int *out) {
+    size_t i = 0, j = 0, count = 0;
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j));
+        __m128i match = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+        if (!_mm_testz_si128(match, match)) {
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(match));
+            if (out != nullptr) {
+                for (int bits = mask; bits != 0; bits &= bits - 1) {
+                    out[count++] = a[i + __builtin_ctz(bits)];
+                }
+            } else {
+                count += __builtin_popcount(mask);
+            }
+        }
+        int amax = a[i + 3], bmax = b[j + 3];
+        if (amax <= bmax) i += 4;
+        if (bmax <= amax) j += 4;
+    }
+    return count + intersectScalar(a + i, na - i, b + j, nb - j, out != nullptr ? out + count : nullptr);
+}
+
+__attribute__((target("avx2")))
+size_t intersectAVX2(const int *a, size_t na, const int *b, size_t nb, int *out) {
+    size_t i = 0, j = 0, count = 0;
+    const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j));
+        __m256i match = _mm256_cmpeq_epi32(va, vb);
+        for (int r = 1; r < 8; r++) {
+            vb = _mm256_permutevar8x32_epi32(vb, rotate);
+            match = _mm256_or_si256(match, _mm256_cmpeq_epi32(va, vb));
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(match));
+        if (mask != 0) {
+            if (out != nullptr) {
+                for (int bits = mask; bits != 0; bits &= bits - 1) {
+                    out[count++] = a[i + __builtin_ctz(bits)];
+                }
+            } else {
+                count += __builtin_popcount(mask);
+            }
+        }
+        int amax = a[i + 7], bmax = b[j + 7];
+        if (amax <= bmax) i += 8;
+        if (bmax <= amax) j += 8;
+    }
+    return count + intersectScalar(a + i, na - i, b + j, nb - j, out != nullptr ? out + count : nullptr);
+}
+#endif
+
+IntersectKernel detectKernel() {
+#ifdef NEIGHBORINDEX_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return INTERSECT_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return INTERSECT_SSE;
+#endif
+    return INTERSECT_SCALAR;
+}
+
+// kernel được chọn một lần (static cục bộ khởi tạo an toàn giữa các luồng)
+IntersectKernel &activeKernel() {
+    static IntersectKernel kernel = detectKernel();
+    return kernel;
+}
+
+} // namespace
+
+bool intersectKernelSupported(IntersectKernel kernel) {
+    switch (kernel) {
+    case INTERSECT_SCALAR: return true;
+#ifdef NEIGHBORINDEX_X86_SIMD
+    case INTERSECT_SSE: return detectKernel() >= INTERSECT_SSE;
+    case INTERSECT_AVX2: return detectKernel() == INTERSECT_AVX2;
+#endif
+    default: return false;
+    }
+}
+
+IntersectKernel intersectKernel() {
+    return activeKernel();
+}
+
+void setIntersectKernel(IntersectKernel kernel) {
+    if (intersectKernelSupported(kernel)) {
+        activeKernel() = kernel;
+    }
+}
+
+size_t intersectSorted(const int *a, size_t na, const int *b, size_t nb, int *out) {
+    switch (activeKernel()) {
+#ifdef NEIGHBORINDEX_X86_SIMD
+    case INTERSECT_AVX2: return intersectAVX2(a, na, b, nb, out);
+    case INTERSECT_SSE: return intersectSSE(a, na, b, nb, out);
+#endif
+    default: return intersectScalar(a, na, b, nb, out);
+    }
+}
+
+// =============================================================================
+// Class NeighborIndex Implementation
+// =============================================================================
+NeighborIndex::NeighborIndex() : offsets(1, 0) {}
+
+void NeighborIndex::clear() {
+    offsets.assign(1, 0);
+    neighbors.clear();
+    neighbors.shrink_to_fit();
+}
+
+vector<int> NeighborIndex::common(int u, int v) const {
+    vector<int> result(std::min(degree(u), degree(v)));
+    result.resize(intersectSorted(begin(u), degree(u), begin(v), degree(v), result.data()));
+    return result;
+}
+
+double NeighborIndex::similarity(int u, int v, SimilarityMetric metric) const {
+    if (metric == ADAMIC_ADAR) {
+        // sum 1 / log(bậc của láng giềng chung); láng giềng chung có bậc >= 2 trừ khi u == v
+        double score = 0;
+        for (int w : common(u, v)) {
+            if (degree(w) > 1) score += 1.0 / std::log(static_cast<double>(degree(w)));
+        }
+        return score;
+    }
+    size_t shared = intersectSorted(begin(u), degree(u), begin(v), degree(v));
+    if (metric == COMMON_NEIGHBORS) {
+        return shared;
+    }
+    size_t unionSize = degree(u) + degree(v) - shared;
+    return unionSize == 0 ? 0.0 : static_cast<double>(shared) / unionSize;
+}
+
+long long NeighborIndex::triangles(int v) const {
+    // mỗi tam giác (v, u, w) được đếm hai lần: qua u và qua w
+    long long count = 0;
+    for (const int *it = begin(v); it != begin(v) + degree(v); ++it) {
+        count += intersectSorted(begin(v), degree(v), begin(*it), degree(*it));
+    }
+    return count / 2;
+}
+
+long long NeighborIndex::totalTriangles(int threads) const {
+    // đếm mỗi tam giác v < u < w đúng một lần: giao phần "lớn hơn u" của N(v) và N(u)
+    int n = vertexCount();
+    vector<long long> partial(std::max(1, std::min(threads, n)), 0);
+    parallelFor(n, threads, [this, &partial](int first, int last, int part) {
+        long long count = 0;
+        for (int v = first; v < last; v++) {
+            const int *vEnd = begin(v) + degree(v);
+            for (const int *it = std::upper_bound(begin(v), vEnd, v); it != vEnd; ++it) {
+                int u = *it;
+                const int *vAbove = it + 1;
+                const int *uEnd = begin(u) + degree(u);
+                const int *uAbove = std::upper_bound(begin(u), uEnd, u);
+                count += intersectSorted(vAbove, vEnd - vAbove, uAbove, uEnd - uAbove);
+            }
+        }
+        partial[part] = count;
+    });
+    long long total = 0;
+    for (long long count : partial) {
+        total += count;
+    }
+    return total;
+}
+
+vector<vector<pair<int, double> > > NeighborIndex::topSimilar(const vector<int> &vertices, int k, SimilarityMetric metric,
+                                                              int threads) const {
+    int n = vertexCount();
+    for (int v : vertices) {
+        if (v < 0 || v >= n) throw VertexNotFoundException();
+    }
+    vector<vector<pair<int, double> > > result(vertices.size());
+    if (k <= 0) {
+        return result;
+    }
+    parallelFor(vertices.size(), threads, [this, &vertices, &result, k, metric, n](int first, int last, int) {
+        auto better = [](const pair<int, double> &a, const pair<int, double> &b) {
+            return a.second > b.second || (a.second == b.second && a.first < b.first);
+        };
+        vector<int> seenBy(n, -1); // seenBy[x] == i: x đã là ứng viên của truy vấn i
+        vector<int> candidates;
+        for (int i = first; i < last; i++) {
+            int v = vertices[i];
+            candidates.clear();
+            seenBy[v] = i;
+            for (const int *w = begin(v); w != begin(v) + degree(v); ++w) {
+                for (const int *x = begin(*w); x != begin(*w) + degree(*w); ++x) {
+                    if (seenBy[*x] != i) {
+                        seenBy[*x] = i;
+                        candidates.push_back(*x);
+                    }
+                }
+            }
+            vector<pair<int, double> > &heap = result[i];
+            for (int x : candidates) {
+                pair<int, double> candidate(x, similarity(v, x, metric));
+                if (heap.size() < static_cast<size_t>(k)) {
+                    heap.push_back(candidate);
+                    std::push_heap(heap.begin(), heap.end(), better);
+                } else if (better(candidate, heap.front())) {
+                    std::pop_heap(heap.begin(), heap.end(), better);
+                    heap.back() = candidate;
+                    std::push_heap(heap.begin(), heap.end(), better);
+                }
+            }
+            std::sort_heap(heap.begin(), heap.end(), better);
+        }
+    });
+    return result;
+}
+
+size_t NeighborIndex::memoryBytes() const {
+    return offsets.capacity() * sizeof(int) + neighbors.capacity() * sizeof(int);
+}
@@ -0,0 +1,90 @@
+#ifndef NEIGHBORINDEX_H
+#define NEIGHBORINDEX_H
+
+#include "main.h"
+
+// =====================================
+// Sorted set intersection kernels
+// =====================================
+// Giao hai mảng id tăng dần, không trùng lặp. out != nullptr thì ghi các phần tử chung (tăng dần) vào out
+// (cần chỗ cho min(na, nb) phần tử); luôn trả về số phần tử chung. Bản SIMD (SSE / AVX2) được chọn lúc
+// chạy theo CPU, máy không hỗ trợ hoặc trình biên dịch không phải GCC/Clang trên x86 thì dùng bản vô hướng.
+enum IntersectKernel
+{
+    INTERSECT_SCALAR = 0,
+    INTERSECT_SSE = 1,
+    INTERSECT_AVX2 = 2
+};
+
+size_t intersectSorted(const int *a, size_t na, const int *b, size_t nb, int *out = nullptr);
+IntersectKernel intersectKernel();                // kernel đang dùng
+bool intersectKernelSupported(IntersectKernel kernel);
+void setIntersectKernel(IntersectKernel kernel);  // ép dùng một kernel (để kiểm thử / đo), bỏ qua nếu CPU không hỗ trợ
+
+// =====================================
+// Class NeighborIndex
+// =====================================
+// Láng giềng của mỗi đỉnh theo id, bỏ qua chiều cạnh (N(v) = đỉnh có cạnh tới hoặc từ v, trừ chính v),
+// lưu liền nhau dạng CSR và sắp tăng dần để giao bằng các kernel ở trên.
+enum SimilarityMetric
+{
+    COMMON_NEIGHBORS,
+    JACCARD,
+    ADAMIC_ADAR
+};
+
+class NeighborIndex
+{
+private:
+    vector<int> offsets;   // N(v) = neighbors[offsets[v], offsets[v + 1])
+    vector<int> neighbors;
+
+public:
+    NeighborIndex();
+
+    // dựng từ ảnh chụp CSR (AdjacencySnapshot)
+    template <class Snapshot>
+    void build(const Snapshot &graph);
+    void clear();
+    bool empty() const { return offsets.size() <= 1; }
+
+    int vertexCount() const { return offsets.size() - 1; }
+    int degree(int v) const { return offsets[v + 1] - offsets[v]; }
+    const int *begin(int v) const { return neighbors.data() + offsets[v]; }
+
+    vector<int> common(int u, int v) const;
+    double similarity(int u, int v, SimilarityMetric metric) const;
+    // số tam giác (không tính chiều cạnh) chứa v
+    long long triangles(int v) const;
+    long long totalTriangles(int threads = 1) const;
+    // k đỉnh giống nhất với mỗi đỉnh trong vertices (chỉ xét láng giềng bậc 2, các đỉnh khác có điểm 0),
+    // điểm giảm dần, hòa thì id nhỏ trước; chia các đỉnh truy vấn cho threads luồng
+    vector<vector<pair<int, double> > > topSimilar(const vector<int> &vertices, int k, SimilarityMetric metric,
+                                                   int threads = 1) const;
+
+    size_t memoryBytes() const;
+};
+
+template <class Snapshot>
+void NeighborIndex::build(const Snapshot &graph)
+{
+    int n = graph.vertexCount();
+    offsets.assign(n + 1, 0);
+    neighbors.clear();
+    neighbors.reserve(graph.outTargets.size() + graph.inSources.size());
+    for (int v = 0; v < n; v++){
+        size_t start = neighbors.size();
+        for (int e = graph.outOffsets[v]; e < graph.outOffsets[v + 1]; e++){
+            if (graph.outTargets[e] != v) neighbors.push_back(graph.outTargets[e]);
+        }
+        for (int e = graph.inOffsets[v]; e < graph.inOffsets[v + 1]; e++){
+            if (graph.inSources[e] != v) neighbors.push_back(graph.inSources[e]);
+        }
+        std::sort(neighbors.begin() + start, neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin() + start, neighbors.end()), neighbors.end());
+        offsets[v + 1] = neighbors.size();
+    }
+    neighbors.shrink_to_fit();
+}
+
+#endif // NEIGHBORINDEX_H
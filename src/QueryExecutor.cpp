@@ -0,0 +1,195 @@
+#include "QueryExecutor.h"
+
+void printQueryError(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception &e) {
+        std::cerr << "QueryExecutor: unhandled error: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "QueryExecutor: unhandled error" << std::endl;
+    }
+}
+
+namespace {
+
+// pool và chỉ số của luồng worker hiện tại (nullptr / -1 nếu không phải luồng worker)
+thread_local WorkStealingPool *currentPool = nullptr;
+thread_local int currentWorker = -1;
+
+} // namespace
+
+// =============================================================================
+// SharedMutex
+// =============================================================================
+void SharedMutex::lock() {
+    std::unique_lock<std::mutex> guard(mutex);
+    waitingWriters++;
+    writerAllowed.wait(guard, [this] { return !writing && readers == 0; });
+    waitingWriters--;
+    writing = true;
+}
+
+void SharedMutex::unlock() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        writing = false;
+    }
+    writerAllowed.notify_one();
+    readersAllowed.notify_all();
+}
+
+void SharedMutex::lock_shared() {
+    std::unique_lock<std::mutex> guard(mutex);
+    readersAllowed.wait(guard, [this] { return !writing && waitingWriters == 0; });
+    readers++;
+}
+
+void SharedMutex::unlock_shared() {
+    bool last;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        last = --readers == 0;
+    }
+    if (last) {
+        writerAllowed.notify_one();
+    }
+}
+
+// =============================================================================
+// WorkStealingPool
+// =============================================================================
+WorkStealingPool::WorkStealingPool(const ExecutorOptions &options)
+    : blockWhenFull(options.blockWhenFull), onError(options.onError ? options.onError : printQueryError),
+      stopping(false), next(0) {
+    pending[LANE_INTERACTIVE] = pending[LANE_BATCH] = 0;
+    capacity[LANE_INTERACTIVE] = options.interactiveCapacity;
+    capacity[LANE_BATCH] = options.batchCapacity;
+    int count = options.threads > 0 ? options.threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int i = 0; i < count; i++) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (int i = 0; i < count; i++) {
+        threads.push_back(std::thread(&WorkStealingPool::run, this, i));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(QueryLane lane, const std::function<void()> &task) {
+    std::unique_lock<std::mutex> lock(mutex);
+    int target;
+    if (currentPool == this) {
+        target = currentWorker;
+    } else {
+        if (capacity[lane] > 0 && pending[lane] >= capacity[lane]) {
+            if (!blockWhenFull) {
+                throw QueueFullException();
+            }
+            roomChanged.wait(lock, [this, lane] { return pending[lane] < capacity[lane]; });
+        }
+        target = next++ % workers.size();
+    }
+    {
+        std::lock_guard<std::mutex> guard(workers[target]->mutex);
+        workers[target]->lanes[lane].push_back(task);
+    }
+    pending[lane]++;
+    lock.unlock();
+    available.notify_one();
+}
+
+size_t WorkStealingPool::queued(QueryLane lane) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending[lane];
+}
+
+bool WorkStealingPool::take(int self, std::function<void()> &task, int &lane) {
+    // lane interactive của mọi deque trước lane batch; deque của mình lấy từ đầu, của luồng khác lấy trộm từ cuối
+    size_t n = workers.size();
+    for (int l = LANE_INTERACTIVE; l <= LANE_BATCH; l++) {
+        for (size_t k = 0; k < n; k++) {
+            Worker &worker = *workers[(self + k) % n];
+            std::lock_guard<std::mutex> guard(worker.mutex);
+            std::deque<std::function<void()> > &queue = worker.lanes[l];
+            if (queue.empty()) {
+                continue;
+            }
+            if (k == 0) {
+                task = std::move(queue.front());
+                queue.pop_front();
+            } else {
+                task = std::move(queue.back());
+                queue.pop_back();
+            }
+            lane = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int self) {
+    currentPool = this;
+    currentWorker = self;
+    while (true) {
+        std::function<void()> task;
+        int lane;
+        if (take(self, task, lane)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending[lane]--;
+            }
+            roomChanged.notify_all();
+            try {
+                task();
+            } catch (...) {
+                // việc trả future đã tự bắt lỗi; lỗi còn lại (callback ném, truy vấn không có onError) không bị bỏ qua
+                onError(std::current_exception());
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pending[LANE_INTERACTIVE] + pending[LANE_BATCH] == 0) {
+            if (stopping) {
+                return;
+            }
+            available.wait(lock);
+        }
+    }
+}
+
+// =============================================================================
+// QueryExecutor
+// =============================================================================
+std::future<string> QueryExecutor::bfs(const string &start, QueryLane lane) {
+    return submit(lane, [start](KnowledgeGraph &graph) { return graph.bfs(start); });
+}
+
+std::future<bool> QueryExecutor::isReachable(const string &from, const string &to, QueryLane lane) {
+    return submit(lane, [from, to](KnowledgeGraph &graph) { return graph.isReachable(from, to); });
+}
+
+std::future<vector<string> > QueryExecutor::getRelatedEntities(const string &entity, int depth, QueryLane lane) {
+    return submit(lane, [entity, depth](KnowledgeGraph &graph) { return graph.getRelatedEntities(entity, depth); });
+}
+
+std::future<string> QueryExecutor::findCommonAncestors(const string &entity1, const string &entity2, QueryLane lane) {
+    return submit(lane, [entity1, entity2](KnowledgeGraph &graph) { return graph.findCommonAncestors(entity1, entity2); });
+}
+
+std::future<PathResult<string, double> > QueryExecutor::shortestPath(const string &from, const string &to, QueryLane lane) {
+    return submit(lane, [from, to](KnowledgeGraph &graph) { return graph.shortestPath(from, to); });
+}
+
+std::future<PathResult<string, double> > QueryExecutor::findPath(const string &from, const string &to, QueryLane lane) {
+    return submit(lane, [from, to](KnowledgeGraph &graph) { return graph.findPath(from, to); });
+}
@@ -0,0 +1,197 @@
+#ifndef QUERYEXECUTOR_H
+#define QUERYEXECUTOR_H
+
+#include "KnowledgeGraph.h"
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <deque>
+#include <atomic>
+
+// =====================================
+// Class SharedMutex
+// =====================================
+// Khóa đọc - ghi cho C++11 (chưa có std::shared_mutex): nhiều luồng đọc cùng lúc, ghi độc quyền.
+// Ưu tiên người ghi: khi có luồng đang chờ ghi, luồng đọc mới phải chờ, nên luồng ghi không bị bỏ đói.
+class SharedMutex
+{
+private:
+    std::mutex mutex;
+    std::condition_variable readersAllowed, writerAllowed;
+    int readers;
+    int waitingWriters;
+    bool writing;
+
+public:
+    SharedMutex() : readers(0), waitingWriters(0), writing(false) {}
+
+    void lock();
+    void unlock();
+    void lock_shared();
+    void unlock_shared();
+};
+
+class SharedLock
+{
+private:
+    SharedMutex &mutex;
+
+public:
+    explicit SharedLock(SharedMutex &mutex) : mutex(mutex) { mutex.lock_shared(); }
+    ~SharedLock() { mutex.unlock_shared(); }
+};
+
+// =====================================
+// Struct ExecutorOptions
+// =====================================
+enum QueryLane
+{
+    LANE_INTERACTIVE = 0, // truy vấn cần độ trễ thấp: luôn được lấy trước
+    LANE_BATCH = 1        // việc nền / lô lớn: chỉ chạy khi không còn việc interactive
+};
+
+// in lỗi ra std::cerr: xử lý lỗi mặc định của executor
+void printQueryError(std::exception_ptr error);
+
+struct ExecutorOptions
+{
+    int threads;                // 0: số luồng phần cứng
+    size_t interactiveCapacity; // số việc tối đa đang chờ trong mỗi lane (0: không giới hạn)
+    size_t batchCapacity;
+    bool blockWhenFull;         // lane đầy: true thì submit chờ có chỗ, false thì ném QueueFullException
+    // nhận mọi lỗi không có nơi khác nhận: truy vấn dạng callback không có onError, callback / onError ném lỗi.
+    // Gọi trên luồng worker; nullptr được thay bằng printQueryError
+    std::function<void(std::exception_ptr)> onError;
+
+    ExecutorOptions()
+        : threads(0), interactiveCapacity(1024), batchCapacity(1024), blockWhenFull(true), onError(printQueryError) {}
+};
+
+// =====================================
+// Class WorkStealingPool
+// =====================================
+// Mỗi luồng có một deque riêng cho mỗi lane. Việc gửi từ bên ngoài được rải vòng tròn vào các deque; việc
+// gửi từ chính một luồng worker vào deque của nó (không bị chặn bởi giới hạn lane, tránh tự khóa chết).
+// Luồng rảnh lấy việc interactive (của mình, rồi lấy trộm từ cuối deque của luồng khác) trước việc batch.
+// Lỗi lọt ra khỏi một việc được chuyển cho ExecutorOptions::onError. Destructor chạy hết các việc còn chờ rồi mới dừng.
+class WorkStealingPool
+{
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()> > lanes[2];
+    };
+
+    vector<std::unique_ptr<Worker> > workers;
+    vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable available, roomChanged;
+    size_t pending[2];  // số việc đang nằm trong các deque của từng lane
+    size_t capacity[2];
+    bool blockWhenFull;
+    std::function<void(std::exception_ptr)> onError;
+    bool stopping;
+    unsigned int next;  // deque nhận việc gửi từ bên ngoài tiếp theo
+
+    bool take(int self, std::function<void()> &task, int &lane);
+    void run(int self);
+
+    WorkStealingPool(const WorkStealingPool &);
+    WorkStealingPool &operator=(const WorkStealingPool &);
+
+public:
+    explicit WorkStealingPool(const ExecutorOptions &options = ExecutorOptions());
+    ~WorkStealingPool();
+
+    void submit(QueryLane lane, const std::function<void()> &task);
+    size_t queued(QueryLane lane);
+    int threadCount() const { return static_cast<int>(threads.size()); }
+};
+
+// =====================================
+// Class QueryExecutor
+// =====================================
+// Chạy truy vấn trên KnowledgeGraph ở các luồng của WorkStealingPool để vòng lặp sự kiện không bị chặn:
+// mỗi truy vấn trả về std::future, hoặc gọi callback (trên luồng worker, sau khi đã nhả khóa) với kết quả.
+// Truy vấn giữ khóa đọc nên chạy song song với nhau; update() giữ khóa ghi. Trong lúc executor còn sống,
+// mọi thay đổi đồ thị phải đi qua update().
+class QueryExecutor
+{
+private:
+    KnowledgeGraph &graph;
+    SharedMutex graphLock;
+    WorkStealingPool pool;
+
+public:
+    explicit QueryExecutor(KnowledgeGraph &graph, const ExecutorOptions &options = ExecutorOptions())
+        : graph(graph), pool(options) {}
+
+    // query(KnowledgeGraph &) chạy dưới khóa đọc; lỗi được ném lại từ future.get()
+    template <class F>
+    std::future<typename std::result_of<F(KnowledgeGraph &)>::type> submit(QueryLane lane, F query);
+    // callback(kết quả) hoặc onError(lỗi) được gọi trên luồng worker; không có onError thì lỗi của truy vấn
+    // (cũng như lỗi do callback / onError ném ra) đi tới ExecutorOptions::onError
+    template <class F, class C>
+    void submit(QueryLane lane, F query, C callback, std::function<void(std::exception_ptr)> onError = nullptr);
+    // fn(KnowledgeGraph &) chạy dưới khóa ghi
+    template <class F>
+    std::future<void> update(F fn, QueryLane lane = LANE_INTERACTIVE);
+
+    std::future<string> bfs(const string &start, QueryLane lane = LANE_INTERACTIVE);
+    std::future<bool> isReachable(const string &from, const string &to, QueryLane lane = LANE_INTERACTIVE);
+    std::future<vector<string> > getRelatedEntities(const string &entity, int depth = 2, QueryLane lane = LANE_INTERACTIVE);
+    std::future<string> findCommonAncestors(const string &entity1, const string &entity2, QueryLane lane = LANE_INTERACTIVE);
+    std::future<PathResult<string, double> > shortestPath(const string &from, const string &to, QueryLane lane = LANE_INTERACTIVE);
+    std::future<PathResult<string, double> > findPath(const string &from, const string &to, QueryLane lane = LANE_INTERACTIVE);
+
+    size_t queued(QueryLane lane) { return pool.queued(lane); }
+    int threadCount() const { return pool.threadCount(); }
+};
+
+// =============================================================================
+// QueryExecutor (template)
+// =============================================================================
+template <class F>
+std::future<typename std::result_of<F(KnowledgeGraph &)>::type> QueryExecutor::submit(QueryLane lane, F query) {
+    typedef typename std::result_of<F(KnowledgeGraph &)>::type R;
+    // packaged_task không sao chép được nên được giữ qua shared_ptr để bọc vào std::function
+    std::shared_ptr<std::packaged_task<R()> > task = std::make_shared<std::packaged_task<R()> >([this, query]() {
+        SharedLock lock(graphLock);
+        return query(graph);
+    });
+    std::future<R> result = task->get_future();
+    pool.submit(lane, [task]() { (*task)(); });
+    return result;
+}
+
+template <class F, class C>
+void QueryExecutor::submit(QueryLane lane, F query, C callback, std::function<void(std::exception_ptr)> onError) {
+    typedef typename std::result_of<F(KnowledgeGraph &)>::type R;
+    pool.submit(lane, [this, query, callback, onError]() {
+        std::unique_ptr<R> result;
+        try {
+            SharedLock lock(graphLock);
+            result.reset(new R(query(graph)));
+        } catch (...) {
+            if (!onError) throw; // WorkStealingPool::run chuyển cho xử lý lỗi của executor
+            onError(std::current_exception());
+            return;
+        }
+        callback(*result);
+    });
+}
+
+template <class F>
+std::future<void> QueryExecutor::update(F fn, QueryLane lane) {
+    std::shared_ptr<std::packaged_task<void()> > task = std::make_shared<std::packaged_task<void()> >([this, fn]() {
+        std::lock_guard<SharedMutex> lock(graphLock);
+        fn(graph);
+    });
+    std::future<void> result = task->get_future();
+    pool.submit(lane, [task]() { (*task)(); });
+    return result;
+}
+
+#endif // QUERYEXECUTOR_H
@@ -0,0 +1,387 @@
+#include "ShardedGraph.h"
+
+namespace {
+
+const unsigned long long NO_KEY = std::numeric_limits<unsigned long long>::max();
+
+unsigned long long pack(unsigned int high, unsigned int low) {
+    return (static_cast<unsigned long long>(high) << 32) | low;
+}
+
+} // namespace
+
+// =============================================================================
+// ShardedKnowledgeGraph
+// =============================================================================
+ShardedKnowledgeGraph::ShardedKnowledgeGraph(int shardCount)
+    : shardCount_(shardCount > 0 ? shardCount : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))),
+      shards(shardCount_), relations(0), job(nullptr), generation(0), remaining(0), stopping(false) {
+    for (int s = 0; s < shardCount_; s++) {
+        workers.push_back(std::thread(&ShardedKnowledgeGraph::work, this, s));
+    }
+}
+
+ShardedKnowledgeGraph::~ShardedKnowledgeGraph() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ShardedKnowledgeGraph::work(int shard) {
+    unsigned long long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        const std::function<void(int)> *task = job;
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            (*task)(shard);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        if (error && !failure) {
+            failure = error;
+        }
+        if (--remaining == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+void ShardedKnowledgeGraph::superstep(const std::function<void(int)> &job) {
+    std::unique_lock<std::mutex> lock(mutex);
+    this->job = &job;
+    remaining = shardCount_;
+    generation++;
+    wake.notify_all();
+    done.wait(lock, [this] { return remaining == 0; });
+    this->job = nullptr;
+    if (failure) {
+        std::exception_ptr error = failure;
+        failure = nullptr;
+        lock.unlock();
+        std::rethrow_exception(error);
+    }
+}
+
+int ShardedKnowledgeGraph::shardOf(const string &entity) const {
+    return static_cast<int>(std::hash<string>()(entity) % shardCount_);
+}
+
+int ShardedKnowledgeGraph::find(const string &entity) const {
+    int s = shardOf(entity);
+    unordered_map<string, int>::const_iterator it = shards[s].index.find(entity);
+    return it == shards[s].index.end() ? -1 : gid(s, it->second);
+}
+
+int ShardedKnowledgeGraph::require(const string &entity) const {
+    int id = find(entity);
+    if (id < 0) {
+        throw EntityNotFoundException();
+    }
+    return id;
+}
+
+int ShardedKnowledgeGraph::insert(int shard, const string &entity) {
+    Shard &sh = shards[shard];
+    int local = static_cast<int>(sh.names.size());
+    sh.names.push_back(entity);
+    sh.index[entity] = local;
+    sh.out.push_back(vector<int>());
+    sh.full.push_back(vector<int>());
+    sh.inDegree.push_back(0);
+    return local;
+}
+
+bool ShardedKnowledgeGraph::connectOut(int shard, int from, int to, float weight) {
+    // như VertexNode::connect: cạnh đã có thì chỉ cập nhật trọng số
+    Shard &sh = shards[shard];
+    unsigned long long key = pack(from, to);
+    unordered_map<unsigned long long, int>::iterator it = sh.outKeys.find(key);
+    if (it != sh.outKeys.end()) {
+        sh.edges[it->second].weight = weight;
+        return false;
+    }
+    int id = static_cast<int>(sh.edges.size());
+    EdgeRecord record = {from, to, weight};
+    sh.edges.push_back(record);
+    sh.outKeys[key] = id;
+    sh.out[from].push_back(id);
+    sh.full[from].push_back(id);
+    return true;
+}
+
+void ShardedKnowledgeGraph::connectIn(int shard, int to, int from) {
+    // shard của đỉnh đích tự biết cạnh có mới không, không cần hỏi shard nguồn
+    Shard &sh = shards[shard];
+    if (sh.inKeys.insert(pack(to, from)).second) {
+        sh.full[to].push_back(-from - 1);
+        sh.inDegree[to]++;
+    }
+}
+
+void ShardedKnowledgeGraph::addEntity(const string &entity) {
+    int s = shardOf(entity);
+    if (shards[s].index.count(entity)) {
+        throw EntityExistsException();
+    }
+    order.push_back(gid(s, insert(s, entity)));
+}
+
+void ShardedKnowledgeGraph::addRelation(const string &from, const string &to, float weight) {
+    int source = require(from), target = require(to);
+    if (connectOut(source % shardCount_, source / shardCount_, target, weight)) {
+        relations++;
+    }
+    connectIn(target % shardCount_, target / shardCount_, source);
+}
+
+void ShardedKnowledgeGraph::addEntities(const vector<string> &entities) {
+    int n = static_cast<int>(entities.size());
+    vector<int> owner(n), ids(n);
+    vector<char> conflict(shardCount_, 0);
+    superstep([&](int s) {
+        for (int i = static_cast<long long>(n) * s / shardCount_; i < static_cast<long long>(n) * (s + 1) / shardCount_; i++) {
+            owner[i] = shardOf(entities[i]);
+        }
+    });
+    superstep([&](int s) {
+        std::unordered_set<string> batch;
+        for (int i = 0; i < n && !conflict[s]; i++) {
+            if (owner[i] == s && (shards[s].index.count(entities[i]) || !batch.insert(entities[i]).second)) {
+                conflict[s] = 1;
+            }
+        }
+    });
+    if (std::find(conflict.begin(), conflict.end(), 1) != conflict.end()) {
+        throw EntityExistsException();
+    }
+    superstep([&](int s) {
+        for (int i = 0; i < n; i++) {
+            if (owner[i] == s) {
+                ids[i] = gid(s, insert(s, entities[i]));
+            }
+        }
+    });
+    order.insert(order.end(), ids.begin(), ids.end());
+}
+
+void ShardedKnowledgeGraph::addRelations(const vector<Relation> &batch) {
+    int n = static_cast<int>(batch.size());
+    vector<int> fromOwner(n), toOwner(n), fromIds(n), toIds(n);
+    vector<char> missing(shardCount_, 0);
+    vector<size_t> created(shardCount_, 0);
+    superstep([&](int s) {
+        for (int i = static_cast<long long>(n) * s / shardCount_; i < static_cast<long long>(n) * (s + 1) / shardCount_; i++) {
+            fromOwner[i] = shardOf(batch[i].from);
+            toOwner[i] = shardOf(batch[i].to);
+        }
+    });
+    superstep([&](int s) {
+        const unordered_map<string, int> &index = shards[s].index;
+        for (int i = 0; i < n; i++) {
+            if (fromOwner[i] == s) {
+                unordered_map<string, int>::const_iterator it = index.find(batch[i].from);
+                if (it == index.end()) missing[s] = 1;
+                else fromIds[i] = gid(s, it->second);
+            }
+            if (toOwner[i] == s) {
+                unordered_map<string, int>::const_iterator it = index.find(batch[i].to);
+                if (it == index.end()) missing[s] = 1;
+                else toIds[i] = gid(s, it->second);
+            }
+        }
+    });
+    if (std::find(missing.begin(), missing.end(), 1) != missing.end()) {
+        throw EntityNotFoundException();
+    }
+    // mỗi shard duyệt lô theo thứ tự: cạnh đi ra ở shard nguồn, mục cạnh vào ở shard đích
+    superstep([&](int s) {
+        for (int i = 0; i < n; i++) {
+            if (fromOwner[i] == s && connectOut(s, fromIds[i] / shardCount_, toIds[i], batch[i].weight)) {
+                created[s]++;
+            }
+            if (toOwner[i] == s) {
+                connectIn(s, toIds[i] / shardCount_, fromIds[i]);
+            }
+        }
+    });
+    for (size_t count : created) {
+        relations += count;
+    }
+}
+
+vector<string> ShardedKnowledgeGraph::getAllEntities() const {
+    vector<string> result;
+    result.reserve(order.size());
+    for (int id : order) {
+        result.push_back(name(id));
+    }
+    return result;
+}
+
+vector<string> ShardedKnowledgeGraph::getNeighbors(const string &entity) const {
+    int id = require(entity);
+    const Shard &sh = shards[id % shardCount_];
+    vector<string> neighbors;
+    for (int edge : sh.out[id / shardCount_]) {
+        neighbors.push_back(name(sh.edges[edge].to));
+    }
+    return neighbors;
+}
+
+string ShardedKnowledgeGraph::edgeString(int shard, int edge) const {
+    // cùng định dạng với Edge::toString()
+    const EdgeRecord &record = shards[shard].edges[edge];
+    stringstream ss;
+    ss << "(" << shards[shard].names[record.from] << ", " << name(record.to) << ", ";
+    ss.precision(6);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    ss << record.weight << ")";
+    return ss.str();
+}
+
+string ShardedKnowledgeGraph::nodeString(int id) const {
+    // cùng định dạng với VertexNode::toString(); cạnh vào được đọc từ shard nguồn
+    int s = id % shardCount_, v = id / shardCount_;
+    const Shard &sh = shards[s];
+    stringstream ss;
+    ss << "(" << sh.names[v] << ", " << sh.inDegree[v] << ", " << sh.out[v].size() << ", [";
+    for (size_t i = 0; i < sh.full[v].size(); i++) {
+        if (i > 0) ss << ", ";
+        int entry = sh.full[v][i];
+        if (entry >= 0) {
+            ss << edgeString(s, entry);
+        } else {
+            int from = -entry - 1;
+            int owner = from % shardCount_;
+            ss << edgeString(owner, shards[owner].outKeys.at(pack(from / shardCount_, id)));
+        }
+    }
+    ss << "])";
+    return ss.str();
+}
+
+vector<int> ShardedKnowledgeGraph::traverse(int source, int maxDepth, int target) {
+    superstep([this](int s) {
+        Shard &sh = shards[s];
+        sh.visited.assign(sh.names.size(), 0);
+        sh.best.assign(sh.names.size(), NO_KEY);
+        sh.frontier.clear();
+        sh.outbox.assign(shardCount_, vector<Message>());
+        sh.discovered.clear();
+    });
+    vector<int> visitOrder(1, source);
+    shards[source % shardCount_].visited[source / shardCount_] = 1;
+    shards[source % shardCount_].frontier.push_back(make_pair(source / shardCount_, 0u));
+    if (source == target) {
+        return visitOrder;
+    }
+
+    std::function<void(int)> expand = [this](int s) {
+        // visited chỉ bị ghi ở bước receive nên đọc visited của shard khác ở đây là an toàn
+        Shard &sh = shards[s];
+        for (auto &box : sh.outbox) box.clear();
+        for (const pair<int, unsigned int> &entry : sh.frontier) {
+            const vector<int> &edges = sh.out[entry.first];
+            for (size_t k = 0; k < edges.size(); k++) {
+                int to = sh.edges[edges[k]].to;
+                int owner = to % shardCount_, local = to / shardCount_;
+                if (!shards[owner].visited[local]) {
+                    Message message = {entry.second, static_cast<unsigned int>(k), local};
+                    sh.outbox[owner].push_back(message);
+                }
+            }
+        }
+        sh.frontier.clear();
+    };
+    std::function<void(int)> receive = [this](int s) {
+        // giữ khóa (hạng cha, vị trí cạnh) nhỏ nhất cho mỗi đỉnh mới: đúng lần gặp đầu tiên của BFS tuần tự
+        Shard &sh = shards[s];
+        sh.discovered.clear();
+        for (int r = 0; r < shardCount_; r++) {
+            for (const Message &message : shards[r].outbox[s]) {
+                unsigned long long key = pack(message.rank, message.slot);
+                if (sh.best[message.target] == NO_KEY) {
+                    sh.discovered.push_back(make_pair(0ULL, message.target));
+                }
+                sh.best[message.target] = std::min(sh.best[message.target], key);
+            }
+        }
+        for (auto &entry : sh.discovered) {
+            entry.first = sh.best[entry.second];
+            sh.best[entry.second] = NO_KEY;
+            sh.visited[entry.second] = 1;
+        }
+        std::sort(sh.discovered.begin(), sh.discovered.end());
+    };
+
+    for (int level = 1; maxDepth < 0 || level <= maxDepth; level++) {
+        superstep(expand);
+        superstep(receive);
+        // trộn các danh sách đã sắp của các shard thành frontier mới (hạng = vị trí trong mức)
+        std::priority_queue<pair<unsigned long long, int>, vector<pair<unsigned long long, int> >,
+                            std::greater<pair<unsigned long long, int> > > heads;
+        vector<size_t> cursor(shardCount_, 0);
+        for (int s = 0; s < shardCount_; s++) {
+            if (!shards[s].discovered.empty()) heads.push(make_pair(shards[s].discovered[0].first, s));
+        }
+        if (heads.empty()) {
+            break;
+        }
+        unsigned int rank = 0;
+        while (!heads.empty()) {
+            int s = heads.top().second;
+            heads.pop();
+            int local = shards[s].discovered[cursor[s]++].second;
+            shards[s].frontier.push_back(make_pair(local, rank++));
+            visitOrder.push_back(gid(s, local));
+            if (visitOrder.back() == target) {
+                return visitOrder;
+            }
+            if (cursor[s] < shards[s].discovered.size()) heads.push(make_pair(shards[s].discovered[cursor[s]].first, s));
+        }
+    }
+    return visitOrder;
+}
+
+string ShardedKnowledgeGraph::bfs(const string &start) {
+    vector<int> visitOrder = traverse(require(start), -1, -1);
+    vector<string> parts(visitOrder.size());
+    superstep([&](int s) {
+        for (size_t i = 0; i < visitOrder.size(); i++) {
+            if (visitOrder[i] % shardCount_ == s) parts[i] = nodeString(visitOrder[i]);
+        }
+    });
+    string result = "[";
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (i > 0) result += ", ";
+        result += parts[i];
+    }
+    return result + "]";
+}
+
+bool ShardedKnowledgeGraph::isReachable(const string &from, const string &to) {
+    int target = require(to);
+    return traverse(require(from), -1, target).back() == target;
+}
+
+vector<string> ShardedKnowledgeGraph::getRelatedEntities(const string &entity, int depth) {
+    vector<int> visitOrder = traverse(require(entity), depth, -1);
+    vector<string> result;
+    for (size_t i = 1; i < visitOrder.size(); i++) {
+        result.push_back(name(visitOrder[i]));
+    }
+    return result;
+}
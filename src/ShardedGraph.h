@@ -0,0 +1,127 @@
+#ifndef SHARDEDGRAPH_H
+#define SHARDEDGRAPH_H
+
+#include "main.h"
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <unordered_set>
+
+// =====================================
+// Class ShardedKnowledgeGraph
+// =====================================
+// Đồ thị tri thức (quan hệ không nhãn) chia theo băm tên thực thể vào N shard trong cùng tiến trình. Mỗi shard
+// sở hữu các đỉnh của nó, các cạnh đi ra của chúng (kèm trọng số) và danh sách cạnh kề đầy đủ (vào + ra, như
+// adListFull), và có một luồng worker riêng. Id toàn cục của đỉnh: local * N + shard.
+// addEntities / addRelations chạy song song trên các shard: mỗi shard xử lý phần của lô theo đúng thứ tự lô.
+// bfs / isReachable / getRelatedEntities chạy theo superstep: mỗi shard mở rộng frontier của mình và gửi
+// thông điệp (hạng cha, vị trí cạnh, đích) tới shard sở hữu đích; shard đích giữ thông điệp nhỏ nhất cho mỗi
+// đỉnh chưa thăm, nên thứ tự thăm trùng với BFS tuần tự. Kết quả giống KnowledgeGraph được dựng bằng cùng
+// chuỗi addEntity / addRelation. Mỗi lúc chỉ một thao tác (không gọi đồng thời từ nhiều luồng).
+class ShardedKnowledgeGraph
+{
+public:
+    struct Relation
+    {
+        string from;
+        string to;
+        float weight;
+
+        Relation(const string &from, const string &to, float weight = 1.0f) : from(from), to(to), weight(weight) {}
+    };
+
+private:
+    struct EdgeRecord
+    {
+        int from;     // id cục bộ trong shard sở hữu
+        int to;       // id toàn cục
+        float weight;
+    };
+
+    struct Message
+    {
+        unsigned int rank; // hạng của đỉnh cha trong frontier
+        unsigned int slot; // vị trí cạnh trong danh sách đi ra của đỉnh cha
+        int target;        // id cục bộ trong shard đích
+    };
+
+    struct Shard
+    {
+        vector<string> names;
+        unordered_map<string, int> index;
+        vector<EdgeRecord> edges;
+        vector<vector<int> > out;  // id cạnh đi ra (trong edges) của từng đỉnh
+        vector<vector<int> > full; // cạnh kề theo thứ tự tạo: >= 0 là id cạnh đi ra, < 0 là -(gid nguồn) - 1
+        vector<int> inDegree;
+        unordered_map<unsigned long long, int> outKeys; // (from cục bộ, to toàn cục) -> id cạnh
+        std::unordered_set<unsigned long long> inKeys;  // (to cục bộ, from toàn cục)
+
+        // trạng thái của lần duyệt đang chạy
+        vector<char> visited;
+        vector<unsigned long long> best;
+        vector<pair<int, unsigned int> > frontier;          // (id cục bộ, hạng)
+        vector<vector<Message> > outbox;                    // theo shard đích
+        vector<pair<unsigned long long, int> > discovered;  // (khóa, id cục bộ), sắp theo khóa
+    };
+
+    int shardCount_;
+    vector<Shard> shards;
+    vector<int> order;  // gid theo thứ tự thêm
+    size_t relations;
+
+    // superstep: job(shard) chạy trên worker của từng shard, trả về khi tất cả xong (ném lại lỗi đầu tiên)
+    vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(int)> *job;
+    unsigned long long generation;
+    int remaining;
+    bool stopping;
+    std::exception_ptr failure;
+
+    void work(int shard);
+    void superstep(const std::function<void(int)> &job);
+
+    int gid(int shard, int local) const { return local * shardCount_ + shard; }
+    const string &name(int gid) const { return shards[gid % shardCount_].names[gid / shardCount_]; }
+    int find(const string &entity) const; // gid, -1 nếu không có
+    int require(const string &entity) const;
+    int insert(int shard, const string &entity);
+    bool connectOut(int shard, int from, int to, float weight); // true nếu là cạnh mới
+    void connectIn(int shard, int to, int from);
+    string edgeString(int shard, int edge) const;
+    string nodeString(int gid) const;
+    // duyệt theo mức từ source, tối đa maxDepth mức (< 0: không giới hạn), dừng sớm khi thăm target;
+    // trả về gid theo thứ tự thăm (source đứng đầu)
+    vector<int> traverse(int source, int maxDepth, int target);
+
+    ShardedKnowledgeGraph(const ShardedKnowledgeGraph &);
+    ShardedKnowledgeGraph &operator=(const ShardedKnowledgeGraph &);
+
+public:
+    explicit ShardedKnowledgeGraph(int shardCount = 0); // 0: số luồng phần cứng
+    ~ShardedKnowledgeGraph();
+
+    int shardCount() const { return shardCount_; }
+    int shardOf(const string &entity) const;
+    int shardSize(int shard) const { return static_cast<int>(shards[shard].names.size()); }
+
+    void addEntity(const string &entity);
+    void addRelation(const string &from, const string &to, float weight = 1.0f);
+    // nạp theo lô, song song trên các shard; lỗi (EntityExistsException / EntityNotFoundException) được ném
+    // trước khi lô thay đổi đồ thị
+    void addEntities(const vector<string> &entities);
+    void addRelations(const vector<Relation> &relations);
+
+    bool contains(const string &entity) const { return find(entity) >= 0; }
+    int size() const { return static_cast<int>(order.size()); }
+    size_t relationCount() const { return relations; }
+    vector<string> getAllEntities() const;
+    vector<string> getNeighbors(const string &entity) const;
+
+    string bfs(const string &start);
+    bool isReachable(const string &from, const string &to);
+    vector<string> getRelatedEntities(const string &entity, int depth = 2);
+};
+
+#endif // SHARDEDGRAPH_H
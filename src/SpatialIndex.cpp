@@ -0,0 +1,172 @@
+#include "SpatialIndex.h"
+
+// =============================================================================
+// Class SpatialIndex Implementation
+// =============================================================================
+SpatialIndex::SpatialIndex() : count(0), dirty(false) {}
+
+double SpatialIndex::axis(const Point &point, int depth) {
+    switch (depth % 3) {
+    case 0: return point.getX();
+    case 1: return point.getY();
+    default: return point.getZ();
+    }
+}
+
+void SpatialIndex::set(int id, const Point &point) {
+    if (static_cast<size_t>(id) >= points.size()) {
+        points.resize(id + 1);
+        placed.resize(id + 1, false);
+    }
+    if (!placed[id]) {
+        placed[id] = true;
+        count++;
+    }
+    // Point có copy constructor tự viết nên không dùng phép gán ngầm định (deprecated)
+    points[id].setX(point.getX());
+    points[id].setY(point.getY());
+    points[id].setZ(point.getZ());
+    dirty = true;
+}
+
+void SpatialIndex::remove(int id) {
+    if (has(id)) {
+        placed[id] = false;
+        count--;
+        dirty = true;
+    }
+}
+
+bool SpatialIndex::has(int id) const {
+    return id >= 0 && static_cast<size_t>(id) < placed.size() && placed[id];
+}
+
+const Point &SpatialIndex::get(int id) const {
+    return points.at(id);
+}
+
+int SpatialIndex::size() const {
+    return count;
+}
+
+void SpatialIndex::clear() {
+    points.clear();
+    placed.clear();
+    tree.clear();
+    count = 0;
+    dirty = false;
+}
+
+void SpatialIndex::swap(SpatialIndex &other) {
+    points.swap(other.points);
+    placed.swap(other.placed);
+    tree.swap(other.tree);
+    std::swap(count, other.count);
+    bool wasDirty = dirty;
+    dirty = other.dirty.load();
+    other.dirty = wasDirty;
+}
+
+void SpatialIndex::ensureBuilt() {
+    if (!dirty.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(rebuildMutex);
+    if (dirty.load(std::memory_order_relaxed)) {
+        rebuild();
+    }
+}
+
+void SpatialIndex::rebuild() {
+    tree.clear();
+    tree.reserve(count);
+    for (size_t id = 0; id < placed.size(); id++) {
+        if (placed[id]) {
+            tree.push_back(id);
+        }
+    }
+    build(0, tree.size(), 0);
+    dirty.store(false, std::memory_order_release);
+}
+
+void SpatialIndex::build(int lo, int hi, int depth) {
+    if (hi - lo <= 1) {
+        return;
+    }
+    int mid = lo + (hi - lo) / 2;
+    const vector<Point> &pts = points;
+    std::nth_element(tree.begin() + lo, tree.begin() + mid, tree.begin() + hi,
+                     [&pts, depth](int a, int b) { return axis(pts[a], depth) < axis(pts[b], depth); });
+    build(lo, mid, depth + 1);
+    build(mid + 1, hi, depth + 1);
+}
+
+void SpatialIndex::nearest(int lo, int hi, int depth, const Point &center, size_t k, vector<pair<double, int> > &heap) const {
+    // heap: max-heap theo (khoảng cách, id) giữ k ứng viên tốt nhất
+    if (lo >= hi) {
+        return;
+    }
+    int mid = lo + (hi - lo) / 2;
+    int id = tree[mid];
+    pair<double, int> candidate(center.distanceTo(points[id]), id);
+    if (heap.size() < k) {
+        heap.push_back(candidate);
+        std::push_heap(heap.begin(), heap.end());
+    } else if (candidate < heap.front()) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = candidate;
+        std::push_heap(heap.begin(), heap.end());
+    }
+
+    double diff = axis(center, depth) - axis(points[id], depth);
+    // nhánh chứa center trước; nhánh còn lại chỉ khi mặt phẳng chia gần hơn ứng viên xa nhất
+    if (diff < 0) {
+        nearest(lo, mid, depth + 1, center, k, heap);
+        if (heap.size() < k || -diff <= heap.front().first) nearest(mid + 1, hi, depth + 1, center, k, heap);
+    } else {
+        nearest(mid + 1, hi, depth + 1, center, k, heap);
+        if (heap.size() < k || diff <= heap.front().first) nearest(lo, mid, depth + 1, center, k, heap);
+    }
+}
+
+void SpatialIndex::within(int lo, int hi, int depth, const Point &center, double radius, vector<pair<double, int> > &found) const {
+    if (lo >= hi) {
+        return;
+    }
+    int mid = lo + (hi - lo) / 2;
+    int id = tree[mid];
+    double distance = center.distanceTo(points[id]);
+    if (distance <= radius) {
+        found.push_back(make_pair(distance, id));
+    }
+    double diff = axis(center, depth) - axis(points[id], depth);
+    // nửa trái có tọa độ <= mặt chia, nửa phải >= mặt chia
+    if (diff <= radius) within(lo, mid, depth + 1, center, radius, found);
+    if (-diff <= radius) within(mid + 1, hi, depth + 1, center, radius, found);
+}
+
+vector<pair<double, int> > SpatialIndex::nearest(const Point &center, int k) {
+    vector<pair<double, int> > heap;
+    if (k <= 0 || count == 0) {
+        return heap;
+    }
+    ensureBuilt();
+    nearest(0, tree.size(), 0, center, k, heap);
+    std::sort_heap(heap.begin(), heap.end());
+    return heap;
+}
+
+vector<pair<double, int> > SpatialIndex::within(const Point &center, double radius) {
+    vector<pair<double, int> > found;
+    if (radius < 0 || count == 0) {
+        return found;
+    }
+    ensureBuilt();
+    within(0, tree.size(), 0, center, radius, found);
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+size_t SpatialIndex::memoryBytes() const {
+    return points.capacity() * sizeof(Point) + placed.capacity() / 8 + tree.capacity() * sizeof(int);
+}
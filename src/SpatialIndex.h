@@ -0,0 +1,52 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include "main.h"
+#include <atomic>
+#include <mutex>
+
+// =====================================
+// Class SpatialIndex
+// =====================================
+// Tọa độ (Point) của các đỉnh, đánh theo id đỉnh, cùng một cây k-d 3 chiều để trả lời
+// "k đỉnh gần nhất" và "các đỉnh trong bán kính r". Cây được dựng lại (O(n log n)) ở lần truy vấn
+// đầu tiên sau khi tọa độ thay đổi, nên cập nhật liên tiếp không tốn chi phí dựng cây. Truy vấn có thể chạy
+// song song với nhau (chỉ một luồng dựng lại cây), nhưng không song song với set() / remove() / clear().
+class SpatialIndex
+{
+private:
+    vector<Point> points; // points[id], chỉ có nghĩa khi placed[id]
+    vector<bool> placed;
+    int count;            // số đỉnh có tọa độ
+
+    // cây k-d ngầm: nút giữa đoạn [lo, hi) của tree là trung vị theo trục depth % 3
+    vector<int> tree;
+    std::atomic<bool> dirty;
+    std::mutex rebuildMutex;
+
+    static double axis(const Point &point, int depth);
+    void rebuild();
+    void ensureBuilt();
+    void build(int lo, int hi, int depth);
+    void nearest(int lo, int hi, int depth, const Point &center, size_t k, vector<pair<double, int> > &heap) const;
+    void within(int lo, int hi, int depth, const Point &center, double radius, vector<pair<double, int> > &found) const;
+
+public:
+    SpatialIndex();
+
+    void set(int id, const Point &point);
+    void remove(int id);
+    bool has(int id) const;
+    const Point &get(int id) const;
+    int size() const;
+    void clear();
+    void swap(SpatialIndex &other);
+
+    // (khoảng cách, id) tăng dần theo khoảng cách, hòa thì id nhỏ trước
+    vector<pair<double, int> > nearest(const Point &center, int k);
+    vector<pair<double, int> > within(const Point &center, double radius);
+
+    size_t memoryBytes() const;
+};
+
+#endif // SPATIALINDEX_H
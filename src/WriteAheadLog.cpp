@@ -0,0 +1,444 @@
+#include "WriteAheadLog.h"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+enum RecordType
+{
+    RECORD_ENTITY = 1,
+    RECORD_RELATION = 2,
+    RECORD_TRIPLE = 3,
+    RECORD_POSITION = 4
+};
+
+const size_t HEADER_BYTES = sizeof(unsigned int) * 2 + sizeof(unsigned long long);
+
+vector<unsigned int> crcTable() {
+    vector<unsigned int> table(256);
+    for (unsigned int i = 0; i < 256; i++) {
+        unsigned int c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}
+
+unsigned int crc32(unsigned int crc, const char *data, size_t size) {
+    // biến static cục bộ được khởi tạo đúng một lần kể cả khi nhiều log ghi từ nhiều luồng (C++11)
+    static const vector<unsigned int> table = crcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+unsigned int checksum(unsigned long long lsn, const char *payload, size_t size) {
+    return crc32(crc32(0, reinterpret_cast<const char *>(&lsn), sizeof(lsn)), payload, size);
+}
+
+int syncData(int fd) {
+#if defined(__APPLE__)
+    return fsync(fd);
+#else
+    return fdatasync(fd);
+#endif
+}
+
+// ghi hết data (write có thể ghi thiếu / bị ngắt), trả về thông báo lỗi hoặc chuỗi rỗng
+string writeFully(int fd, const string &data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t written = ::write(fd, data.data() + done, data.size() - done);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return strerror(errno);
+        }
+        done += written;
+    }
+    return "";
+}
+
+// đọc toàn bộ tệp; false nếu không mở được
+bool readFile(const string &path, string &data) {
+    ifstream in(path.c_str(), ios::binary);
+    if (!in) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+} // namespace
+
+// =============================================================================
+// WriteAheadLog
+// =============================================================================
+WriteAheadLog::WriteAheadLog()
+    : fd(-1), lastLsn(0), durableLsn(0), fileBytes(0), urgent(false), stopping(false), writing(false) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+unsigned long long WriteAheadLog::replay(const string &path, unsigned long long afterLsn,
+                                         const std::function<void(const string &)> &apply, size_t *applied) {
+    if (applied != nullptr) *applied = 0;
+    string data;
+    if (!readFile(path, data)) {
+        return afterLsn; // chưa có log
+    }
+    unsigned long long last = afterLsn;
+    size_t offset = 0, valid = 0;
+    while (true) {
+        unsigned int length, crc;
+        unsigned long long lsn;
+        if (!getBytes(data, offset, length) || !getBytes(data, offset, crc) || !getBytes(data, offset, lsn) ||
+            data.size() < offset + length) {
+            break; // bản ghi chưa ghi hết
+        }
+        if (checksum(lsn, data.data() + offset, length) != crc) {
+            // chỉ bản ghi cuối cùng mới có thể hỏng vì sập giữa lúc ghi (kể cả các khối đã cấp phát mà còn toàn
+            // số 0); hỏng ở giữa log là mất dữ liệu thật, cắt đi sẽ bỏ luôn các bản ghi hợp lệ phía sau
+            if (offset + length < data.size() && data.find_first_not_of('\0', valid) != string::npos) {
+                throw StorageException("Corrupt write-ahead log record at offset " + std::to_string(valid) +
+                                       " in " + path);
+            }
+            break;
+        }
+        string payload(data, offset, length);
+        offset += length;
+        valid = offset;
+        if (lsn > afterLsn) {
+            apply(payload);
+            if (applied != nullptr) (*applied)++;
+        }
+        last = std::max(last, lsn);
+    }
+    if (valid < data.size()) {
+        // đuôi dở dang của lần ghi bị sập: cắt đi để các bản ghi mới nối tiếp phần hợp lệ
+        if (truncate(path.c_str(), valid) != 0) {
+            throw StorageException("Cannot truncate " + path + ": " + strerror(errno));
+        }
+    }
+    return last;
+}
+
+void WriteAheadLog::open(const string &path, unsigned long long lastLsn, const DurabilityOptions &options) {
+    close();
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        throw StorageException("Cannot open " + path + ": " + strerror(errno));
+    }
+    struct stat info;
+    fileBytes = fstat(fd, &info) == 0 ? info.st_size : 0;
+    this->options = options;
+    this->lastLsn = durableLsn = lastLsn;
+    error.clear();
+    flusher = std::thread(&WriteAheadLog::run, this);
+}
+
+void WriteAheadLog::close() {
+    if (fd < 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    pendingChanged.notify_one();
+    flusher.join();
+    ::close(fd);
+    fd = -1;
+    stopping = false;
+}
+
+void WriteAheadLog::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        pendingChanged.wait(lock, [this] { return stopping || urgent || !buffer.empty(); });
+        if (buffer.empty()) {
+            if (stopping) break;
+            urgent = false;
+            continue;
+        }
+        // gom thêm bản ghi cho tới hạn của bản ghi cũ nhất, trừ khi đã đủ byte hoặc có yêu cầu ghi ngay
+        std::chrono::steady_clock::time_point deadline = oldest + std::chrono::microseconds(options.groupCommitMicros);
+        while (!stopping && !urgent && buffer.size() < options.groupCommitBytes) {
+            if (pendingChanged.wait_until(lock, deadline) == std::cv_status::timeout) break;
+        }
+        string batch;
+        batch.swap(buffer);
+        unsigned long long upTo = lastLsn;
+        urgent = false;
+        writing = true;
+        fileBytes += batch.size();
+        lock.unlock();
+
+        string failure = writeFully(fd, batch);
+        if (failure.empty() && syncData(fd) != 0) {
+            failure = strerror(errno);
+        }
+
+        lock.lock();
+        writing = false;
+        if (failure.empty()) {
+            durableLsn = upTo;
+        } else {
+            error = "Write-ahead log failed: " + failure;
+        }
+        durableChanged.notify_all();
+        if (!error.empty()) break;
+    }
+}
+
+void WriteAheadLog::failIfBroken() {
+    if (!error.empty()) {
+        throw StorageException(error);
+    }
+    if (fd < 0) {
+        throw StorageException("Write-ahead log is not open");
+    }
+}
+
+void WriteAheadLog::checkHealthy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    failIfBroken();
+}
+
+unsigned long long WriteAheadLog::append(const string &payload) {
+    std::lock_guard<std::mutex> lock(mutex);
+    failIfBroken();
+    unsigned long long lsn = ++lastLsn;
+    if (buffer.empty()) {
+        oldest = std::chrono::steady_clock::now();
+    }
+    putBytes(buffer, static_cast<unsigned int>(payload.size()));
+    putBytes(buffer, checksum(lsn, payload.data(), payload.size()));
+    putBytes(buffer, lsn);
+    buffer.append(payload);
+    pendingChanged.notify_one();
+    return lsn;
+}
+
+void WriteAheadLog::waitDurable(unsigned long long lsn) {
+    std::unique_lock<std::mutex> lock(mutex);
+    durableChanged.wait(lock, [this, lsn] { return durableLsn >= lsn || !error.empty(); });
+    failIfBroken();
+}
+
+void WriteAheadLog::sync() {
+    std::unique_lock<std::mutex> lock(mutex);
+    failIfBroken();
+    unsigned long long target = lastLsn;
+    urgent = true;
+    pendingChanged.notify_one();
+    durableChanged.wait(lock, [this, target] { return durableLsn >= target || !error.empty(); });
+    failIfBroken();
+}
+
+void WriteAheadLog::reset() {
+    sync();
+    std::unique_lock<std::mutex> lock(mutex);
+    durableChanged.wait(lock, [this] { return !writing; });
+    if (!buffer.empty()) {
+        throw StorageException("Write-ahead log reset while records are pending");
+    }
+    if (ftruncate(fd, 0) != 0 || syncData(fd) != 0) {
+        error = string("Write-ahead log failed: ") + strerror(errno);
+        throw StorageException(error);
+    }
+    fileBytes = 0;
+}
+
+unsigned long long WriteAheadLog::lsn() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastLsn;
+}
+
+size_t WriteAheadLog::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fileBytes + buffer.size();
+}
+
+// =============================================================================
+// DurableKnowledgeGraph
+// =============================================================================
+DurableKnowledgeGraph::DurableKnowledgeGraph(const string &directory, const DurabilityOptions &options)
+    : directory(directory), options(options), replayed_(0) {
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw StorageException("Cannot create " + directory + ": " + strerror(errno));
+    }
+    // checkpoint: "KGC1", lsn (uint64), ảnh chụp KnowledgeGraph
+    unsigned long long checkpointLsn = 0;
+    string data;
+    if (readFile(path("checkpoint.dat"), data)) {
+        size_t offset = 4;
+        if (data.compare(0, 4, "KGC1") != 0 || !getBytes(data, offset, checkpointLsn)) {
+            throw StorageException("Corrupt checkpoint in " + directory);
+        }
+        istringstream snapshot(data.substr(offset));
+        graph_.loadSnapshot(snapshot);
+    }
+    string().swap(data);
+    unsigned long long last = WriteAheadLog::replay(path("wal.log"), checkpointLsn,
+                                                    [this](const string &payload) { apply(payload); }, &replayed_);
+    log.open(path("wal.log"), last, options);
+}
+
+DurableKnowledgeGraph::~DurableKnowledgeGraph() {
+    try {
+        log.sync();
+    } catch (const StorageException &) {
+        // không ném từ destructor
+    }
+}
+
+void DurableKnowledgeGraph::remove(const string &directory) {
+    const char *files[] = {"wal.log", "checkpoint.dat", "checkpoint.tmp"};
+    for (const char *file : files) {
+        std::remove((directory + "/" + file).c_str());
+    }
+    rmdir(directory.c_str());
+}
+
+void DurableKnowledgeGraph::apply(const string &payload) {
+    size_t offset = 0;
+    unsigned char type = 0;
+    string first, second, third;
+    float weight;
+    double x, y, z;
+    bool ok = getBytes(payload, offset, type);
+    if (ok && type == RECORD_ENTITY) {
+        ok = getString(payload, offset, first);
+        if (ok) graph_.addEntity(first);
+    } else if (ok && type == RECORD_RELATION) {
+        ok = getString(payload, offset, first) && getString(payload, offset, second) && getBytes(payload, offset, weight);
+        if (ok) graph_.addRelation(first, second, weight);
+    } else if (ok && type == RECORD_TRIPLE) {
+        ok = getString(payload, offset, first) && getString(payload, offset, second) && getString(payload, offset, third) &&
+             getBytes(payload, offset, weight);
+        if (ok) graph_.addTriple(first, second, third, weight);
+    } else if (ok && type == RECORD_POSITION) {
+        ok = getString(payload, offset, first) && getBytes(payload, offset, x) && getBytes(payload, offset, y) &&
+             getBytes(payload, offset, z);
+        if (ok) graph_.setPosition(first, Point(x, y, z));
+    } else {
+        ok = false;
+    }
+    if (!ok || offset != payload.size()) {
+        throw StorageException("Corrupt write-ahead log record in " + directory);
+    }
+}
+
+void DurableKnowledgeGraph::commit(const string &payload, std::unique_lock<std::mutex> &lock) {
+    // thao tác đã được áp dụng (và kiểm tra lỗi) trên đồ thị; chỉ chờ fsync sau khi nhả khóa để các luồng
+    // khác kịp thêm bản ghi vào cùng nhóm
+    unsigned long long lsn = log.append(payload);
+    if (options.checkpointBytes > 0 && log.size() >= options.checkpointBytes) {
+        checkpointLocked();
+    }
+    lock.unlock();
+    if (options.synchronous) {
+        log.waitDurable(lsn);
+    }
+}
+
+void DurableKnowledgeGraph::addEntity(const string &entity) {
+    std::unique_lock<std::mutex> lock(mutex);
+    log.checkHealthy();
+    graph_.addEntity(entity);
+    string payload;
+    putBytes(payload, static_cast<unsigned char>(RECORD_ENTITY));
+    putString(payload, entity);
+    commit(payload, lock);
+}
+
+void DurableKnowledgeGraph::addRelation(const string &from, const string &to, float weight) {
+    std::unique_lock<std::mutex> lock(mutex);
+    log.checkHealthy();
+    graph_.addRelation(from, to, weight);
+    string payload;
+    putBytes(payload, static_cast<unsigned char>(RECORD_RELATION));
+    putString(payload, from);
+    putString(payload, to);
+    putBytes(payload, weight);
+    commit(payload, lock);
+}
+
+void DurableKnowledgeGraph::addTriple(const string &subject, const string &predicate, const string &object, float weight) {
+    std::unique_lock<std::mutex> lock(mutex);
+    log.checkHealthy();
+    graph_.addTriple(subject, predicate, object, weight);
+    string payload;
+    putBytes(payload, static_cast<unsigned char>(RECORD_TRIPLE));
+    putString(payload, subject);
+    putString(payload, predicate);
+    putString(payload, object);
+    putBytes(payload, weight);
+    commit(payload, lock);
+}
+
+void DurableKnowledgeGraph::setPosition(const string &entity, const Point &position) {
+    std::unique_lock<std::mutex> lock(mutex);
+    log.checkHealthy();
+    graph_.setPosition(entity, position);
+    string payload;
+    putBytes(payload, static_cast<unsigned char>(RECORD_POSITION));
+    putString(payload, entity);
+    putBytes(payload, position.getX());
+    putBytes(payload, position.getY());
+    putBytes(payload, position.getZ());
+    commit(payload, lock);
+}
+
+void DurableKnowledgeGraph::sync() {
+    log.sync();
+}
+
+void DurableKnowledgeGraph::checkpoint() {
+    std::lock_guard<std::mutex> lock(mutex);
+    checkpointLocked();
+}
+
+void DurableKnowledgeGraph::checkpointLocked() {
+    // ghi ảnh chụp ra tệp tạm + fsync, đổi tên (nguyên tử), fsync thư mục, rồi mới cắt log: sập ở bất kỳ bước
+    // nào cũng còn hoặc checkpoint cũ + log đầy đủ, hoặc checkpoint mới (các bản ghi lsn cũ bị bỏ qua khi replay)
+    unsigned long long lsn = log.lsn();
+    string data("KGC1");
+    putBytes(data, lsn);
+    ostringstream snapshot;
+    graph_.saveSnapshot(snapshot);
+    data += snapshot.str();
+
+    string temporary = path("checkpoint.tmp");
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw StorageException("Cannot open " + temporary + ": " + strerror(errno));
+    }
+    string failure = writeFully(fd, data);
+    if (failure.empty() && fsync(fd) != 0) {
+        failure = strerror(errno);
+    }
+    ::close(fd);
+    if (failure.empty() && rename(temporary.c_str(), path("checkpoint.dat").c_str()) != 0) {
+        failure = strerror(errno);
+    }
+    if (!failure.empty()) {
+        throw StorageException("Checkpoint failed: " + failure);
+    }
+    int dir = ::open(directory.c_str(), O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        ::close(dir);
+    }
+    log.reset();
+}
@@ -0,0 +1,121 @@
+#ifndef WRITEAHEADLOG_H
+#define WRITEAHEADLOG_H
+
+#include "KnowledgeGraph.h"
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// =====================================
+// Struct DurabilityOptions
+// =====================================
+// Group commit: bản ghi được gom trong bộ nhớ và một luồng nền ghi + fdatasync cả nhóm một lần, khi bản
+// ghi cũ nhất đã chờ groupCommitMicros hoặc khi đã dồn groupCommitBytes. Giá trị nhỏ: độ trễ thấp, nhiều
+// fsync; giá trị lớn: ít fsync hơn (thông lượng cao), mất tối đa chừng đó dữ liệu khi sập nếu không synchronous.
+struct DurabilityOptions
+{
+    int groupCommitMicros;
+    size_t groupCommitBytes;
+    bool synchronous;        // mỗi thao tác chỉ trả về khi bản ghi của nó đã nằm trên đĩa
+    size_t checkpointBytes;  // tự checkpoint khi log vượt kích thước này (0: chỉ khi gọi checkpoint())
+
+    DurabilityOptions() : groupCommitMicros(2000), groupCommitBytes(1 << 20), synchronous(true), checkpointBytes(64 << 20) {}
+};
+
+// =====================================
+// Class WriteAheadLog
+// =====================================
+// Log chỉ ghi nối. Mỗi bản ghi: độ dài payload (uint32), CRC-32 của (lsn + payload), lsn (uint64), payload.
+// lsn tăng dần và không quay lại khi log bị cắt sau checkpoint. Bản ghi dở dang / hỏng ở cuối tệp (sập giữa
+// lúc ghi) bị bỏ qua và cắt đi khi replay(); bản ghi hỏng còn dữ liệu phía sau thì replay() ném StorageException.
+class WriteAheadLog
+{
+private:
+    int fd;
+    DurabilityOptions options;
+    std::thread flusher;
+    std::mutex mutex;
+    std::condition_variable pendingChanged; // có bản ghi mới / yêu cầu ghi ngay / dừng
+    std::condition_variable durableChanged;
+    string buffer;                          // các bản ghi chưa ghi xuống tệp
+    std::chrono::steady_clock::time_point oldest; // lúc bản ghi đầu tiên của buffer được thêm
+    unsigned long long lastLsn, durableLsn;
+    size_t fileBytes;
+    bool urgent, stopping, writing;
+    string error;                           // lỗi I/O của luồng nền (log ngừng nhận bản ghi)
+
+    void run();
+    void failIfBroken();
+
+    WriteAheadLog(const WriteAheadLog &);
+    WriteAheadLog &operator=(const WriteAheadLog &);
+
+public:
+    WriteAheadLog();
+    ~WriteAheadLog(); // ghi nốt phần còn lại rồi đóng
+
+    // Đọc các bản ghi có lsn > afterLsn theo thứ tự, gọi apply(payload) cho từng bản ghi; cắt phần đuôi hỏng,
+    // ném StorageException nếu một bản ghi hỏng không nằm ở đuôi.
+    // Trả về lsn lớn nhất đã thấy (afterLsn nếu log rỗng).
+    static unsigned long long replay(const string &path, unsigned long long afterLsn,
+                                     const std::function<void(const string &)> &apply, size_t *applied = nullptr);
+
+    void open(const string &path, unsigned long long lastLsn, const DurabilityOptions &options = DurabilityOptions());
+    void close();
+
+    void checkHealthy(); // ném StorageException nếu log chưa mở hoặc luồng nền đã gặp lỗi I/O
+    unsigned long long append(const string &payload); // trả về lsn của bản ghi
+    void waitDurable(unsigned long long lsn);
+    void sync();  // ghi và fsync mọi bản ghi đang chờ ngay lập tức
+    void reset(); // sync() rồi cắt log về rỗng (sau khi checkpoint đã bao gồm mọi bản ghi)
+
+    unsigned long long lsn();
+    size_t size(); // số byte của log (kể cả phần chưa ghi)
+};
+
+// =====================================
+// Class DurableKnowledgeGraph
+// =====================================
+// KnowledgeGraph có lưu bền trong một thư mục: mọi thay đổi được áp dụng rồi ghi vào wal.log; checkpoint()
+// ghi ảnh chụp (checkpoint.dat, kèm lsn) bằng cách ghi tệp tạm, fsync, đổi tên rồi mới cắt log. Khi mở lại:
+// nạp checkpoint rồi chỉ replay phần log sau nó, nên thời gian khởi động tỉ lệ với phần đuôi log.
+// Các thao tác ghi an toàn khi gọi từ nhiều luồng (các luồng chờ fsync chung một nhóm); truy vấn qua graph()
+// không được khóa và không được xen với thao tác ghi.
+// Thao tác ghi kiểm tra log trước khi sửa đồ thị nên log đã hỏng không làm đồ thị lệch khỏi đĩa. Nếu log hỏng
+// đúng lúc đang ghi (StorageException từ append / chờ fsync), thay đổi đã nằm trong bộ nhớ nhưng có thể chưa
+// lên đĩa: khi đó phải bỏ instance và mở lại từ thư mục.
+class DurableKnowledgeGraph
+{
+private:
+    string directory;
+    DurabilityOptions options;
+    KnowledgeGraph graph_;
+    WriteAheadLog log;
+    std::mutex mutex;
+    size_t replayed_;
+
+    string path(const string &file) const { return directory + "/" + file; }
+    void apply(const string &payload);
+    void commit(const string &payload, std::unique_lock<std::mutex> &lock);
+    void checkpointLocked();
+
+public:
+    explicit DurableKnowledgeGraph(const string &directory, const DurabilityOptions &options = DurabilityOptions());
+    ~DurableKnowledgeGraph();
+    static void remove(const string &directory);
+
+    void addEntity(const string &entity);
+    void addRelation(const string &from, const string &to, float weight = 1.0f);
+    void addTriple(const string &subject, const string &predicate, const string &object, float weight = 1.0f);
+    void setPosition(const string &entity, const Point &position);
+
+    void sync();       // chờ mọi thao tác đã thực hiện nằm trên đĩa (cần khi synchronous = false)
+    void checkpoint();
+
+    // chỉ để truy vấn: thay đổi trực tiếp trên đồ thị không được ghi log
+    KnowledgeGraph &graph() { return graph_; }
+    size_t replayed() const { return replayed_; } // số bản ghi log đã replay khi mở
+    size_t logBytes() { return log.size(); }
+};
+
+#endif // WRITEAHEADLOG_H
@@ -7,6 +7,14 @@
 #include <stdexcept>
 #include <cmath>
 #include <vector>
+#include <limits>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <type_traits>
+#include <algorithm>
+#include <queue>
+#include <thread>
 #include "utils.h"
 
 using namespace std;
@@ -28,6 +36,20 @@ public:
     explicit EdgeNotFoundException(const std::string &what_arg) : std::logic_error(what_arg) {}
 };
 
+class NegativeCycleException : public std::logic_error
+{
+public:
+    NegativeCycleException() : std::logic_error("Negative cycle detected!") {}
+    explicit NegativeCycleException(const std::string &what_arg) : std::logic_error(what_arg) {}
+};
+
+class CycleException : public std::logic_error
+{
+public:
+    CycleException() : std::logic_error("Cycle detected!") {}
+    explicit CycleException(const std::string &what_arg) : std::logic_error(what_arg) {}
+};
+
 // =============================================================================
 // KNOWLEDGE GRAPH EXCEPTIONS
 // =============================================================================
@@ -46,4 +68,33 @@ public:
     explicit EntityNotFoundException(const std::string &what_arg) : std::logic_error(what_arg) {}
 };
 
+class PositionNotFoundException : public std::logic_error
+{
+public:
+    PositionNotFoundException() : std::logic_error("Entity has no position!") {}
+    explicit PositionNotFoundException(const std::string &what_arg) : std::logic_error(what_arg) {}
+};
+
+// =============================================================================
+// STORAGE EXCEPTIONS
+// =============================================================================
+
+class StorageException : public std::runtime_error
+{
+public:
+    StorageException() : std::runtime_error("Storage error!") {}
+    explicit StorageException(const std::string &what_arg) : std::runtime_error(what_arg) {}
+};
+
+// =============================================================================
+// EXECUTOR EXCEPTIONS
+// =============================================================================
+
+class QueueFullException : public std::runtime_error
+{
+public:
+    QueueFullException() : std::runtime_error("Queue is full!") {}
+    explicit QueueFullException(const std::string &what_arg) : std::runtime_error(what_arg) {}
+};
+
 #endif // __MAIN_H__
\ No newline at end of file
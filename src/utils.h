@@ -4,6 +4,9 @@
 #include <iostream>
 #include <cmath>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
 
 /**
  * @class Point
@@ -72,4 +75,118 @@ public:
     }
 };
 
+/**
+ * @brief Splits [0, n) into min(threads, n) contiguous ranges and calls fn(begin, end, part)
+ *        for each range on its own std::thread (inline when threads <= 1); returns when all are done.
+ */
+template <class F>
+void parallelFor(int n, int threads, F fn)
+{
+    threads = std::max(1, std::min(threads, n));
+    if (threads == 1){
+        fn(0, n, 0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int part = 0; part < threads; part++){
+        int begin = static_cast<long long>(n) * part / threads;
+        int end = static_cast<long long>(n) * (part + 1) / threads;
+        workers.push_back(std::thread(fn, begin, end, part));
+    }
+    for (auto &worker : workers){
+        worker.join();
+    }
+}
+
+/**
+ * @brief Index of the lowest set bit of a non-zero 64-bit word (number of trailing zeros).
+ *        Uses the compiler builtin where available and a de Bruijn multiply elsewhere.
+ */
+inline int lowestSetBit(unsigned long long word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    static const int index[64] = {
+         0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+        62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+        63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+        46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6};
+    return index[((word & (0 - word)) * 0x03f79d71b4cb0a89ULL) >> 58];
+#endif
+}
+
+/**
+ * @brief 64-bit FNV-1a hash of a byte range. Unlike std::hash its value is fixed by the algorithm,
+ *        so it can be stored in files that are read back by another build or standard library.
+ *        Pass the previous result as @p hash to continue hashing over several ranges.
+ */
+inline unsigned long long fnv1a(const void *data, size_t size, unsigned long long hash = 14695981039346656037ULL)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++){
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief fnv1a() over the characters of a string.
+ */
+inline unsigned long long fnv1a(const std::string &text)
+{
+    return fnv1a(text.data(), text.size());
+}
+
+/**
+ * @brief Appends the raw bytes of a trivially copyable value to a byte buffer
+ *        (host byte order; used by the snapshot and write-ahead log formats).
+ */
+template <class V>
+inline void putBytes(std::string &buffer, const V &value)
+{
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(V));
+}
+
+/**
+ * @brief Appends a length-prefixed (uint32) string to a byte buffer.
+ */
+inline void putString(std::string &buffer, const std::string &text)
+{
+    putBytes(buffer, static_cast<unsigned int>(text.size()));
+    buffer.append(text);
+}
+
+/**
+ * @brief Reads a value written by putBytes at offset and advances offset;
+ *        returns false (offset unchanged) if the buffer is too short.
+ */
+template <class V>
+inline bool getBytes(const std::string &buffer, size_t &offset, V &value)
+{
+    if (buffer.size() < offset + sizeof(V))
+        return false;
+    std::copy(buffer.data() + offset, buffer.data() + offset + sizeof(V), reinterpret_cast<char *>(&value));
+    offset += sizeof(V);
+    return true;
+}
+
+/**
+ * @brief Reads a string written by putString; returns false if the buffer is too short.
+ */
+inline bool getString(const std::string &buffer, size_t &offset, std::string &text)
+{
+    unsigned int length;
+    size_t start = offset;
+    if (!getBytes(buffer, offset, length) || buffer.size() < offset + length)
+    {
+        offset = start;
+        return false;
+    }
+    text.assign(buffer, offset, length);
+    offset += length;
+    return true;
+}
+
 #endif // __UTILS_H__
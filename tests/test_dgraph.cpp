@@ -144,4 +144,575 @@ TEST_CASE("test_007")
     CHECK(e1->toString() == "(V-, O, 2.000000)");
 
     delete e1;
-}
\ No newline at end of file
+}
+TEST_CASE("test_008")
+{
+    DGraphModel<char> model(&charComparator, &vertex2str);
+    char vertices[] = {'A', 'B', 'C', 'D'};
+    for (int idx = 0; idx < 4; idx++)
+    {
+        model.add(vertices[idx]);
+    }
+    model.connect('A', 'B', 1.000000);
+    model.connect('A', 'C', 2.000000);
+    model.connect('B', 'D', 3.000000);
+
+    MemoryUsage usage = model.memoryUsage();
+    CHECK(usage.vertexPayload == 4 * sizeof(char));
+    CHECK(usage.edges == 3 * sizeof(Edge<char>));
+    CHECK(usage.adListUsed == 3 * sizeof(Edge<char> *));
+    CHECK(usage.adListFullUsed == 6 * sizeof(Edge<char> *));
+
+    model.compact();
+    usage = model.memoryUsage();
+    CHECK(usage.slack() == 0);
+    CHECK(usage.total() == usage.vertexPayload + usage.vertexNodes + usage.edges + usage.adListUsed + usage.adListFullUsed + usage.inListUsed + usage.indexes);
+
+    KnowledgeGraph kg;
+    kg.addEntity("a-rather-long-entity-name-that-lives-on-the-heap");
+    kg.addEntity("B");
+    CHECK(kg.memoryUsage().vertexPayload > 2 * sizeof(string));
+}
+
+struct ConstantHash
+{
+    static const bool enabled = true;
+    size_t operator()(const int &) const { return 7; }
+};
+
+TEST_CASE("test_009")
+{
+    DGraphModel<int> pointerModel(&intComparator);
+    DGraphModel<int, NativeVertexPolicy<int> > nativeModel;
+    DGraphModel<int, VertexPolicy<int, NativeEqual<int>, ConstantHash, NoFormat<int> > > collidingModel;
+    for (int v = 1; v <= 4; v++)
+    {
+        pointerModel.add(v);
+        nativeModel.add(v);
+        collidingModel.add(v);
+    }
+    nativeModel.add(2);
+    pointerModel.connect(1, 2, 1.5);
+    nativeModel.connect(1, 2, 1.5);
+    collidingModel.connect(1, 2, 1.5);
+    pointerModel.connect(2, 4);
+    nativeModel.connect(2, 4);
+    collidingModel.connect(2, 4);
+
+    CHECK(nativeModel.size() == 4);
+    CHECK(nativeModel.contains(3));
+    CHECK(nativeModel.contains(5) == false);
+    CHECK(collidingModel.contains(4));
+    CHECK(collidingModel.contains(5) == false);
+    CHECK(nativeModel.toString() == pointerModel.toString());
+    CHECK(nativeModel.BFS(1) == pointerModel.BFS(1));
+    CHECK(collidingModel.DFS(1) == pointerModel.DFS(1));
+    CHECK(sizeof(VertexNode<int, NativeVertexPolicy<int> >) < sizeof(VertexNode<int>));
+}
+
+TEST_CASE("test_010")
+{
+    typedef NativeVertexPolicy<int> IntPolicy;
+    CHECK(sizeof(Edge<int, IntPolicy, Unweighted>) == 2 * sizeof(VertexNode<int, IntPolicy, Unweighted> *));
+    CHECK(sizeof(Edge<int, IntPolicy, Unweighted>) < sizeof(Edge<int, IntPolicy>));
+
+    DGraphModel<int, IntPolicy, Unweighted> topology;
+    topology.add(1);
+    topology.add(2);
+    topology.connect(1, 2, 7.5);
+    CHECK(topology.weight(1, 2) == 1);
+    CHECK(topology.getOutwardEdges(1)[0]->toString() == "(1, 2, 1.000000)");
+
+    DGraphModel<int, IntPolicy, UInt8Weight> small;
+    small.add(1);
+    small.add(2);
+    small.add(3);
+    small.connect(1, 2, 3.4f);
+    small.connect(2, 3, 300);
+    small.connect(3, 1, -5);
+    CHECK(small.weight(1, 2) == 3);
+    CHECK(small.weight(2, 3) == 255);
+    CHECK(small.weight(3, 1) == 0);
+
+    DGraphModel<int, IntPolicy, QuantizedWeight<uint16_t, 100> > scaled;
+    scaled.add(1);
+    scaled.add(2);
+    scaled.connect(1, 2, 2.25f);
+    CHECK(scaled.weight(1, 2) == doctest::Approx(2.25));
+
+    DGraphModel<int, IntPolicy, DoubleWeight> precise;
+    precise.add(1);
+    precise.add(2);
+    precise.connect(1, 2, 0.1);
+    CHECK(precise.weight(1, 2) == 0.1);
+}
+
+TEST_CASE("test_011")
+{
+    DGraphModel<int> dense;
+    for (int v = 0; v < 2000; v++)
+    {
+        dense.add(v);
+    }
+    for (int v = 0; v + 1 < 2000; v++)
+    {
+        dense.connect(v, v + 1);
+    }
+    CHECK(dense.denseIndexed());
+    CHECK(dense.contains(1999));
+    CHECK(dense.contains(2000) == false);
+    CHECK(dense.contains(-1) == false);
+    CHECK(dense.outDegree(1998) == 1);
+
+    DGraphModel<int, NativeVertexPolicy<int> > sparse;
+    sparse.add(5);
+    sparse.add(-3);
+    CHECK(sparse.denseIndexed());
+    sparse.add(1000000000);
+    sparse.add(-1000000000);
+    CHECK(sparse.denseIndexed() == false);
+    CHECK(sparse.contains(1000000000));
+    CHECK(sparse.contains(-3));
+    CHECK(sparse.contains(4) == false);
+    for (int v = -2; v < 3000; v++)
+    {
+        sparse.add(v);
+    }
+    CHECK(sparse.contains(-1000000000));
+    CHECK(sparse.contains(2999));
+    CHECK(sparse.size() == 3005);
+
+    DGraphModel<char> letters;
+    letters.add('z');
+    letters.add('a');
+    letters.add('m');
+    letters.connect('z', 'a');
+    letters.connect('a', 'm');
+    CHECK(letters.denseIndexed());
+    CHECK(letters.contains('m'));
+    CHECK(letters.contains('b') == false);
+    CHECK(letters.BFS('z') == "[(z, 0, 1, [(z, a, 0.000000)]), (a, 1, 1, [(z, a, 0.000000), (a, m, 0.000000)]), (m, 1, 0, [(a, m, 0.000000)])]");
+
+    DGraphModel<int> custom(&intComparator);
+    custom.add(1);
+    CHECK(custom.denseIndexed() == false);
+    CHECK(custom.contains(1));
+}
+
+TEST_CASE("test_012")
+{
+    DGraphModel<char> model(&charComparator, &vertex2str);
+    char vertices[] = {'A', 'B', 'C'};
+    for (int idx = 0; idx < 3; idx++)
+    {
+        model.add(vertices[idx]);
+    }
+    model.connect('A', 'B', 1.000000);
+    model.connect('A', 'C', 2.000000);
+
+    ArrayView<Edge<char> *> view = model.getOutwardEdges('A');
+    CHECK(view.size() == 2);
+    CHECK(view.begin() == model.getVertexNode('A')->getAdList().begin());
+    CHECK(view[1]->toString() == "(A, C, 2.000000)");
+    CHECK(model.getOutwardEdges('C').empty());
+
+    vector<Edge<char> *> copy = view;
+    CHECK(copy.size() == 2);
+    CHECK(copy[0] == view[0]);
+
+    KnowledgeGraph kg;
+    kg.addEntity("X");
+    kg.addEntity("Y");
+    kg.addRelation("X", "Y");
+    CHECK(&kg.getAllEntities() == &kg.getAllEntities());
+    CHECK(kg.getNeighbors("X") == vector<string>{"Y"});
+    CHECK_THROWS_AS(kg.getNeighbors("Z"), EntityNotFoundException);
+}
+
+TEST_CASE("test_013")
+{
+    DGraphModel<char> model(&charComparator, &vertex2str);
+    model.add('A');
+    model.add('B');
+    model.connect('A', 'B', 1, 1);
+    model.connect('A', 'B', 2, 2);
+    model.connect('A', 'B', 3);
+    model.connect('A', 'B', 4, 1);
+
+    CHECK(model.outDegree('A') == 3);
+    CHECK(model.getOutwardEdges('A', 1).size() == 1);
+    CHECK(model.getOutwardEdges('A', 1)[0]->getWeight() == 4);
+    CHECK(model.connected('A', 'B', 2));
+    CHECK(model.connected('A', 'B', 3) == false);
+
+    model.disconnect('A', 'B', 2);
+    CHECK(model.connected('A', 'B', 2) == false);
+    CHECK(model.connected('A', 'B'));
+    CHECK(model.inDegree('B') == 2);
+
+    model.disconnect('A', 'B');
+    CHECK(model.connected('A', 'B') == false);
+    CHECK(model.toString() == "[(A, 0, 0, []), (B, 0, 0, [])]");
+}
+
+TEST_CASE("test_014")
+{
+    // lưới 10x10 (id = y * 10 + x), cạnh 4 hướng hai chiều trọng số 1, bức tường ở x = 5 có một khe tại y = 8
+    DGraphModel<int, NativeVertexPolicy<int>, DoubleWeight> model;
+    vector<Point> coords;
+    for (int id = 0; id < 100; id++)
+    {
+        model.add(id);
+        coords.push_back(Point(id % 10, id / 10));
+    }
+    for (int y = 0; y < 10; y++)
+    {
+        for (int x = 0; x < 10; x++)
+        {
+            int id = y * 10 + x;
+            bool wall = (x == 4 && y != 8);
+            if (x < 9 && !wall)
+            {
+                model.connect(id, id + 1, 1);
+                model.connect(id + 1, id, 1);
+            }
+            if (y < 9)
+            {
+                model.connect(id, id + 10, 1);
+                model.connect(id + 10, id, 1);
+            }
+        }
+    }
+    auto position = [&coords](const int &vertex) -> const Point * { return &coords[vertex]; };
+    auto unknown = [](const int &) -> const Point * { return nullptr; };
+
+    PathResult<int, double> optimal = model.shortestPath(0, 9);
+    PathResult<int, double> astar = model.astarPath(0, 9, position);
+    PathResult<int, double> blind = model.astarPath(0, 9, unknown); // h = 0: Dijkstra
+    CHECK(optimal.distance == 25);
+    CHECK(astar.found);
+    CHECK(astar.distance == 25);
+    CHECK(astar.path.front() == 0);
+    CHECK(astar.path.back() == 9);
+    CHECK(astar.path.size() == 26);
+    CHECK(blind.distance == 25);
+    CHECK(astar.expanded < blind.expanded);
+
+    PathResult<int, double> greedy = model.astarPath(0, 9, position, 3.0);
+    CHECK(greedy.found);
+    CHECK(greedy.distance <= 3 * optimal.distance);
+    CHECK(greedy.expanded <= astar.expanded);
+
+    PathResult<int, double> open = model.astarPath(12, 15, position);
+    CHECK(open.distance == 17);
+    CHECK(open.distance == model.shortestPath(12, 15).distance);
+    CHECK(model.astarPath(33, 33, position).path == vector<int>{33});
+
+    model.add(100);
+    coords.push_back(Point(20, 20));
+    CHECK(model.astarPath(0, 100, position).found == false);
+    CHECK_THROWS_AS(model.astarPath(0, 101, position), VertexNotFoundException);
+
+    KnowledgeGraph kg;
+    kg.addEntity("Depot");
+    kg.addEntity("Hub");
+    kg.addEntity("Shop");
+    kg.addEntity("Detour");
+    kg.setPosition("Depot", Point(0, 0));
+    kg.setPosition("Hub", Point(3, 4));
+    kg.setPosition("Shop", Point(6, 8));
+    kg.addRelation("Depot", "Hub", 5);
+    kg.addRelation("Hub", "Shop", 5);
+    kg.addRelation("Depot", "Detour", 1);
+    kg.addRelation("Detour", "Shop", 12);
+    PathResult<string, double> route = kg.astarPath("Depot", "Shop");
+    CHECK(route.distance == 10);
+    CHECK(route.path == vector<string>{"Depot", "Hub", "Shop"});
+}
+
+TEST_CASE("test_015")
+{
+    DGraphModel<char> model(&charComparator, &vertex2str);
+    for (char c = 'A'; c <= 'H'; c++)
+    {
+        model.add(c);
+    }
+    // {A, B, C} -> {D, E} -> F, G tự vòng, H cô lập
+    model.connect('A', 'B', 1);
+    model.connect('B', 'C', 1);
+    model.connect('C', 'A', 1);
+    model.connect('C', 'D', 4);
+    model.connect('B', 'E', 2);
+    model.connect('D', 'E', 1);
+    model.connect('E', 'D', 1);
+    model.connect('E', 'F', 1);
+    model.connect('G', 'G', 1);
+    model.connect('G', 'A', 3);
+
+    ComponentLabels labels = model.componentLabels();
+    CHECK(labels.count == 5);
+    CHECK(labels.component[0] == labels.component[2]);
+    CHECK(labels.component[3] == labels.component[4]);
+    CHECK(labels.component[0] != labels.component[3]);
+    vector<vector<char> > components = model.stronglyConnectedComponents();
+    CHECK(components == vector<vector<char> >{{'H'}, {'G'}, {'A', 'B', 'C'}, {'D', 'E'}, {'F'}});
+
+    DGraphModel<int, NativeVertexPolicy<int> > dag;
+    model.condensation(labels, dag);
+    CHECK(dag.size() == 5);
+    CHECK(dag.toString() == "[(0, 0, 0, []), (1, 0, 1, [(1, 2, 3.000000)]), (2, 1, 1, [(1, 2, 3.000000), (2, 3, 2.000000)]), "
+                            "(3, 1, 1, [(2, 3, 2.000000), (3, 4, 1.000000)]), (4, 1, 0, [(3, 4, 1.000000)])]");
+    DGraphModel<int, NativeVertexPolicy<int> > parallel;
+    model.condensation(labels, parallel, 3);
+    CHECK(parallel.toString() == dag.toString());
+
+    // chuỗi rất dài với một cạnh quay lại: đệ quy sẽ tràn stack
+    DGraphModel<int, NativeVertexPolicy<int>, Unweighted> chain;
+    const int length = 200000;
+    for (int i = 0; i < length; i++)
+    {
+        chain.add(i);
+    }
+    for (int i = 0; i + 1 < length; i++)
+    {
+        chain.connect(i, i + 1);
+    }
+    chain.connect(length - 1, length / 2);
+    ComponentLabels chainLabels = chain.componentLabels();
+    CHECK(chainLabels.count == length / 2 + 1);
+    CHECK(chainLabels.component[0] == 0);
+    CHECK(chainLabels.component[length / 2 - 1] == length / 2 - 1);
+    CHECK(chainLabels.component[length - 1] == length / 2);
+    DGraphModel<int, NativeVertexPolicy<int>, Unweighted> chainDag;
+    chain.condensation(chainLabels, chainDag, 4);
+    CHECK(chainDag.size() == length / 2 + 1);
+    CHECK(chainDag.outDegree(length / 2 - 1) == 1);
+    CHECK(chainDag.outDegree(length / 2) == 0);
+
+    KnowledgeGraph kg;
+    kg.addEntity("Animal");
+    kg.addEntity("Mammal");
+    kg.addEntity("Dog");
+    kg.addTriple("Dog", "isA", "Mammal");
+    kg.addTriple("Mammal", "isA", "Animal");
+    kg.addTriple("Animal", "isA", "Mammal"); // chu trình lỗi trong ontology
+    kg.addRelation("Animal", "Dog");
+    CHECK(kg.stronglyConnectedComponents().size() == 1);
+    CHECK(kg.stronglyConnectedComponents("isA") == vector<vector<string> >{{"Dog"}, {"Animal", "Mammal"}});
+}
+
+TEST_CASE("test_016")
+{
+    // đồ thị nạp theo thứ tự "lộn xộn": các đỉnh kề nhau nằm xa nhau trong thứ tự thêm
+    const ReorderStrategy strategies[] = {REORDER_BFS, REORDER_RCM, REORDER_DEGREE, REORDER_GORDER};
+    for (ReorderStrategy strategy : strategies)
+    {
+        DGraphModel<char> model(&charComparator, &vertex2str);
+        const string order = "HCFAGBDE";
+        for (char c : order)
+        {
+            model.add(c);
+        }
+        model.connect('A', 'B', 1, 1);
+        model.connect('A', 'C', 4);
+        model.connect('B', 'C', 2, 1);
+        model.connect('C', 'D', 1);
+        model.connect('D', 'A', 3, 2);
+        model.connect('D', 'E', 1);
+        model.connect('E', 'F', 2, 1);
+        model.connect('G', 'E', 5);
+        model.connect('B', 'H', 1);
+
+        string text = model.toString();
+        vector<char> vertices = model.vertices();
+        string bfs = model.BFS('A'), dfs = model.DFS('G'), back = model.reverseBFS('F', 1);
+        vector<pair<char, double> > distances = model.shortestDistances('A');
+        vector<vector<char> > components = model.stronglyConnectedComponents();
+        vector<char> cycle = model.findCycle();
+
+        model.reorder(strategy);
+        CHECK(model.toString() == text);
+        CHECK(model.vertices() == vertices);
+        CHECK(model.BFS('A') == bfs);
+        CHECK(model.DFS('G') == dfs);
+        CHECK(model.reverseBFS('F', 1) == back);
+        CHECK(model.shortestDistances('A') == distances);
+        CHECK(model.shortestPath('G', 'H').found == false);
+        CHECK(model.shortestPath('A', 'F').distance == 7);
+        CHECK(model.stronglyConnectedComponents() == components);
+        CHECK(model.findCycle() == cycle);
+        CHECK(model.connected('D', 'A', 2));
+        CHECK(model.connected('D', 'A', 1) == false);
+        CHECK(model.weight('G', 'E') == 5);
+
+        // id mới là một hoán vị; vertexAt / insertionOrder nối hai cách đánh số
+        vector<bool> seen(order.size(), false);
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            int id = model.insertionOrder()[i];
+            CHECK(model.getVertexNode(order[i])->getId() == id);
+            CHECK(model.vertexAt(id) == order[i]);
+            seen[id] = true;
+        }
+        CHECK(std::find(seen.begin(), seen.end(), false) == seen.end());
+
+        // đồ thị vẫn sửa được bình thường sau khi sắp lại
+        model.add('I');
+        model.connect('H', 'I', 1);
+        model.disconnect('A', 'C');
+        CHECK(model.vertexAt(8) == 'I');
+        CHECK(model.shortestPath('A', 'I').distance == 3);
+        CHECK(model.toString().find("(I, 1, 0, [(H, I, 1.000000)])") != string::npos);
+    }
+
+    // RCM đặt các đỉnh của một chuỗi nạp ngẫu nhiên thành các id liên tiếp
+    DGraphModel<int, NativeVertexPolicy<int>, Unweighted> chain;
+    const int length = 1000;
+    for (int i = 0; i < length; i++)
+    {
+        chain.add((i * 7919) % length);
+    }
+    for (int i = 0; i + 1 < length; i++)
+    {
+        chain.connect(i, i + 1);
+    }
+    chain.reorder(REORDER_RCM);
+    int jumps = 0;
+    for (int i = 0; i + 1 < length; i++)
+    {
+        jumps += std::abs(chain.getVertexNode(i)->getId() - chain.getVertexNode(i + 1)->getId()) != 1;
+    }
+    CHECK(jumps == 0);
+
+    // chế độ không chu trình vẫn đúng với id mới
+    DGraphModel<char> dag(&charComparator, &vertex2str);
+    for (char c : string("DCBA"))
+    {
+        dag.add(c);
+    }
+    dag.enforceAcyclic(true);
+    dag.connect('A', 'B');
+    dag.connect('B', 'C');
+    dag.reorder(REORDER_DEGREE);
+    dag.connect('C', 'D');
+    CHECK_THROWS_AS(dag.connect('D', 'A'), CycleException);
+    CHECK(dag.topologicalSort() == vector<char>{'A', 'B', 'C', 'D'});
+
+    KnowledgeGraph kg;
+    for (string entity : {"Dog", "Animal", "Cat", "Mammal", "Pet"})
+    {
+        kg.addEntity(entity);
+    }
+    kg.addRelation("Animal", "Mammal", 1);
+    kg.addRelation("Mammal", "Dog", 1);
+    kg.addRelation("Mammal", "Cat", 2);
+    kg.addRelation("Pet", "Dog", 1);
+    kg.addRelation("Pet", "Cat", 1);
+    kg.setPosition("Dog", Point(1, 0, 0));
+    kg.setPosition("Cat", Point(2, 0, 0));
+    string ancestor = kg.findCommonAncestors("Dog", "Cat");
+    vector<double> ranks = kg.pageRank();
+    vector<string> entities = kg.getAllEntities();
+    kg.reorder(REORDER_GORDER);
+    CHECK(kg.getAllEntities() == entities);
+    CHECK(kg.findCommonAncestors("Dog", "Cat") == ancestor);
+    vector<double> reordered = kg.pageRank();
+    REQUIRE(reordered.size() == ranks.size());
+    for (size_t i = 0; i < ranks.size(); i++)
+    {
+        CHECK(reordered[i] == doctest::Approx(ranks[i]));
+    }
+    CHECK(kg.nearestEntities(Point(0, 0, 0), 1) == vector<string>{"Dog"});
+    CHECK(kg.getPosition("Cat").getX() == 2);
+    CHECK(kg.similarity("Dog", "Cat", JACCARD) == 1);
+}
+
+TEST_CASE("test_017")
+{
+    DGraphModel<char> model(&charComparator, &vertex2str);
+    for (char c : string("ABCDE"))
+    {
+        model.add(c);
+    }
+    model.connect('A', 'D', 2.5);
+    model.connect('A', 'B', 1);
+    model.connect('A', 'C', 2.5, 1);
+    model.connect('D', 'A', 4);
+    model.connect('E', 'A', 1, 1);
+    model.connect('E', 'B', 1);
+
+    CompressedAdjacency out = model.compress();
+    CHECK(out.vertexCount() == 5);
+    CHECK(out.edgeCount() == 6);
+    CHECK(out.neighbors(0) == vector<int>{1, 2, 3}); // đích đã sắp theo id
+    CHECK(out.neighbors(3) == vector<int>{0});
+    CHECK(out.degree(2) == 0);
+    CHECK(out.maxWeightError() == 0); // 3 giá trị khác nhau: từ điển, không mất mát
+    vector<pair<int, double> > edges;
+    out.forEach(0, [&edges](int target, double weight) { edges.push_back(make_pair(target, weight)); });
+    CHECK(edges == vector<pair<int, double> >{{1, 1}, {2, 2.5}, {3, 2.5}});
+
+    CompressedAdjacency in = model.compress(WEIGHT_FLOAT, PredicateTable::ANY, true);
+    CHECK(in.neighbors(0) == vector<int>{3, 4});
+    CHECK(in.neighbors(1) == vector<int>{0, 4});
+    CompressedAdjacency labelled = model.compress(WEIGHT_NONE, 1);
+    CHECK(labelled.edgeCount() == 2);
+    CHECK(labelled.neighbors(4) == vector<int>{0});
+    labelled.forEach(0, [](int, double weight) { CHECK(weight == 1); });
+
+    CompressedAdjacency fromSnapshot;
+    fromSnapshot.build(model.snapshot(), WEIGHT_FLOAT, true);
+    for (int v = 0; v < 5; v++)
+    {
+        CHECK(fromSnapshot.neighbors(v) == in.neighbors(v));
+    }
+
+    // đồ thị kiểu tri thức: cụm thực thể liên kết dày bên trong, vài liên kết ra ngoài, nhiều giá trị trọng số
+    const int n = 20000;
+    DGraphModel<int, NativeVertexPolicy<int> > graph;
+    for (int i = 0; i < n; i++)
+    {
+        graph.add((i * 7919) % n); // thứ tự nạp xáo trộn
+    }
+    unsigned int seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1103515245u + 12345u;
+        return static_cast<int>((seed >> 8) % 1000000);
+    };
+    for (int v = 0; v < n; v++)
+    {
+        int cluster = v / 50 * 50;
+        for (int k = 0; k < 8; k++)
+        {
+            graph.connect(v, cluster + next() % 50, 0.5 + next() % 1000 / 100.0);
+        }
+        graph.connect(v, next() % n, 1);
+    }
+    graph.reorder(REORDER_GORDER);
+    CompressedAdjacency compact = graph.compress();
+    AdjacencySnapshot<float> csr = graph.snapshot();
+    CHECK(compact.edgeCount() == static_cast<unsigned long long>(csr.edgeCount()));
+    CHECK(compact.bytesPerEdge() < 4);
+    CHECK(compact.maxWeightError() < 0.02);
+    int source = graph.getVertexNode(0)->getId();
+    vector<int> hops = compact.hops(source, 3);
+    vector<vector<pair<int, int> > > expected = multiSourceBFS(csr, vector<int>(1, source), 3);
+    size_t reached = 0; // multiSourceBFS không trả về chính source
+    for (int v = 0; v < n; v++)
+    {
+        reached += hops[v] >= 0;
+    }
+    CHECK(reached == expected[0].size() + 1);
+    for (const pair<int, int> &hit : expected[0])
+    {
+        CHECK(hops[hit.first] == hit.second);
+    }
+    compact.forEach(source, [&](int target, double weight) {
+        bool close = false;
+        for (auto edge : graph.getOutwardEdges(0))
+        {
+            close = close || (edge->getTo()->getId() == target && std::abs(weight - edge->getWeight()) <= compact.maxWeightError() + 1e-6);
+        }
+        CHECK(close);
+    });
+}
@@ -1,5 +1,13 @@
 #include "doctest/doctest.h"
 #include "src/KnowledgeGraph.h"
+#include "src/MappedGraph.h"
+#include "src/WriteAheadLog.h"
+#include "src/ShardedGraph.h"
+#include "src/QueryExecutor.h"
+#include <fstream>
+#include <map>
+#include <sys/stat.h>
+#include <set>
 #include "helper.h"
 
 // =============================================================================
@@ -81,4 +89,1370 @@ TEST_CASE("test_157")
     kg.addRelation("G", "F");
 
     CHECK(kg.findCommonAncestors("A", "B") == "G");
-}
\ No newline at end of file
+}
+TEST_CASE("test_158")
+{
+    KnowledgeGraph kg;
+
+    const char *names[6] = {"Cat", "Mammal", "Animal", "Paw", "Zoo", "City"};
+    for (int i = 0; i < 6; i++)
+    {
+        kg.addEntity(names[i]);
+    }
+
+    kg.addTriple("Cat", "isA", "Mammal");
+    kg.addTriple("Mammal", "isA", "Animal");
+    kg.addTriple("Paw", "partOf", "Cat");
+    kg.addTriple("Cat", "locatedIn", "Zoo");
+    kg.addTriple("Zoo", "locatedIn", "City");
+    kg.addTriple("Cat", "partOf", "Mammal", 3);
+    kg.addRelation("Cat", "Zoo", 5);
+
+    CHECK(kg.getNeighbors("Cat") == vector<string>{"Mammal", "Zoo", "Mammal", "Zoo"});
+    CHECK(kg.getNeighbors("Cat", "isA") == vector<string>{"Mammal"});
+    CHECK(kg.getNeighbors("Cat", "partOf") == vector<string>{"Mammal"});
+    CHECK(kg.getNeighbors("Cat", "unknown").empty());
+
+    CHECK(kg.isReachable("Cat", "Animal", "isA"));
+    CHECK(kg.isReachable("Cat", "City", "isA") == false);
+    CHECK(kg.isReachable("Cat", "City", "locatedIn"));
+    CHECK(kg.isReachable("Paw", "Animal"));
+    CHECK(kg.isReachable("Paw", "Animal", "partOf") == false);
+
+    CHECK(kg.getRelatedEntities("Cat", 2, "isA") == vector<string>{"Mammal", "Animal"});
+    CHECK(kg.getRelatedEntities("Cat", 1) == vector<string>{"Mammal", "Zoo"});
+    CHECK(kg.toString() == "[(Cat, 1, 4, [(Cat, Mammal, 1.000000), (Paw, Cat, 1.000000), (Cat, Zoo, 1.000000), (Cat, Mammal, 3.000000), (Cat, Zoo, 5.000000)]), (Mammal, 2, 1, [(Cat, Mammal, 1.000000), (Mammal, Animal, 1.000000), (Cat, Mammal, 3.000000)]), (Animal, 1, 0, [(Mammal, Animal, 1.000000)]), (Paw, 0, 1, [(Paw, Cat, 1.000000)]), (Zoo, 2, 1, [(Cat, Zoo, 1.000000), (Zoo, City, 1.000000), (Cat, Zoo, 5.000000)]), (City, 1, 0, [(Zoo, City, 1.000000)])]");
+}
+
+TEST_CASE("test_159")
+{
+    KnowledgeGraph kg;
+
+    const char *names[6] = {"A", "B", "C", "D", "E", "F"};
+    for (int i = 0; i < 6; i++)
+    {
+        kg.addEntity(names[i]);
+    }
+
+    kg.addRelation("A", "C");
+    kg.addRelation("B", "C");
+    kg.addRelation("C", "D");
+    kg.addRelation("D", "E");
+    kg.addTriple("F", "isA", "D");
+    kg.addRelation("E", "A");
+
+    CHECK(kg.getPredecessors("C") == vector<string>{"A", "B"});
+    CHECK(kg.getPredecessors("D") == vector<string>{"C", "F"});
+    CHECK(kg.getPredecessors("D", "isA") == vector<string>{"F"});
+    CHECK(kg.getPredecessors("F").empty());
+
+    CHECK(kg.getAncestors("D", 1) == vector<string>{"C", "F"});
+    CHECK(kg.getAncestors("D") == vector<string>{"C", "F", "A", "B"});
+    CHECK(kg.getAncestors("D", 5, "isA") == vector<string>{"F"});
+    CHECK(kg.getAncestors("A", 10) == vector<string>{"E", "D", "C", "F", "B"});
+
+    kg.addRelation("C", "D", 7);
+    CHECK(kg.getPredecessors("D") == vector<string>{"C", "F"});
+
+    DGraphModel<char> model(&charComparator, &vertex2str);
+    model.add('X');
+    model.add('Y');
+    model.add('Z');
+    model.connect('X', 'Z');
+    model.connect('Y', 'Z');
+    model.connect('X', 'Y');
+    CHECK(model.reverseBFS('Z') == "[Z, X, Y]");
+    CHECK(model.reverseDFS('Z') == "[Z, X, Y]");
+    CHECK(model.getInwardEdges('Z').size() == 2);
+    model.disconnect('X', 'Z');
+    CHECK(model.getPredecessors('Z') == vector<char>{'Y'});
+    CHECK(model.reverseBFS('Z') == "[Z, Y, X]");
+}
+
+TEST_CASE("test_160")
+{
+    KnowledgeGraph kg;
+
+    const char *names[6] = {"A", "B", "C", "D", "E", "F"};
+    for (int i = 0; i < 6; i++)
+    {
+        kg.addEntity(names[i]);
+    }
+
+    kg.addRelation("A", "B", 4);
+    kg.addRelation("A", "C", 1);
+    kg.addRelation("C", "B", 2);
+    kg.addRelation("B", "D", 5);
+    kg.addRelation("C", "D", 8);
+
+    PathResult<string, double> path = kg.shortestPath("A", "D");
+    CHECK(path.found);
+    CHECK(path.distance == 8);
+    CHECK(path.path == vector<string>{"A", "C", "B", "D"});
+    CHECK(kg.shortestPath("D", "A").found == false);
+    CHECK(kg.shortestPath("E", "E").path == vector<string>{"E"});
+
+    kg.addRelation("D", "E", 1);
+    kg.addRelation("C", "E", -3);
+    path = kg.shortestPath("A", "E");
+    CHECK(path.distance == -2);
+    CHECK(path.path == vector<string>{"A", "C", "E"});
+    CHECK(kg.shortestDistances("C") == vector<pair<string, double> >{{"B", 2}, {"C", 0}, {"D", 7}, {"E", -3}});
+
+    kg.addRelation("E", "F", 1);
+    kg.addRelation("F", "C", 1);
+    CHECK_THROWS_AS(kg.shortestPath("A", "B"), NegativeCycleException);
+    string message;
+    try
+    {
+        kg.shortestDistances("A");
+    }
+    catch (const NegativeCycleException &e)
+    {
+        message = e.what();
+    }
+    CHECK(message == "Negative cycle: C -> E -> F -> C");
+
+    // findCommonAncestors không ném khi có chu trình âm: các thực thể vòng qua chu trình bị bỏ qua
+    KnowledgeGraph cyclic;
+    for (string name : {"X", "A", "B", "C", "Y", "Z"})
+        cyclic.addEntity(name);
+    cyclic.addRelation("X", "A", 1);
+    cyclic.addRelation("X", "B", 1);
+    cyclic.addRelation("C", "A", 1);
+    cyclic.addRelation("C", "Y", -1);
+    cyclic.addRelation("Y", "C", -1);
+    CHECK(cyclic.findCommonAncestors("A", "B") == "X");
+    cyclic.addRelation("C", "B", 1);
+    cyclic.addRelation("Z", "C", 5);
+    CHECK(cyclic.findCommonAncestors("A", "B") == "X");
+
+    DGraphModel<int, NativeVertexPolicy<int> > model;
+    for (int v = 0; v < 5; v++)
+        model.add(v);
+    model.connect(0, 1, 2);
+    model.connect(1, 2, -1);
+    model.connect(2, 1, -1);
+    model.connect(3, 4, 4);
+    vector<double> fromZero = model.finiteDistanceTable(0);
+    CHECK(fromZero[0] == 0);
+    CHECK(fromZero[1] == model.unreachable());
+    CHECK(fromZero[2] == model.unreachable());
+    CHECK(fromZero[4] == model.unreachable());
+    CHECK(model.finiteDistanceTable(4, PredicateTable::ANY, true)[3] == 4);
+}
+
+TEST_CASE("test_161")
+{
+    KnowledgeGraph kg;
+
+    // lưới 4x4, cạnh hai chiều với trọng số khác nhau, thêm vài cạnh một chiều
+    for (int i = 0; i < 16; i++)
+    {
+        kg.addEntity("N" + to_string(i));
+    }
+    for (int r = 0; r < 4; r++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int id = r * 4 + c;
+            if (c < 3)
+            {
+                kg.addRelation("N" + to_string(id), "N" + to_string(id + 1), 1 + (id % 3));
+                kg.addRelation("N" + to_string(id + 1), "N" + to_string(id), 2);
+            }
+            if (r < 3)
+            {
+                kg.addRelation("N" + to_string(id), "N" + to_string(id + 4), 1 + (id % 2));
+            }
+        }
+    }
+    kg.addEntity("Isolated");
+
+    CHECK(kg.hasLandmarks() == false);
+    for (int mode = 0; mode < 2; mode++)
+    {
+        for (int s = 0; s < 16; s++)
+        {
+            for (int t = 0; t < 16; t++)
+            {
+                string from = "N" + to_string(s), to = "N" + to_string(t);
+                PathResult<string, double> expected = kg.shortestPath(from, to);
+                PathResult<string, double> actual = kg.findPath(from, to);
+                CHECK(actual.found == expected.found);
+                CHECK(actual.distance == expected.distance);
+                if (actual.found)
+                {
+                    CHECK(actual.path.front() == from);
+                    CHECK(actual.path.back() == to);
+                }
+            }
+        }
+        CHECK(kg.findPath("N0", "Isolated").found == false);
+        kg.buildLandmarks(3);
+        CHECK(kg.hasLandmarks());
+    }
+
+    // bảng landmark lưu ra rồi nạp lại; bảng cũ (sau khi thêm quan hệ) không được nạp
+    stringstream saved;
+    kg.saveLandmarks(saved);
+    string text = saved.str();
+    CHECK(text.substr(0, 18) == "landmarks 3 17 36 ");
+    stringstream reload(text);
+    CHECK(kg.loadLandmarks(reload));
+    CHECK(kg.findPath("N0", "N15").distance == kg.shortestPath("N0", "N15").distance);
+    stringstream broken("landmarks 3 x");
+    CHECK(kg.loadLandmarks(broken) == false);
+    CHECK(kg.hasLandmarks() == false);
+
+    kg.addRelation("N15", "N0", 1);
+    stringstream stale(text);
+    CHECK(kg.loadLandmarks(stale) == false);
+    CHECK(kg.findPath("N15", "N3").path == vector<string>{"N15", "N0", "N1", "N2", "N3"});
+
+    // đồ thị khác cùng số đỉnh, số cạnh: dấu vân tay không khớp
+    KnowledgeGraph other;
+    for (int i = 0; i < 17; i++)
+    {
+        other.addEntity("N" + to_string(i));
+    }
+    for (int i = 0; i < 36; i++)
+    {
+        other.addRelation("N" + to_string(i % 17), "N" + to_string((i + 1 + i / 17) % 17), 1);
+    }
+    stringstream foreign(text);
+    CHECK(other.loadLandmarks(foreign) == false);
+    CHECK(other.hasLandmarks() == false);
+
+    // đổi trọng số qua Edge::setWeight() sau khi tính bảng cũng làm bảng hết khớp
+    DGraphModel<int, NativeVertexPolicy<int> > chain;
+    for (int v = 0; v < 3; v++)
+        chain.add(v);
+    chain.connect(0, 1, 1);
+    chain.connect(1, 2, 1);
+    LandmarkTable<double> table = chain.buildLandmarks(2);
+    CHECK(chain.landmarksMatch(table));
+    stringstream chainText;
+    table.save(chainText);
+    chain.getOutwardEdges(1)[0]->setWeight(4);
+    CHECK(chain.landmarksMatch(table) == false);
+    CHECK(chain.bindLandmarks(table) == false);
+    CHECK(chain.landmarkPath(0, 2, table).distance == 5);
+    chain.getOutwardEdges(1)[0]->setWeight(1);
+    LandmarkTable<double> reloaded;
+    CHECK(reloaded.load(chainText));
+    CHECK(chain.landmarksMatch(reloaded) == false);
+    CHECK(chain.bindLandmarks(reloaded));
+    CHECK(chain.landmarkPath(0, 2, reloaded).distance == 2);
+
+    // cạnh âm nằm ngoài biên của Dijkstra lúc đích đã được chốt
+    KnowledgeGraph negative;
+    negative.addEntity("A");
+    negative.addEntity("T");
+    negative.addEntity("B");
+    negative.addRelation("A", "T", 1);
+    negative.addRelation("A", "B", 2);
+    negative.addRelation("B", "T", -5);
+    CHECK(negative.shortestPath("A", "T").distance == -3);
+    CHECK(negative.findPath("A", "T").path == vector<string>{"A", "B", "T"});
+
+    // chỉ trọng số âm thực sự được lưu mới chuyển các truy vấn sang SPFA
+    DGraphModel<int, NativeVertexPolicy<int>, Unweighted> hops;
+    DGraphModel<int, NativeVertexPolicy<int>, UInt8Weight> quantized;
+    DGraphModel<int, NativeVertexPolicy<int> > plain;
+    for (int v = 0; v < 2; v++)
+    {
+        hops.add(v);
+        quantized.add(v);
+        plain.add(v);
+    }
+    hops.connect(0, 1, -2);
+    quantized.connect(0, 1, -2);
+    plain.connect(0, 1, -2);
+    CHECK(hops.hasNegativeWeights() == false);
+    CHECK(quantized.hasNegativeWeights() == false);
+    CHECK(plain.hasNegativeWeights() == true);
+    CHECK(quantized.shortestPath(0, 1).distance == 0);
+
+    // trọng số âm đặt trực tiếp qua Edge::setWeight() cũng tắt việc dừng sớm ở đích
+    DGraphModel<int, NativeVertexPolicy<int> > direct;
+    for (int v = 0; v < 3; v++)
+        direct.add(v);
+    direct.connect(0, 1, 1);
+    direct.connect(0, 2, 2);
+    direct.connect(2, 1, 1);
+    CHECK(direct.shortestPath(0, 1).distance == 1);
+    direct.getOutwardEdges(2)[0]->setWeight(-5);
+    CHECK(direct.hasNegativeWeights() == true);
+    CHECK(direct.shortestPath(0, 1).distance == -3);
+    CHECK(direct.bidirectionalPath(0, 1).distance == -3);
+    CHECK(direct.withinDistance(0, -1).size() == 1);
+}
+
+TEST_CASE("test_162")
+{
+    KnowledgeGraph kg;
+
+    kg.addEntity("Hanoi");
+    kg.addEntity("HCMC");
+    kg.addEntity("DaNang");
+    kg.addEntity("Hue");
+    kg.addEntity("Warehouse");
+    kg.setPosition("Hanoi", Point(0, 10));
+    kg.setPosition("HCMC", Point(2, -10));
+    kg.setPosition("DaNang", Point(3, 2));
+    kg.setPosition("Hue", Point(2, 3));
+    kg.addRelation("Hanoi", "Hue");
+    kg.addRelation("Hue", "DaNang");
+    kg.addRelation("DaNang", "HCMC");
+    kg.addRelation("DaNang", "Warehouse");
+
+    CHECK(kg.hasPosition("Hue"));
+    CHECK(kg.hasPosition("Warehouse") == false);
+    CHECK(kg.getPosition("DaNang") == Point(3, 2));
+    CHECK_THROWS_AS(kg.getPosition("Warehouse"), PositionNotFoundException);
+    CHECK_THROWS_AS(kg.setPosition("Hoian", Point()), EntityNotFoundException);
+
+    CHECK(kg.nearestEntities(Point(2, 2), 2) == vector<string>{"DaNang", "Hue"});
+    CHECK(kg.nearestEntities(Point(0, 0), 10).size() == 4);
+    CHECK(kg.entitiesWithinRadius(Point(2, 2), 1) == vector<string>{"DaNang", "Hue"}); // cùng khoảng cách: theo thứ tự thêm
+    CHECK(kg.entitiesWithinRadius(Point(2, 2), 0.5).empty());
+
+    CHECK(kg.getRelatedEntities("Hanoi", 3) == vector<string>{"Hue", "DaNang", "HCMC", "Warehouse"});
+    CHECK(kg.getRelatedEntities("Hanoi", 3, Point(0, 0), 11) == vector<string>{"Hue", "DaNang", "HCMC"});
+    CHECK(kg.getRelatedEntities("Hanoi", 3, Point(2, -10), 1) == vector<string>{"HCMC"});
+
+    kg.setPosition("HCMC", Point(2, 2.5)); // cập nhật tọa độ: cây được dựng lại ở truy vấn sau
+    CHECK(kg.nearestEntities(Point(2, 2), 1) == vector<string>{"HCMC"});
+
+    // so với duyệt tuần tự trên tập điểm giả ngẫu nhiên
+    KnowledgeGraph grid;
+    vector<Point> points;
+    unsigned int seed = 12345;
+    for (int i = 0; i < 300; i++)
+    {
+        double coord[3];
+        for (int j = 0; j < 3; j++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            coord[j] = (seed >> 16) % 100;
+        }
+        points.push_back(Point(coord[0], coord[1], coord[2]));
+        grid.addEntity("P" + to_string(i));
+        grid.setPosition("P" + to_string(i), points.back());
+    }
+    Point center(40, 55, 20);
+    vector<pair<double, int> > expected;
+    for (int i = 0; i < 300; i++)
+    {
+        expected.push_back(make_pair(center.distanceTo(points[i]), i));
+    }
+    sort(expected.begin(), expected.end());
+    vector<string> nearest = grid.nearestEntities(center, 7);
+    REQUIRE(nearest.size() == 7);
+    for (int i = 0; i < 7; i++)
+    {
+        CHECK(nearest[i] == "P" + to_string(expected[i].second));
+    }
+    vector<string> inside = grid.entitiesWithinRadius(center, 25);
+    size_t count = 0;
+    while (count < expected.size() && expected[count].first <= 25)
+    {
+        count++;
+    }
+    REQUIRE(inside.size() == count);
+    for (size_t i = 0; i < count; i++)
+    {
+        CHECK(inside[i] == "P" + to_string(expected[i].second));
+    }
+}
+
+TEST_CASE("test_163")
+{
+    KnowledgeGraph kg;
+
+    const char *names[6] = {"Thing", "Animal", "Mammal", "Dog", "Cat", "Pet"};
+    for (int i = 0; i < 6; i++)
+    {
+        kg.addEntity(names[i]);
+    }
+    kg.addTriple("Dog", "isA", "Mammal");
+    kg.addTriple("Cat", "isA", "Mammal");
+    kg.addTriple("Mammal", "isA", "Animal");
+    kg.addTriple("Animal", "isA", "Thing");
+    kg.addTriple("Dog", "isA", "Pet");
+    kg.addTriple("Pet", "likes", "Dog");
+
+    CHECK(kg.topologicalSort("isA") == vector<string>{"Dog", "Cat", "Pet", "Mammal", "Animal", "Thing"});
+    CHECK(kg.findCycle("isA").empty());
+    CHECK(kg.findCycle() == vector<string>{"Dog", "Pet", "Dog"});
+    string message;
+    try
+    {
+        kg.topologicalSort();
+    }
+    catch (const CycleException &e)
+    {
+        message = e.what();
+    }
+    CHECK(message == "Cycle: Dog -> Pet -> Dog");
+
+    // chế độ tăng dần: chỉ các cạnh "isA" phải không có chu trình
+    kg.enforceAcyclicOn("isA");
+    kg.addTriple("Pet", "isA", "Animal");
+    kg.addTriple("Thing", "relatedTo", "Dog");
+    message = "";
+    try
+    {
+        kg.addTriple("Thing", "isA", "Dog");
+    }
+    catch (const CycleException &e)
+    {
+        message = e.what();
+    }
+    CHECK(message == "Cycle: Thing -> Dog -> Pet -> Animal -> Thing");
+    CHECK(kg.getNeighbors("Thing", "isA").empty());
+    CHECK_THROWS_AS(kg.addTriple("Cat", "isA", "Cat"), CycleException);
+    kg.addEntity("Robot");
+    kg.addTriple("Robot", "isA", "Pet");
+    CHECK(kg.findCycle("isA").empty());
+
+    // mọi quan hệ: đồ thị hiện tại đã có chu trình Dog <-> Pet
+    CHECK_THROWS_AS(kg.enforceAcyclic(), CycleException);
+
+    // chuỗi dài thêm theo thứ tự ngược: mỗi lần chèn chỉ sắp lại một vùng nhỏ
+    DGraphModel<int, NativeVertexPolicy<int> > chain;
+    chain.enforceAcyclic(true);
+    const int length = 2000;
+    for (int i = 0; i < length; i++)
+    {
+        chain.add(i);
+    }
+    for (int i = length - 1; i > 0; i--)
+    {
+        chain.connect(i - 1, i);
+    }
+    chain.connect(0, length - 1);
+    CHECK_THROWS_AS(chain.connect(length - 1, 0), CycleException);
+    CHECK_THROWS_AS(chain.connect(length / 2, 3), CycleException);
+    chain.connect(3, length / 2);
+    vector<int> order = chain.topologicalSort();
+    CHECK(order.size() == length);
+    CHECK(order.front() == 0);
+    CHECK(order.back() == length - 1);
+}
+
+TEST_CASE("test_164")
+{
+    KnowledgeGraph kg;
+
+    // Hub nhận cạnh từ mọi trang, Leaf không có cạnh ra (rank của nó được chia đều lại)
+    const char *names[6] = {"Hub", "A", "B", "C", "D", "Leaf"};
+    for (int i = 0; i < 6; i++)
+    {
+        kg.addEntity(names[i]);
+    }
+    kg.addRelation("A", "Hub", 1);
+    kg.addRelation("B", "Hub", 1);
+    kg.addRelation("C", "Hub", 1);
+    kg.addRelation("D", "Hub", 1);
+    kg.addRelation("Hub", "A", 1);
+    kg.addRelation("Hub", "Leaf", 9);
+    kg.addRelation("A", "B", 1);
+    kg.addRelation("C", "D", 1);
+
+    vector<double> scores = kg.pageRank();
+    double total = 0;
+    for (double score : scores)
+    {
+        total += score;
+    }
+    CHECK(scores.size() == 6);
+    CHECK(total == doctest::Approx(1.0));
+    CHECK(kg.topEntities(1)[0].first == "Hub");
+    CHECK(scores[3] < scores[4]); // C chỉ nhận phần nhảy ngẫu nhiên, D nhận thêm từ C
+
+    // nhiều luồng cho cùng kết quả
+    PageRankOptions parallel;
+    parallel.threads = 4;
+    vector<double> parallelScores = kg.pageRank(parallel);
+    for (int i = 0; i < 6; i++)
+    {
+        CHECK(parallelScores[i] == doctest::Approx(scores[i]).epsilon(1e-9));
+    }
+
+    // có trọng số: Hub dồn phần lớn rank cho Leaf
+    PageRankOptions weighted;
+    weighted.weighted = true;
+    vector<double> weightedScores = kg.pageRank(weighted);
+    CHECK(weightedScores[5] > scores[5]);
+    CHECK(weightedScores[1] < scores[1]);
+
+    vector<pair<string, double> > top = kg.topEntities(3, weighted);
+    REQUIRE(top.size() == 3);
+    CHECK(top[0].first == "Hub");
+    CHECK(top[1].first == "Leaf");
+    CHECK(top[0].second >= top[1].second);
+    CHECK(top[1].second >= top[2].second);
+    CHECK(kg.topEntities(10).size() == 6);
+
+    // personalized: nhảy ngẫu nhiên về C, nên D (chỉ C trỏ tới) vượt B
+    vector<pair<string, double> > local = kg.topEntities(6, vector<string>{"C"});
+    CHECK(local[0].first == "Hub");
+    CHECK(local[1].first == "C");
+    CHECK(local[4].first == "D");
+    CHECK(local[5].first == "B");
+    CHECK(kg.topEntities(6)[3].first == "B"); // không cá nhân hóa thì B đứng trên D
+    CHECK_THROWS_AS(kg.topEntities(1, vector<string>{"Nobody"}), EntityNotFoundException);
+
+    // chu trình đối xứng: mọi đỉnh bằng nhau, hòa thì theo thứ tự thêm
+    KnowledgeGraph ring;
+    ring.addEntity("X");
+    ring.addEntity("Y");
+    ring.addEntity("Z");
+    ring.addRelation("X", "Y");
+    ring.addRelation("Y", "Z");
+    ring.addRelation("Z", "X");
+    vector<pair<string, double> > even = ring.topEntities(2);
+    CHECK(even[0].first == "X");
+    CHECK(even[1].first == "Y");
+    CHECK(even[0].second == doctest::Approx(1.0 / 3));
+}
+
+TEST_CASE("test_165")
+{
+    KnowledgeGraph kg;
+
+    kg.addEntity("A");
+    kg.addEntity("B");
+    kg.addEntity("C");
+    kg.addEntity("D");
+    kg.addEntity("E");
+    kg.addRelation("A", "C");
+    kg.addRelation("A", "B");
+    kg.addRelation("B", "D");
+    kg.addRelation("C", "D");
+    kg.addRelation("D", "E");
+    kg.addRelation("E", "A");
+
+    vector<vector<string> > related = kg.getRelatedEntities(vector<string>{"A", "D", "A"}, 2);
+    CHECK(related.size() == 3);
+    CHECK(related[0] == vector<string>{"B", "C", "D"});
+    CHECK(related[1] == vector<string>{"E", "A"}); // theo số bước trước
+    CHECK(related[2] == related[0]);
+    vector<vector<pair<string, int> > > hops = kg.hopDistances(vector<string>{"B"});
+    CHECK(hops[0] == vector<pair<string, int> >{{"D", 1}, {"E", 2}, {"A", 3}, {"C", 4}});
+    CHECK(kg.hopDistances(vector<string>{"B"}, 2)[0].size() == 2);
+    CHECK_THROWS_AS(kg.getRelatedEntities(vector<string>{"A", "Z"}, 2), EntityNotFoundException);
+
+    // 300 nguồn (một lô 256 nguồn + một lô 44 nguồn) cho cùng tập kết quả như từng lần BFS riêng
+    KnowledgeGraph big;
+    const int count = 400;
+    for (int i = 0; i < count; i++)
+    {
+        big.addEntity("V" + to_string(i));
+    }
+    unsigned int seed = 7;
+    for (int i = 0; i < 3 * count; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        int from = (seed >> 8) % count;
+        seed = seed * 1103515245u + 12345u;
+        int to = (seed >> 8) % count;
+        big.addRelation("V" + to_string(from), "V" + to_string(to));
+    }
+    vector<string> seeds;
+    for (int i = 0; i < 300; i++)
+    {
+        seeds.push_back("V" + to_string((i * 7) % count));
+    }
+    vector<vector<string> > batched = big.getRelatedEntities(seeds, 3);
+    REQUIRE(batched.size() == seeds.size());
+    for (size_t i = 0; i < seeds.size(); i++)
+    {
+        vector<string> single = big.getRelatedEntities(seeds[i], 3);
+        vector<string> batch = batched[i];
+        sort(single.begin(), single.end());
+        sort(batch.begin(), batch.end());
+        CHECK(batch == single);
+    }
+}
+
+TEST_CASE("test_166")
+{
+    // mọi kernel được CPU hỗ trợ cho cùng kết quả với bản vô hướng
+    unsigned int seed = 99;
+    IntersectKernel original = intersectKernel();
+    for (int round = 0; round < 50; round++)
+    {
+        vector<int> a, b;
+        for (int i = 0; i < 1000; i++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            if ((seed >> 16) % 3 == 0) a.push_back(i);
+            seed = seed * 1103515245u + 12345u;
+            if ((seed >> 16) % (round % 5 + 2) == 0) b.push_back(i);
+        }
+        setIntersectKernel(INTERSECT_SCALAR);
+        vector<int> expected(a.size());
+        expected.resize(intersectSorted(a.data(), a.size(), b.data(), b.size(), expected.data()));
+        for (int kernel = INTERSECT_SSE; kernel <= INTERSECT_AVX2; kernel++)
+        {
+            if (!intersectKernelSupported(IntersectKernel(kernel)))
+                continue;
+            setIntersectKernel(IntersectKernel(kernel));
+            vector<int> actual(a.size());
+            actual.resize(intersectSorted(a.data(), a.size(), b.data(), b.size(), actual.data()));
+            CHECK(actual == expected);
+            CHECK(intersectSorted(b.data(), b.size(), a.data(), a.size()) == expected.size());
+        }
+    }
+    setIntersectKernel(original);
+    CHECK(intersectKernel() == original);
+
+    KnowledgeGraph kg;
+    const char *names[6] = {"Alice", "Bob", "Carol", "Dave", "Eve", "Frank"};
+    for (int i = 0; i < 6; i++)
+    {
+        kg.addEntity(names[i]);
+    }
+    kg.addTriple("Alice", "knows", "Bob");
+    kg.addTriple("Alice", "knows", "Carol");
+    kg.addTriple("Bob", "knows", "Carol");
+    kg.addTriple("Dave", "knows", "Bob");
+    kg.addTriple("Dave", "knows", "Carol");
+    kg.addTriple("Carol", "worksWith", "Dave");
+    kg.addTriple("Eve", "knows", "Alice");
+
+    CHECK(kg.commonNeighbors("Alice", "Dave") == vector<string>{"Bob", "Carol"});
+    CHECK(kg.similarity("Alice", "Dave", COMMON_NEIGHBORS) == 2);
+    CHECK(kg.similarity("Alice", "Dave") == doctest::Approx(2.0 / 3)); // N(Alice) = {Bob, Carol, Eve}, N(Dave) = {Bob, Carol}
+    CHECK(kg.similarity("Alice", "Dave", ADAMIC_ADAR) == doctest::Approx(1 / log(3.0) + 1 / log(3.0)));
+    CHECK(kg.similarity("Frank", "Alice") == 0);
+    CHECK(kg.triangleCount("Carol") == 2);
+    CHECK(kg.triangleCount("Eve") == 0);
+    CHECK(kg.triangleCount() == 2);
+    CHECK(kg.triangleCount(4) == 2);
+
+    vector<vector<pair<string, double> > > similar = kg.mostSimilar(vector<string>{"Alice", "Frank"}, 2);
+    REQUIRE(similar.size() == 2);
+    CHECK(similar[0] == vector<pair<string, double> >{{"Dave", 2.0 / 3}, {"Bob", 1.0 / 5}}); // Bob và Carol cùng 1/5
+    CHECK(similar[1].empty());
+    CHECK(kg.mostSimilar(vector<string>{"Alice", "Frank"}, 2, JACCARD, 2) == similar);
+
+    kg.addRelation("Frank", "Bob"); // chỉ mục láng giềng được dựng lại
+    CHECK(kg.commonNeighbors("Frank", "Alice") == vector<string>{"Bob"});
+}
+
+TEST_CASE("test_167")
+{
+    // đồ thị lưu trên đĩa cho cùng kết quả duyệt với KnowledgeGraph, trước và sau khi trộn bộ đệm / mở lại
+    const string directory = "test_167_graph";
+    MappedKnowledgeGraph::remove(directory);
+    KnowledgeGraph expected;
+    {
+        MappedKnowledgeGraph mapped(directory, 7); // bộ đệm nhỏ: trộn nhiều lần khi đang thêm
+        for (int i = 0; i < 30; i++)
+        {
+            string entity = "E" + to_string(i);
+            expected.addEntity(entity);
+            mapped.addEntity(entity);
+        }
+        CHECK_THROWS_AS(mapped.addEntity("E3"), EntityExistsException);
+        CHECK_THROWS_AS(mapped.addRelation("E1", "missing"), EntityNotFoundException);
+        unsigned int seed = 7;
+        for (int k = 0; k < 80; k++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            string from = "E" + to_string((seed >> 8) % 30);
+            seed = seed * 1103515245u + 12345u;
+            string to = "E" + to_string((seed >> 8) % 30);
+            float weight = (seed >> 4) % 10 + 0.5f;
+            expected.addRelation(from, to, weight);
+            mapped.addRelation(from, to, weight);
+        }
+        CHECK(mapped.buffered() < 7);
+        CHECK(mapped.size() == 30);
+        for (int i = 0; i < 30; i += 3)
+        {
+            string entity = "E" + to_string(i);
+            CHECK(mapped.bfs(entity) == expected.bfs(entity));
+            CHECK(mapped.dfs(entity) == expected.dfs(entity));
+            CHECK(mapped.getRelatedEntities(entity, 2) == expected.getRelatedEntities(entity, 2));
+        }
+    }
+
+    // mở lại từ các tệp, sửa trọng số của cạnh đã nằm trên đĩa và thêm quan hệ mới vào bộ đệm
+    auto segment = [&directory](const string &name, unsigned long long generation) {
+        return directory + "/" + name + "." + to_string(generation) + ".dat";
+    };
+    struct stat info;
+    MappedKnowledgeGraph reopened(directory);
+    unsigned long long generation = reopened.generation();
+    CHECK(generation > 2);
+    CHECK(stat(segment("entities", generation).c_str(), &info) == 0);
+    CHECK(stat(segment("entities", generation - 1).c_str(), &info) != 0);
+    CHECK(reopened.size() == 30);
+    CHECK(reopened.buffered() == 0);
+    CHECK(reopened.getAllEntities() == expected.getAllEntities());
+    string first = expected.getNeighbors("E0").empty() ? "E1" : "E0";
+    string target = expected.getNeighbors(first)[0];
+    expected.addRelation(first, target, 42);
+    reopened.addRelation(first, target, 42);
+    expected.addEntity("Z");
+    reopened.addEntity("Z");
+    expected.addRelation("Z", "E5", 1);
+    reopened.addRelation("Z", "E5", 1);
+    expected.addRelation("E5", "Z", 2);
+    reopened.addRelation("E5", "Z", 2);
+    CHECK(reopened.buffered() == 3);
+    for (const string &entity : expected.getAllEntities())
+    {
+        CHECK(reopened.bfs(entity) == expected.bfs(entity));
+        CHECK(reopened.dfs(entity) == expected.dfs(entity));
+        CHECK(reopened.getNeighbors(entity) == expected.getNeighbors(entity));
+        CHECK(reopened.isReachable(entity, "Z") == expected.isReachable(entity, "Z"));
+        CHECK(reopened.getRelatedEntities(entity, 3) == expected.getRelatedEntities(entity, 3));
+    }
+
+    // trộn lỗi trước khi đổi manifest (tệp của thế hệ mới bị một thư mục chiếm chỗ): đối tượng vẫn đọc thế hệ
+    // cũ cùng bộ đệm, các tệp ghi dở bị xóa
+    string blocked = segment("adjacency", generation + 1);
+    CHECK(mkdir(blocked.c_str(), 0755) == 0);
+    ofstream((blocked + "/keep").c_str()) << "x";
+    CHECK_THROWS_AS(reopened.flush(), StorageException);
+    CHECK(reopened.generation() == generation);
+    CHECK(reopened.buffered() == 3);
+    CHECK(stat(segment("entities", generation + 1).c_str(), &info) != 0);
+    CHECK(reopened.bfs("Z") == expected.bfs("Z"));
+    CHECK(reopened.dfs("E5") == expected.dfs("E5"));
+    std::remove((blocked + "/keep").c_str());
+    std::remove(blocked.c_str());
+    CHECK(MappedKnowledgeGraph(directory).size() == 30); // các thay đổi chưa trộn không lên đĩa
+
+    reopened.flush();
+    CHECK(reopened.buffered() == 0);
+    CHECK(reopened.generation() == generation + 1);
+    CHECK(stat(segment("entities", generation).c_str(), &info) != 0);
+    CHECK(reopened.bfs("Z") == expected.bfs("Z"));
+
+    // sửa trọng số tại chỗ rồi flush() (msync), không cần trộn
+    expected.addRelation("Z", "E5", 7);
+    reopened.addRelation("Z", "E5", 7);
+    CHECK(reopened.buffered() == 0);
+    reopened.flush();
+    CHECK(reopened.generation() == generation + 1);
+
+    // sập giữa lúc trộn: thế hệ kế tiếp ghi dở và manifest.tmp bị bỏ qua rồi dọn đi khi mở lại
+    ofstream(segment("entities", generation + 2).c_str()) << "partial";
+    ofstream((directory + "/manifest.tmp").c_str()) << "partial";
+    {
+        MappedKnowledgeGraph recovered(directory);
+        CHECK(recovered.generation() == generation + 1);
+        CHECK(recovered.bfs("Z") == expected.bfs("Z"));
+        CHECK(recovered.getAllEntities() == expected.getAllEntities());
+    }
+    CHECK(stat(segment("entities", generation + 2).c_str(), &info) != 0);
+
+    // chỉ mục băm bằng FNV-1a và ghi phiên bản định dạng; tệp khác phiên bản bị từ chối
+    CHECK(fnv1a("") == 14695981039346656037ULL);
+    CHECK(fnv1a("a") == 0xaf63dc4c8601ec8cULL);
+    unsigned long long format = 0, expectedFormat = MappedKnowledgeGraph::INDEX_FORMAT;
+    {
+        ifstream index(segment("index", reopened.generation()).c_str(), ios::binary);
+        index.read(reinterpret_cast<char *>(&format), sizeof(format));
+    }
+    CHECK(format == expectedFormat);
+    {
+        fstream index(segment("index", reopened.generation()).c_str(), ios::binary | ios::in | ios::out);
+        unsigned long long legacy = 64; // bố cục cũ: từ đầu tiên là capacity
+        index.write(reinterpret_cast<const char *>(&legacy), sizeof(legacy));
+    }
+    CHECK_THROWS_AS(MappedKnowledgeGraph(directory, 16), StorageException);
+    MappedKnowledgeGraph::remove(directory);
+}
+
+TEST_CASE("test_168")
+{
+    // ảnh chụp giữ nguyên thứ tự kề; mở lại = checkpoint + replay phần đuôi log; đuôi ghi dở bị cắt bỏ
+    WriteAheadLog closed;
+    CHECK_THROWS_AS(closed.checkHealthy(), StorageException);
+    const string directory = "test_168_graph";
+    DurableKnowledgeGraph::remove(directory);
+    KnowledgeGraph expected;
+    {
+        DurableKnowledgeGraph durable(directory);
+        for (int i = 0; i < 20; i++)
+        {
+            string entity = "E" + to_string(i);
+            expected.addEntity(entity);
+            durable.addEntity(entity);
+        }
+        CHECK_THROWS_AS(durable.addEntity("E3"), EntityExistsException);
+        unsigned int seed = 11;
+        for (int k = 0; k < 60; k++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            string from = "E" + to_string((seed >> 8) % 20);
+            seed = seed * 1103515245u + 12345u;
+            string to = "E" + to_string((seed >> 8) % 20);
+            float weight = (seed >> 4) % 10 + 0.5f;
+            if (k % 3 == 0)
+            {
+                expected.addTriple(from, "likes", to, weight);
+                durable.addTriple(from, "likes", to, weight);
+            }
+            else
+            {
+                expected.addRelation(from, to, weight);
+                durable.addRelation(from, to, weight);
+            }
+        }
+        expected.setPosition("E2", Point(1, 2, 3));
+        durable.setPosition("E2", Point(1, 2, 3));
+        durable.checkpoint();
+        CHECK(durable.logBytes() == 0);
+        expected.addEntity("Z");
+        durable.addEntity("Z");
+        expected.addRelation("Z", "E0", 4);
+        durable.addRelation("Z", "E0", 4);
+    }
+
+    // chỉ hai bản ghi sau checkpoint được replay
+    {
+        DurableKnowledgeGraph reopened(directory);
+        CHECK(reopened.replayed() == 2);
+        KnowledgeGraph &graph = reopened.graph();
+        CHECK(graph.toString() == expected.toString());
+        CHECK(graph.getAllEntities() == expected.getAllEntities());
+        for (const string &entity : expected.getAllEntities())
+        {
+            CHECK(graph.bfs(entity) == expected.bfs(entity));
+            CHECK(graph.dfs(entity) == expected.dfs(entity));
+        }
+        CHECK(graph.getPosition("E2").getZ() == 3);
+    }
+
+    // một bản ghi bị cắt giữa chừng ở cuối log: bị bỏ qua và cắt đi, log tiếp tục ghi được
+    {
+        ofstream wal((directory + "/wal.log").c_str(), ios::binary | ios::app);
+        wal.write("\x20\x00\x00\x00\x01\x02", 6);
+    }
+    {
+        DurabilityOptions options;
+        options.synchronous = false;
+        options.groupCommitMicros = 50000;
+        DurableKnowledgeGraph reopened(directory, options);
+        CHECK(reopened.replayed() == 2);
+        for (int i = 0; i < 100; i++)
+        {
+            reopened.addRelation("Z", "E" + to_string(i % 20), i);
+            expected.addRelation("Z", "E" + to_string(i % 20), i);
+        }
+        reopened.sync();
+        CHECK(reopened.graph().toString() == expected.toString());
+    }
+    {
+        DurableKnowledgeGraph reopened(directory);
+        CHECK(reopened.replayed() == 102);
+        CHECK(reopened.graph().toString() == expected.toString());
+        CHECK(reopened.graph().bfs("Z") == expected.bfs("Z"));
+    }
+
+    // bản ghi đủ độ dài nhưng sai CRC ở cuối tệp vẫn là đuôi ghi dở
+    {
+        ofstream wal((directory + "/wal.log").c_str(), ios::binary | ios::app);
+        wal.write("\x02\x00\x00\x00\x00\x00\x00\x00\xe7\x03\x00\x00\x00\x00\x00\x00ab", 18);
+    }
+    {
+        DurableKnowledgeGraph reopened(directory);
+        CHECK(reopened.replayed() == 102);
+    }
+
+    // hỏng một byte payload của bản ghi đầu tiên: không được cắt mất các bản ghi phía sau
+    streamoff logSize;
+    {
+        fstream wal((directory + "/wal.log").c_str(), ios::binary | ios::in | ios::out);
+        wal.seekg(0, ios::end);
+        logSize = wal.tellg();
+        wal.seekp(16);
+        wal.put('#');
+    }
+    CHECK_THROWS_AS(DurableKnowledgeGraph(directory, DurabilityOptions()), StorageException);
+    CHECK_THROWS_AS(WriteAheadLog::replay(directory + "/wal.log", 0, [](const string &) {}), StorageException);
+    ifstream corrupt((directory + "/wal.log").c_str(), ios::binary | ios::ate);
+    CHECK(corrupt.tellg() == logSize);
+    DurableKnowledgeGraph::remove(directory);
+}
+
+TEST_CASE("test_169")
+{
+    // đồ thị chia shard (nạp từng thao tác hoặc theo lô) duyệt đúng như KnowledgeGraph
+    KnowledgeGraph expected;
+    vector<string> entities;
+    vector<ShardedKnowledgeGraph::Relation> batch;
+    for (int i = 0; i < 60; i++)
+    {
+        entities.push_back("E" + to_string(i));
+        expected.addEntity(entities.back());
+    }
+    unsigned int seed = 5;
+    for (int k = 0; k < 150; k++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        string from = entities[(seed >> 8) % 60];
+        seed = seed * 1103515245u + 12345u;
+        string to = k % 25 == 0 ? from : entities[(seed >> 8) % 60]; // có cả khuyên và cạnh lặp
+        float weight = (seed >> 4) % 10 + 0.5f;
+        batch.push_back(ShardedKnowledgeGraph::Relation(from, to, weight));
+        expected.addRelation(from, to, weight);
+    }
+    for (int shards = 1; shards <= 4; shards += 3)
+    {
+        ShardedKnowledgeGraph single(shards), bulk(shards);
+        for (const string &entity : entities)
+            single.addEntity(entity);
+        for (const ShardedKnowledgeGraph::Relation &relation : batch)
+            single.addRelation(relation.from, relation.to, relation.weight);
+        bulk.addEntities(vector<string>(entities.begin(), entities.begin() + 30));
+        bulk.addEntities(vector<string>(entities.begin() + 30, entities.end()));
+        bulk.addRelations(batch);
+        CHECK_THROWS_AS(bulk.addEntities(vector<string>{"new", "E7"}), EntityExistsException);
+        CHECK_THROWS_AS(bulk.addRelations({ShardedKnowledgeGraph::Relation("E1", "missing")}), EntityNotFoundException);
+        CHECK_FALSE(bulk.contains("new"));
+        CHECK(bulk.shardCount() == shards);
+        CHECK(bulk.relationCount() == single.relationCount());
+        CHECK(bulk.getAllEntities() == expected.getAllEntities());
+        for (const string &entity : entities)
+        {
+            CHECK(single.bfs(entity) == expected.bfs(entity));
+            CHECK(bulk.bfs(entity) == expected.bfs(entity));
+            CHECK(bulk.getNeighbors(entity) == expected.getNeighbors(entity));
+            CHECK(bulk.getRelatedEntities(entity, 2) == expected.getRelatedEntities(entity, 2));
+            CHECK(bulk.isReachable(entity, "E0") == expected.isReachable(entity, "E0"));
+        }
+    }
+}
+
+TEST_CASE("test_170")
+{
+    // truy vấn bất đồng bộ cho cùng kết quả; lane interactive chạy trước lane batch; lane đầy thì báo lỗi
+    KnowledgeGraph kg;
+    for (int i = 0; i < 40; i++)
+        kg.addEntity("E" + to_string(i));
+    for (int i = 1; i < 40; i++)
+    {
+        kg.addRelation("E" + to_string((i - 1) / 2), "E" + to_string(i), i % 3 + 1.0f);
+        if (i % 7 == 0)
+            kg.addRelation("E" + to_string(i), "E" + to_string(i / 3), 2.0f);
+    }
+    KnowledgeGraph copy;
+    for (const string &entity : kg.getAllEntities())
+        copy.addEntity(entity);
+    for (int i = 1; i < 40; i++)
+    {
+        copy.addRelation("E" + to_string((i - 1) / 2), "E" + to_string(i), i % 3 + 1.0f);
+        if (i % 7 == 0)
+            copy.addRelation("E" + to_string(i), "E" + to_string(i / 3), 2.0f);
+    }
+
+    {
+        ExecutorOptions options;
+        options.threads = 3;
+        QueryExecutor executor(kg, options);
+        vector<std::future<string> > bfs, ancestors;
+        vector<std::future<vector<string> > > related;
+        vector<std::future<PathResult<string, double> > > paths;
+        for (int i = 0; i < 40; i++)
+        {
+            string entity = "E" + to_string(i);
+            bfs.push_back(executor.bfs(entity));
+            related.push_back(executor.getRelatedEntities(entity, 3, LANE_BATCH));
+            ancestors.push_back(executor.findCommonAncestors(entity, "E" + to_string((i * 7) % 40), LANE_BATCH));
+            paths.push_back(executor.shortestPath("E0", entity));
+        }
+        std::atomic<int> reachable(0);
+        std::promise<void> allCallbacks;
+        std::atomic<int> callbacks(0);
+        for (int i = 0; i < 40; i++)
+        {
+            executor.submit(LANE_INTERACTIVE,
+                            [i](KnowledgeGraph &graph) { return graph.isReachable("E" + to_string(i), "E1"); },
+                            [&](bool result) {
+                                if (result) reachable++;
+                                if (++callbacks == 40) allCallbacks.set_value();
+                            });
+        }
+        for (int i = 0; i < 40; i++)
+        {
+            string entity = "E" + to_string(i);
+            CHECK(bfs[i].get() == copy.bfs(entity));
+            CHECK(related[i].get() == copy.getRelatedEntities(entity, 3));
+            CHECK(ancestors[i].get() == copy.findCommonAncestors(entity, "E" + to_string((i * 7) % 40)));
+            PathResult<string, double> path = paths[i].get();
+            CHECK(path.distance == copy.shortestPath("E0", entity).distance);
+        }
+        allCallbacks.get_future().wait();
+        int expectedReachable = 0;
+        for (int i = 0; i < 40; i++)
+            expectedReachable += copy.isReachable("E" + to_string(i), "E1");
+        CHECK(reachable == expectedReachable);
+
+        // lỗi của truy vấn được ném lại từ future; update() chạy dưới khóa ghi
+        std::future<string> missing = executor.bfs("missing");
+        CHECK_THROWS_AS(missing.get(), EntityNotFoundException);
+        executor.update([](KnowledgeGraph &graph) { graph.addEntity("new"); graph.addRelation("E39", "new"); }).get();
+        CHECK(executor.isReachable("E0", "new").get());
+        copy.addEntity("new");
+        copy.addRelation("E39", "new");
+
+        // chỉ mục láng giềng và cây k-d được dựng lại lười trong truy vấn đọc: các truy vấn song song ngay sau
+        // update() phải cùng thấy chỉ mục đã dựng xong
+        for (int round = 0; round < 3; round++)
+        {
+            executor.update([round](KnowledgeGraph &graph) {
+                for (int i = 0; i < 40; i++)
+                    graph.setPosition("E" + to_string(i), Point(i % 7 + round, i / 7, round));
+                graph.addRelation("E" + to_string(round + 3), "E" + to_string(39 - round));
+            }).get();
+            for (int i = 0; i < 40; i++)
+                copy.setPosition("E" + to_string(i), Point(i % 7 + round, i / 7, round));
+            copy.addRelation("E" + to_string(round + 3), "E" + to_string(39 - round));
+
+            vector<std::future<double> > similar;
+            vector<std::future<vector<string> > > nearest, around;
+            for (int i = 0; i < 40; i++)
+            {
+                string entity = "E" + to_string(i), other = "E" + to_string((i * 11) % 40);
+                similar.push_back(executor.submit(LANE_INTERACTIVE, [entity, other](KnowledgeGraph &graph) {
+                    return graph.similarity(entity, other, JACCARD);
+                }));
+                Point center(i % 5, i % 3, round);
+                nearest.push_back(executor.submit(LANE_INTERACTIVE, [center](KnowledgeGraph &graph) {
+                    return graph.nearestEntities(center, 4);
+                }));
+                around.push_back(executor.submit(LANE_BATCH, [entity, center](KnowledgeGraph &graph) {
+                    return graph.getRelatedEntities(entity, 2, center, 3.0);
+                }));
+            }
+            for (int i = 0; i < 40; i++)
+            {
+                string entity = "E" + to_string(i), other = "E" + to_string((i * 11) % 40);
+                Point center(i % 5, i % 3, round);
+                CHECK(similar[i].get() == copy.similarity(entity, other, JACCARD));
+                CHECK(nearest[i].get() == copy.nearestEntities(center, 4));
+                CHECK(around[i].get() == copy.getRelatedEntities(entity, 2, center, 3.0));
+            }
+        }
+    }
+
+    // một luồng, bị giữ bận: việc interactive gửi sau vẫn chạy trước các việc batch
+    ExecutorOptions options;
+    options.threads = 1;
+    options.batchCapacity = 3;
+    options.blockWhenFull = false;
+    QueryExecutor executor(kg, options);
+    std::promise<void> started, release;
+    std::shared_future<void> gate = release.get_future().share();
+    std::future<int> blocker = executor.submit(LANE_BATCH, [&started, gate](KnowledgeGraph &) {
+        started.set_value();
+        gate.wait();
+        return 0;
+    });
+    started.get_future().wait();
+    std::mutex orderLock;
+    vector<string> order;
+    vector<std::future<int> > batch;
+    for (int i = 0; i < 3; i++)
+    {
+        batch.push_back(executor.submit(LANE_BATCH, [&orderLock, &order, i](KnowledgeGraph &) {
+            std::lock_guard<std::mutex> lock(orderLock);
+            order.push_back("batch" + to_string(i));
+            return i;
+        }));
+    }
+    CHECK(executor.queued(LANE_BATCH) == 3);
+    CHECK_THROWS_AS(executor.submit(LANE_BATCH, [](KnowledgeGraph &) { return 0; }), QueueFullException);
+    std::future<int> urgent = executor.submit(LANE_INTERACTIVE, [&orderLock, &order](KnowledgeGraph &) {
+        std::lock_guard<std::mutex> lock(orderLock);
+        order.push_back("interactive");
+        return 1;
+    });
+    release.set_value();
+    CHECK(urgent.get() == 1);
+    for (auto &result : batch)
+        result.get();
+    blocker.get();
+    CHECK(order == vector<string>{"interactive", "batch0", "batch1", "batch2"});
+
+    // lỗi của truy vấn callback không có onError và lỗi do callback ném ra đi tới xử lý lỗi của executor
+    std::mutex errorLock;
+    vector<string> errors;
+    std::promise<void> threeErrors;
+    ExecutorOptions reporting;
+    reporting.threads = 2;
+    reporting.onError = [&](std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(errorLock);
+        try
+        {
+            std::rethrow_exception(error);
+        }
+        catch (const EntityNotFoundException &)
+        {
+            errors.push_back("not found");
+        }
+        catch (const std::exception &e)
+        {
+            errors.push_back(e.what());
+        }
+        if (errors.size() == 3)
+            threeErrors.set_value();
+    };
+    QueryExecutor failing(kg, reporting);
+    std::promise<string> ownError;
+    failing.submit(LANE_INTERACTIVE, [](KnowledgeGraph &graph) { return graph.bfs("missing"); }, [](const string &) {},
+                   [&ownError](std::exception_ptr) { ownError.set_value("own"); });
+    CHECK(ownError.get_future().get() == "own");
+    failing.submit(LANE_INTERACTIVE, [](KnowledgeGraph &graph) { return graph.bfs("missing"); }, [](const string &) {});
+    failing.submit(LANE_BATCH, [](KnowledgeGraph &graph) { return graph.bfs("E0"); },
+                   [](const string &) { throw std::runtime_error("callback failed"); });
+    failing.submit(LANE_BATCH, [](KnowledgeGraph &graph) { return graph.bfs("missing"); }, [](const string &) {},
+                   [](std::exception_ptr) { throw std::runtime_error("handler failed"); });
+    threeErrors.get_future().wait();
+    std::sort(errors.begin(), errors.end());
+    CHECK(errors == vector<string>{"callback failed", "handler failed", "not found"});
+}
+
+TEST_CASE("test_171")
+{
+    // truy vấn mẫu: kết quả trùng với phép nối lồng nhau đơn giản, biến chọn lọc nhất được gán trước
+    KnowledgeGraph kg;
+    vector<string> cities, countries = {"Vietnam", "France", "Japan"};
+    for (const string &country : countries)
+        kg.addEntity(country);
+    kg.addEntity("Asia");
+    kg.addEntity("Europe");
+    kg.addTriple("Vietnam", "locatedIn", "Asia");
+    kg.addTriple("Japan", "locatedIn", "Asia");
+    kg.addTriple("France", "locatedIn", "Europe");
+    for (int i = 0; i < 30; i++)
+    {
+        cities.push_back("City" + to_string(i));
+        kg.addEntity(cities.back());
+        kg.addTriple(cities.back(), "partOf", countries[i % 3]);
+        if (i % 4 == 0)
+            kg.addTriple(cities.back(), "partOf", countries[(i + 1) % 3]); // vài thành phố thuộc hai nước
+        if (i > 0)
+            kg.addTriple(cities[i - 1], "near", cities.back());
+        kg.addRelation(cities.back(), countries[i % 3]); // quan hệ không nhãn, chỉ khớp với "*"
+    }
+    kg.addTriple("City5", "near", "City5");
+
+    // kết quả mong đợi: duyệt mọi cặp / bộ ba thực thể
+    auto edge = [&kg](const string &from, const string &predicate, const string &to) {
+        vector<string> targets = predicate == "*" ? kg.getNeighbors(from) : kg.getNeighbors(from, predicate);
+        return std::find(targets.begin(), targets.end(), to) != targets.end();
+    };
+    const vector<string> &all = kg.getAllEntities();
+    vector<vector<string> > expected;
+    for (const string &x : all)
+        for (const string &y : all)
+            if (edge(x, "partOf", y) && edge(y, "locatedIn", "Europe"))
+                expected.push_back({x, y});
+    vector<TriplePattern> inEurope = {TriplePattern("?x", "partOf", "?y"), TriplePattern("?y", "locatedIn", "Europe")};
+    vector<vector<string> > rows = kg.select(inEurope);
+    std::sort(rows.begin(), rows.end());
+    std::sort(expected.begin(), expected.end());
+    CHECK(rows == expected);
+    CHECK(rows.size() == 13);
+    CHECK(KnowledgeGraph::queryVariables(inEurope) == vector<string>{"?x", "?y"});
+    CHECK(kg.queryPlan(inEurope) == vector<string>{"?y", "?x"});
+
+    // tam giác qua biến chung, cạnh tự vòng, "*" không lặp kết quả
+    expected.clear();
+    for (const string &a : all)
+        for (const string &b : all)
+            for (const string &c : all)
+                if (edge(a, "near", b) && edge(a, "partOf", c) && edge(b, "*", c))
+                    expected.push_back({a, b, c});
+    rows = kg.select({TriplePattern("?a", "near", "?b"), TriplePattern("?a", "partOf", "?c"), TriplePattern("?b", "*", "?c")});
+    std::sort(rows.begin(), rows.end());
+    std::sort(expected.begin(), expected.end());
+    CHECK(rows == expected);
+    CHECK_FALSE(rows.empty());
+    CHECK(kg.select({TriplePattern("?s", "near", "?s")}) == vector<vector<string> >{{"City5"}});
+
+    // kết quả được đẩy dần; emit trả false thì dừng
+    int streamed = 0;
+    kg.query({TriplePattern("?x", "partOf", "?y")}, [&streamed](const vector<string> &) { return ++streamed < 5; });
+    CHECK(streamed == 5);
+    CHECK(kg.select({TriplePattern("?x", "partOf", "?y")}, 3).size() == 3);
+    CHECK(kg.select({TriplePattern("?x", "unknownPredicate", "?y")}).empty());
+    CHECK(kg.select({TriplePattern("Vietnam", "locatedIn", "Europe"), TriplePattern("?x", "partOf", "?y")}).empty());
+    CHECK_THROWS_AS(kg.select({TriplePattern("?x", "partOf", "Atlantis")}), EntityNotFoundException);
+}
+
+TEST_CASE("test_172")
+{
+    // k đường ngắn nhất và mọi đường đơn giới hạn số bước: so với vét cạn mọi đường đơn
+    KnowledgeGraph kg;
+    const int n = 12;
+    for (int i = 0; i < n; i++)
+        kg.addEntity("N" + to_string(i));
+    std::map<pair<int, int>, double> weights;
+    unsigned int seed = 3;
+    for (int k = 0; k < 40; k++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        int from = (seed >> 8) % n;
+        seed = seed * 1103515245u + 12345u;
+        int to = (seed >> 8) % n;
+        if (from == to)
+            continue;
+        float weight = (seed >> 4) % 9 + 1.0f;
+        kg.addRelation("N" + to_string(from), "N" + to_string(to), weight);
+        weights[make_pair(from, to)] = weight;
+    }
+    vector<pair<double, vector<string> > > all; // mọi đường đơn N0 -> N7
+    vector<int> path(1, 0);
+    std::function<void(double)> explore = [&](double cost) {
+        if (path.back() == 7)
+        {
+            vector<string> names;
+            for (int v : path)
+                names.push_back("N" + to_string(v));
+            all.push_back(make_pair(cost, names));
+            return;
+        }
+        for (auto &edge : weights)
+        {
+            if (edge.first.first != path.back() || std::find(path.begin(), path.end(), edge.first.second) != path.end())
+                continue;
+            path.push_back(edge.first.second);
+            explore(cost + edge.second);
+            path.pop_back();
+        }
+    };
+    explore(0);
+    std::sort(all.begin(), all.end());
+    REQUIRE(all.size() > 10);
+
+    vector<PathResult<string, double> > best = kg.kShortestPaths("N0", "N7", 10);
+    REQUIRE(best.size() == 10);
+    std::set<vector<string> > distinct;
+    for (size_t i = 0; i < best.size(); i++)
+    {
+        CHECK(best[i].distance == all[i].first);
+        CHECK(std::find(all.begin(), all.end(), make_pair(best[i].distance, best[i].path)) != all.end());
+        distinct.insert(best[i].path);
+    }
+    CHECK(distinct.size() == 10);
+    CHECK(best[0].distance == kg.shortestPath("N0", "N7").distance);
+    CHECK(kg.kShortestPaths("N0", "N7", -1).size() == all.size());
+
+    // đường đơn tối đa 4 cạnh: đúng tập của vét cạn, dừng sớm theo emit
+    std::set<vector<string> > expected, found;
+    for (auto &entry : all)
+        if (entry.second.size() <= 5)
+            expected.insert(entry.second);
+    for (const PathResult<string, double> &result : kg.simplePaths("N0", "N7", 4))
+    {
+        CHECK(result.path.size() <= 5);
+        found.insert(result.path);
+    }
+    CHECK(found == expected);
+    CHECK(kg.simplePaths("N0", "N7", 4, 2).size() == 2);
+    int streamed = 0;
+    kg.kShortestPaths("N0", "N7", 100, [&streamed](const PathResult<string, double> &) { return ++streamed < 3; });
+    CHECK(streamed == 3);
+    CHECK(kg.simplePaths("N0", "N0", 3).size() == 1);
+    CHECK(kg.kShortestPaths("N7", "N0", 0).empty());
+
+    // trọng số âm (không có chu trình âm)
+    KnowledgeGraph negative;
+    for (string name : {"A", "B", "C", "D"})
+        negative.addEntity(name);
+    negative.addRelation("A", "B", 4);
+    negative.addRelation("A", "C", 2);
+    negative.addRelation("C", "B", -3);
+    negative.addRelation("B", "D", 1);
+    negative.addRelation("C", "D", 5);
+    vector<PathResult<string, double> > paths = negative.kShortestPaths("A", "D", 5);
+    REQUIRE(paths.size() == 3);
+    CHECK(paths[0].path == vector<string>{"A", "C", "B", "D"});
+    CHECK(paths[0].distance == 0);
+    CHECK(paths[1].distance == 5);
+    CHECK(paths[2].distance == 7);
+}
+
+TEST_CASE("test_173")
+{
+    // vùng lân cận theo chi phí: so với bảng khoảng cách đầy đủ, lọc theo budget và sắp theo (chi phí, thứ tự thêm)
+    KnowledgeGraph kg, light;
+    const int n = 60;
+    for (int i = 0; i < n; i++)
+    {
+        kg.addEntity("N" + to_string(i));
+        light.addEntity("N" + to_string(i));
+    }
+    unsigned int seed = 11;
+    for (int k = 0; k < 240; k++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        int from = (seed >> 8) % n;
+        seed = seed * 1103515245u + 12345u;
+        int to = (seed >> 8) % n;
+        if (from == to)
+            continue;
+        float weight = (seed >> 4) % 7 + 1.0f;
+        try
+        {
+            kg.addRelation("N" + to_string(from), "N" + to_string(to), weight);
+        }
+        catch (const exception &)
+        {
+            continue; // quan hệ đã có
+        }
+        if (weight <= 4)
+            light.addRelation("N" + to_string(from), "N" + to_string(to), weight);
+    }
+
+    auto expected = [](KnowledgeGraph &graph, const string &entity, double budget) {
+        vector<pair<double, int> > order;
+        vector<string> all = graph.getAllEntities();
+        vector<pair<string, double> > distances = graph.shortestDistances(entity);
+        for (const pair<string, double> &hit : distances)
+            if (hit.first != entity && hit.second <= budget)
+                order.push_back(make_pair(hit.second, static_cast<int>(find(all.begin(), all.end(), hit.first) - all.begin())));
+        sort(order.begin(), order.end());
+        vector<pair<string, double> > result;
+        for (const pair<double, int> &entry : order)
+            result.push_back(make_pair(all[entry.second], entry.first));
+        return result;
+    };
+    for (double budget : {0.0, 3.0, 7.5, 12.0, 1e9})
+    {
+        CHECK(kg.entitiesWithinCost("N0", budget) == expected(kg, "N0", budget));
+        CHECK(kg.entitiesWithinCost("N5", budget, 4.0) == expected(light, "N5", budget));
+    }
+    vector<pair<string, double> > all = kg.entitiesWithinCost("N0", 1e9);
+    vector<pair<string, double> > capped = kg.entitiesWithinCost("N0", 1e9, numeric_limits<double>::infinity(), 5);
+    REQUIRE(all.size() > 5);
+    CHECK(capped == vector<pair<string, double> >(all.begin(), all.begin() + 5));
+    CHECK(kg.entitiesWithinCost("N0", -1).empty());
+    CHECK_THROWS_AS(kg.entitiesWithinCost("Nobody", 5), EntityNotFoundException);
+
+    // trọng số âm: cạnh âm ngoài budget vẫn rút ngắn được đường tới B
+    KnowledgeGraph negative;
+    for (string name : {"A", "B", "C", "D"})
+        negative.addEntity(name);
+    negative.addRelation("A", "B", 3);
+    negative.addRelation("A", "C", 5);
+    negative.addRelation("C", "B", -4);
+    negative.addRelation("B", "D", 2);
+    vector<pair<string, double> > reached = negative.entitiesWithinCost("A", 3);
+    REQUIRE(reached.size() == 2);
+    CHECK(reached[0] == make_pair(string("B"), 1.0));
+    CHECK(reached[1] == make_pair(string("D"), 3.0));
+    CHECK(negative.entitiesWithinCost("A", 3, 4.0) == vector<pair<string, double> >{{"B", 3.0}});
+}